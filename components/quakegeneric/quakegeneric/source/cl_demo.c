@@ -114,6 +114,7 @@ int CL_GetMessage (void)
 		}
 		
 	// get the next message
+		NET_ResetMessage ();
 		fread (&net_message.cursize, 4, 1, cls.demofile);
 		VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
 		for (i=0 ; i<3 ; i++)
@@ -175,6 +176,7 @@ void CL_Stop_f (void)
 	}
 
 // write a disconnect message to the demo file
+	NET_ResetMessage ();
 	SZ_Clear (&net_message);
 	MSG_WriteByte (&net_message, svc_disconnect);
 	CL_WriteDemoMessage ();
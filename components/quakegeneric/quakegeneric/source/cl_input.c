@@ -329,6 +329,7 @@ void CL_SendMove (usercmd_t *cmd)
 {
 	int		i;
 	int		bits;
+	int		impulse;
 	sizebuf_t	buf;
 	byte	data[128];
 	
@@ -368,6 +369,7 @@ void CL_SendMove (usercmd_t *cmd)
     MSG_WriteByte (&buf, bits);
 
     MSG_WriteByte (&buf, in_impulse);
+	impulse = in_impulse;
 	in_impulse = 0;
 
 //
@@ -382,6 +384,9 @@ void CL_SendMove (usercmd_t *cmd)
 //
 	if (++cl.movemessages <= 2)
 		return;
+
+	CL_AddPredictCmd (cmd, bits);
+	Bot_RecordMove (cl.viewangles, cmd, bits, impulse);
 	
 	if (NET_SendUnreliableMessage (cls.netcon, &buf) == -1)
 	{
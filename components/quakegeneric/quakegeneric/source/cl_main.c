@@ -90,6 +90,8 @@ void CL_ClearState (void)
 	for (i=0 ; i<MAX_EFRAGS-1 ; i++)
 		cl.free_efrags[i].entnext = &cl.free_efrags[i+1];
 	cl.free_efrags[i].entnext = NULL;
+
+	CL_ClearPrediction ();
 }
 
 /*
@@ -631,6 +633,7 @@ int CL_ReadFromServer (void)
 		Con_Printf ("\n");
 
 	CL_RelinkEntities ();
+	CL_PredictMove ();
 	CL_UpdateTEnts ();
 
 //
@@ -697,6 +700,7 @@ void CL_Init (void)
 
 	CL_InitInput ();
 	CL_InitTEnts ();
+	CL_InitPrediction ();
 	
 //
 // register our commands
@@ -285,6 +285,7 @@ void CL_ParseServerInfo (void)
 // now we try to load everything else until a cache allocation fails
 //
 
+	Cache_BeginWorkingSet ();
 	for (i=1 ; i<nummodels ; i++)
 	{
 		cl.model_precache[i] = Mod_ForName (model_precache[i], false);
@@ -293,6 +294,7 @@ void CL_ParseServerInfo (void)
 			Con_Printf("Model %s not found\n", model_precache[i]);
 			return;
 		}
+		Cache_AddWorkingSet (&cl.model_precache[i]->cache);
 		CL_KeepaliveMessage ();
 	}
 
@@ -300,6 +302,8 @@ void CL_ParseServerInfo (void)
 	for (i=1 ; i<numsounds ; i++)
 	{
 		cl.sound_precache[i] = S_PrecacheSound (sound_precache[i]);
+		if (cl.sound_precache[i])
+			Cache_AddWorkingSet (&cl.sound_precache[i]->cache);
 		CL_KeepaliveMessage ();
 	}
 	S_EndPrecaching ();
@@ -604,6 +608,8 @@ void CL_ParseClientdata (int bits)
 	}
 }
 
+int		cl_translationchanges;	// the tables are rewritten in place
+
 /*
 =====================
 CL_NewTranslation
@@ -620,6 +626,7 @@ void CL_NewTranslation (int slot)
 	dest = cl.scores[slot].translations;
 	source = vid.colormap;
 	memcpy (dest, vid.colormap, sizeof(cl.scores[slot].translations));
+	cl_translationchanges++;
 	top = cl.scores[slot].colors & 0xf0;
 	bottom = (cl.scores[slot].colors &15)<<4;
 
@@ -665,6 +672,12 @@ void CL_ParseStatic (void)
 
 	VectorCopy (ent->baseline.origin, ent->origin);
 	VectorCopy (ent->baseline.angles, ent->angles);	
+
+// the slot may still hold the lighting and pose of the last level's entity
+	ent->lightcached = false;
+	if (ent->posecache.data)
+		Cache_Free (&ent->posecache);
+
 	R_AddEfrags (ent);
 }
 
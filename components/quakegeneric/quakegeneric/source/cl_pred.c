@@ -0,0 +1,833 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_pred.c -- client side player movement prediction
+
+/*
+
+When connected to a remote server the view only moves once the server has
+run a move and sent the result back.  To hide that, every command sent is
+kept, and each frame the player is moved locally from the newest state the
+server sent by replaying the commands the server cannot have seen yet.
+The movement code mirrors SV_ClientThink / SV_WalkMove, but clips against
+the client's copy of the world and brush model hulls only.
+
+The protocol carries no command acknowledgement, so the commands the
+server has already run are guessed from the time they were sent: anything
+older than one server frame plus cl_predict_lag before the state arrived
+is assumed to be included in it.
+
+*/
+
+#include "quakedef.h"
+
+cvar_t	cl_predict = {"cl_predict", "1"};
+cvar_t	cl_predict_lag = {"cl_predict_lag", "0"};	// extra network latency in seconds
+
+extern	cvar_t	sv_friction;
+extern	cvar_t	sv_edgefriction;
+extern	cvar_t	sv_stopspeed;
+extern	cvar_t	sv_maxspeed;
+extern	cvar_t	sv_accelerate;
+extern	cvar_t	sv_gravity;
+extern	cvar_t	sv_maxvelocity;
+extern	cvar_t	sv_nostep;
+
+#define	PRED_BACKUP		64			// must be a power of 2
+#define	PRED_MASK		(PRED_BACKUP-1)
+#define	PRED_MAXTIME	0.5			// never replay more than this
+#define	PRED_SNAPDIST	64			// larger corrections are not smoothed
+
+#define	STEPSIZE		18
+#define	JUMPSPEED		270
+
+typedef struct
+{
+	usercmd_t	cmd;
+	qboolean	jump;
+	double		senttime;			// realtime the command went out
+	float		frametime;			// how long the command was applied for
+} predcmd_t;
+
+typedef struct
+{
+	vec3_t		origin;
+	vec3_t		velocity;
+	qboolean	onground;
+	int			waterlevel;
+	qboolean	jumpreleased;		// FL_JUMPRELEASED in the progs
+} predstate_t;
+
+static predcmd_t	pred_cmds[PRED_BACKUP];
+static int			pred_numcmds;			// total ever added
+
+static vec3_t		pred_mins = {-16, -16, -24};
+static vec3_t		pred_maxs = {16, 16, 32};
+
+static double		pred_basetime;			// arrival of the state we predict from
+static double		pred_lastbasetime;
+static predstate_t	pred_lastbase;
+static vec3_t		pred_error;				// smoothed out over a few frames
+
+/*
+===============================================================================
+
+CLIPPING
+
+===============================================================================
+*/
+
+/*
+==================
+CL_PredClipToHull
+
+Same as SV_ClipMoveToEntity
+==================
+*/
+static trace_t CL_PredClipToHull (hull_t *hull, vec3_t offset, vec3_t start, vec3_t end)
+{
+	trace_t		trace;
+	vec3_t		start_l, end_l;
+
+	memset (&trace, 0, sizeof(trace_t));
+	trace.fraction = 1;
+	trace.allsolid = true;
+	VectorCopy (end, trace.endpos);
+
+	VectorSubtract (start, offset, start_l);
+	VectorSubtract (end, offset, end_l);
+
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, &trace);
+
+	if (trace.fraction != 1)
+		VectorAdd (trace.endpos, offset, trace.endpos);
+
+	return trace;
+}
+
+/*
+==================
+CL_PredMove
+
+Traces the player box against the world and all brush entities the
+server sent in its last message.  The server would also clip against
+monsters and other players; those mistakes are fixed up by the next
+server update.
+==================
+*/
+static trace_t CL_PredMove (vec3_t start, vec3_t end)
+{
+	trace_t		total, trace;
+	int			i;
+	entity_t	*ent;
+
+	total = CL_PredClipToHull (&cl.worldmodel->hulls[1], vec3_origin, start, end);
+
+	for (i=1,ent=cl_entities+1 ; i<cl.num_entities ; i++,ent++)
+	{
+		if (total.allsolid)
+			break;
+		if (!ent->model || ent->model->type != mod_brush)
+			continue;
+		if (ent->msgtime != cl.mtime[0])
+			continue;
+
+		trace = CL_PredClipToHull (&ent->model->hulls[1], ent->msg_origins[0], start, end);
+
+		if (trace.allsolid || trace.startsolid || trace.fraction < total.fraction)
+		{
+			if (total.startsolid)
+			{
+				total = trace;
+				total.startsolid = true;
+			}
+			else
+				total = trace;
+		}
+		else if (trace.startsolid)
+			total.startsolid = true;
+	}
+
+	return total;
+}
+
+/*
+==================
+CL_PredPointContents
+==================
+*/
+static int CL_PredPointContents (vec3_t p)
+{
+	int		cont;
+
+	cont = SV_HullPointContents (&cl.worldmodel->hulls[0], 0, p);
+	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
+		cont = CONTENTS_WATER;
+	return cont;
+}
+
+/*
+===============================================================================
+
+PLAYER MOVEMENT
+
+===============================================================================
+*/
+
+/*
+=============
+CL_PredCheckWater
+
+Same as SV_CheckWater
+=============
+*/
+static qboolean CL_PredCheckWater (predstate_t *ps)
+{
+	vec3_t	point;
+
+	point[0] = ps->origin[0];
+	point[1] = ps->origin[1];
+	point[2] = ps->origin[2] + pred_mins[2] + 1;
+
+	ps->waterlevel = 0;
+	if (CL_PredPointContents (point) <= CONTENTS_WATER)
+	{
+		ps->waterlevel = 1;
+		point[2] = ps->origin[2] + (pred_mins[2] + pred_maxs[2])*0.5;
+		if (CL_PredPointContents (point) <= CONTENTS_WATER)
+		{
+			ps->waterlevel = 2;
+			point[2] = ps->origin[2] + DEFAULT_VIEWHEIGHT;
+			if (CL_PredPointContents (point) <= CONTENTS_WATER)
+				ps->waterlevel = 3;
+		}
+	}
+
+	return ps->waterlevel > 1;
+}
+
+/*
+=============
+CL_PredFlyMove
+
+Same as SV_FlyMove
+=============
+*/
+#define	MAX_CLIP_PLANES	5
+static int CL_PredFlyMove (predstate_t *ps, float time, trace_t *steptrace)
+{
+	int			bumpcount, numbumps;
+	vec3_t		dir;
+	float		d;
+	int			numplanes;
+	vec3_t		planes[MAX_CLIP_PLANES];
+	vec3_t		primal_velocity, original_velocity, new_velocity;
+	int			i, j;
+	trace_t		trace;
+	vec3_t		end;
+	float		time_left;
+	int			blocked;
+
+	numbumps = 4;
+
+	blocked = 0;
+	VectorCopy (ps->velocity, original_velocity);
+	VectorCopy (ps->velocity, primal_velocity);
+	numplanes = 0;
+
+	time_left = time;
+
+	for (bumpcount=0 ; bumpcount<numbumps ; bumpcount++)
+	{
+		if (!ps->velocity[0] && !ps->velocity[1] && !ps->velocity[2])
+			break;
+
+		for (i=0 ; i<3 ; i++)
+			end[i] = ps->origin[i] + time_left * ps->velocity[i];
+
+		trace = CL_PredMove (ps->origin, end);
+
+		if (trace.allsolid)
+		{	// entity is trapped in another solid
+			VectorCopy (vec3_origin, ps->velocity);
+			return 3;
+		}
+
+		if (trace.fraction > 0)
+		{	// actually covered some distance
+			VectorCopy (trace.endpos, ps->origin);
+			VectorCopy (ps->velocity, original_velocity);
+			numplanes = 0;
+		}
+
+		if (trace.fraction == 1)
+			 break;		// moved the entire distance
+
+		if (trace.plane.normal[2] > 0.7)
+		{
+			blocked |= 1;		// floor
+			ps->onground = true;
+		}
+		if (!trace.plane.normal[2])
+		{
+			blocked |= 2;		// step
+			if (steptrace)
+				*steptrace = trace;
+		}
+
+		time_left -= time_left * trace.fraction;
+
+	// cliped to another plane
+		if (numplanes >= MAX_CLIP_PLANES)
+		{
+			VectorCopy (vec3_origin, ps->velocity);
+			return 3;
+		}
+
+		VectorCopy (trace.plane.normal, planes[numplanes]);
+		numplanes++;
+
+		for (i=0 ; i<numplanes ; i++)
+		{
+			ClipVelocity (original_velocity, planes[i], new_velocity, 1);
+			for (j=0 ; j<numplanes ; j++)
+				if (j != i)
+				{
+					if (DotProduct (new_velocity, planes[j]) < 0)
+						break;	// not ok
+				}
+			if (j == numplanes)
+				break;
+		}
+
+		if (i != numplanes)
+		{	// go along this plane
+			VectorCopy (new_velocity, ps->velocity);
+		}
+		else
+		{	// go along the crease
+			if (numplanes != 2)
+			{
+				VectorCopy (vec3_origin, ps->velocity);
+				return 7;
+			}
+			CrossProduct (planes[0], planes[1], dir);
+			d = DotProduct (dir, ps->velocity);
+			VectorScale (dir, d, ps->velocity);
+		}
+
+		if (DotProduct (ps->velocity, primal_velocity) <= 0)
+		{
+			VectorCopy (vec3_origin, ps->velocity);
+			return blocked;
+		}
+	}
+
+	return blocked;
+}
+
+/*
+=============
+CL_PredPush
+
+Same as SV_PushEntity, without touching anything
+=============
+*/
+static trace_t CL_PredPush (predstate_t *ps, vec3_t push)
+{
+	trace_t	trace;
+	vec3_t	end;
+
+	VectorAdd (ps->origin, push, end);
+	trace = CL_PredMove (ps->origin, end);
+	VectorCopy (trace.endpos, ps->origin);
+	return trace;
+}
+
+/*
+=============
+CL_PredWalkMove
+
+Same as SV_WalkMove, minus the unstick and wall friction hacks
+=============
+*/
+static void CL_PredWalkMove (predstate_t *ps, float frametime)
+{
+	vec3_t		upmove, downmove;
+	vec3_t		oldorg, oldvel;
+	vec3_t		nosteporg, nostepvel;
+	int			clip;
+	qboolean	oldonground;
+	trace_t		steptrace, downtrace;
+
+	oldonground = ps->onground;
+	ps->onground = false;
+
+	VectorCopy (ps->origin, oldorg);
+	VectorCopy (ps->velocity, oldvel);
+
+	clip = CL_PredFlyMove (ps, frametime, &steptrace);
+
+	if ( !(clip & 2) )
+		return;		// move didn't block on a step
+
+	if (!oldonground && ps->waterlevel == 0)
+		return;		// don't stair up while jumping
+
+	if (sv_nostep.value)
+		return;
+
+	VectorCopy (ps->origin, nosteporg);
+	VectorCopy (ps->velocity, nostepvel);
+
+// try moving up and forward to go up a step
+	VectorCopy (oldorg, ps->origin);
+
+	VectorCopy (vec3_origin, upmove);
+	VectorCopy (vec3_origin, downmove);
+	upmove[2] = STEPSIZE;
+	downmove[2] = -STEPSIZE + oldvel[2]*frametime;
+
+	CL_PredPush (ps, upmove);
+
+	ps->velocity[0] = oldvel[0];
+	ps->velocity[1] = oldvel[1];
+	ps->velocity[2] = 0;
+	CL_PredFlyMove (ps, frametime, &steptrace);
+
+	downtrace = CL_PredPush (ps, downmove);
+
+	if (downtrace.plane.normal[2] > 0.7)
+		ps->onground = true;
+	else
+	{
+		VectorCopy (nosteporg, ps->origin);
+		VectorCopy (nostepvel, ps->velocity);
+	}
+}
+
+/*
+=============
+CL_PredFriction
+
+Same as SV_UserFriction
+=============
+*/
+static void CL_PredFriction (predstate_t *ps, float frametime)
+{
+	float	*vel;
+	float	speed, newspeed, control;
+	vec3_t	start, stop;
+	float	friction;
+	trace_t	trace;
+
+	vel = ps->velocity;
+
+	speed = sqrt(vel[0]*vel[0] +vel[1]*vel[1]);
+	if (!speed)
+		return;
+
+// if the leading edge is over a dropoff, increase friction
+	start[0] = stop[0] = ps->origin[0] + vel[0]/speed*16;
+	start[1] = stop[1] = ps->origin[1] + vel[1]/speed*16;
+	start[2] = ps->origin[2] + pred_mins[2];
+	stop[2] = start[2] - 34;
+
+	trace = CL_PredClipToHull (&cl.worldmodel->hulls[0], vec3_origin, start, stop);
+
+	if (trace.fraction == 1.0)
+		friction = sv_friction.value*sv_edgefriction.value;
+	else
+		friction = sv_friction.value;
+
+	control = speed < sv_stopspeed.value ? sv_stopspeed.value : speed;
+	newspeed = speed - frametime*control*friction;
+
+	if (newspeed < 0)
+		newspeed = 0;
+	newspeed /= speed;
+
+	vel[0] = vel[0] * newspeed;
+	vel[1] = vel[1] * newspeed;
+	vel[2] = vel[2] * newspeed;
+}
+
+/*
+=============
+CL_PredAccelerate
+
+Same as SV_Accelerate / SV_AirAccelerate
+=============
+*/
+static void CL_PredAccelerate (predstate_t *ps, vec3_t wishdir, float wishspeed, float cap, float frametime)
+{
+	int			i;
+	float		addspeed, accelspeed, currentspeed, wishspd;
+
+	wishspd = wishspeed;
+	if (cap && wishspd > cap)
+		wishspd = cap;
+
+	currentspeed = DotProduct (ps->velocity, wishdir);
+	addspeed = wishspd - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = sv_accelerate.value*wishspeed*frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i=0 ; i<3 ; i++)
+		ps->velocity[i] += accelspeed*wishdir[i];
+}
+
+/*
+=============
+CL_PredWaterMove
+
+Same as SV_WaterMove
+=============
+*/
+static void CL_PredWaterMove (predstate_t *ps, usercmd_t *cmd, float frametime)
+{
+	int		i;
+	vec3_t	forward, right, up;
+	vec3_t	wishvel;
+	float	speed, newspeed, wishspeed, addspeed, accelspeed;
+
+	AngleVectors (cmd->viewangles, forward, right, up);
+
+	for (i=0 ; i<3 ; i++)
+		wishvel[i] = forward[i]*cmd->forwardmove + right[i]*cmd->sidemove;
+
+	if (!cmd->forwardmove && !cmd->sidemove && !cmd->upmove)
+		wishvel[2] -= 60;		// drift towards bottom
+	else
+		wishvel[2] += cmd->upmove;
+
+	wishspeed = Length(wishvel);
+	if (wishspeed > sv_maxspeed.value)
+	{
+		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
+		wishspeed = sv_maxspeed.value;
+	}
+	wishspeed *= 0.7;
+
+	speed = Length (ps->velocity);
+	if (speed)
+	{
+		newspeed = speed - frametime * speed * sv_friction.value;
+		if (newspeed < 0)
+			newspeed = 0;
+		VectorScale (ps->velocity, newspeed/speed, ps->velocity);
+	}
+	else
+		newspeed = 0;
+
+	if (!wishspeed)
+		return;
+
+	addspeed = wishspeed - newspeed;
+	if (addspeed <= 0)
+		return;
+
+	VectorNormalize (wishvel);
+	accelspeed = sv_accelerate.value * wishspeed * frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i=0 ; i<3 ; i++)
+		ps->velocity[i] += accelspeed * wishvel[i];
+}
+
+/*
+=============
+CL_PredAirMove
+
+Same as SV_AirMove for MOVETYPE_WALK
+=============
+*/
+static void CL_PredAirMove (predstate_t *ps, usercmd_t *cmd, float frametime)
+{
+	int			i;
+	vec3_t		angles, forward, right, up;
+	vec3_t		wishvel, wishdir;
+	float		wishspeed;
+
+	angles[PITCH] = -cmd->viewangles[PITCH]/3;
+	angles[YAW] = cmd->viewangles[YAW];
+	angles[ROLL] = 0;
+	AngleVectors (angles, forward, right, up);
+
+	for (i=0 ; i<3 ; i++)
+		wishvel[i] = forward[i]*cmd->forwardmove + right[i]*cmd->sidemove;
+	wishvel[2] = 0;
+
+	VectorCopy (wishvel, wishdir);
+	wishspeed = VectorNormalize (wishdir);
+	if (wishspeed > sv_maxspeed.value)
+	{
+		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
+		wishspeed = sv_maxspeed.value;
+	}
+
+	if (ps->onground)
+	{
+		CL_PredFriction (ps, frametime);
+		CL_PredAccelerate (ps, wishdir, wishspeed, 0, frametime);
+	}
+	else
+		CL_PredAccelerate (ps, wishdir, wishspeed, 30, frametime);
+}
+
+/*
+=============
+CL_PredPlayerMove
+
+One client frame of SV_ClientThink followed by SV_Physics_Client.
+The jump is what the stock progs do in PlayerPreThink.
+=============
+*/
+static void CL_PredPlayerMove (predstate_t *ps, predcmd_t *pc)
+{
+	int		i;
+	float	frametime;
+
+	frametime = pc->frametime;
+
+// PlayerPreThink
+	if (pc->jump)
+	{
+		if (ps->onground && ps->jumpreleased)
+		{
+			ps->jumpreleased = false;
+			ps->onground = false;
+			ps->velocity[2] += JUMPSPEED;
+		}
+	}
+	else
+		ps->jumpreleased = true;
+
+// SV_ClientThink
+	if (ps->waterlevel >= 2)
+		CL_PredWaterMove (ps, &pc->cmd, frametime);
+	else
+		CL_PredAirMove (ps, &pc->cmd, frametime);
+
+// SV_Physics_Client
+	for (i=0 ; i<3 ; i++)
+	{
+		if (ps->velocity[i] > sv_maxvelocity.value)
+			ps->velocity[i] = sv_maxvelocity.value;
+		else if (ps->velocity[i] < -sv_maxvelocity.value)
+			ps->velocity[i] = -sv_maxvelocity.value;
+	}
+
+	if (!CL_PredCheckWater (ps))
+		ps->velocity[2] -= sv_gravity.value * frametime;
+
+	CL_PredWalkMove (ps, frametime);
+}
+
+/*
+===============================================================================
+
+PREDICTION
+
+===============================================================================
+*/
+
+/*
+=============
+CL_PredictReplay
+
+Runs every command sent after acktime on top of a server state
+=============
+*/
+static void CL_PredictReplay (predstate_t *ps, double acktime)
+{
+	int			i, first;
+	predcmd_t	*pc;
+
+// find the oldest command the server has not seen yet
+	first = pred_numcmds;
+	while (first > 0 && pred_numcmds - first < PRED_BACKUP)
+	{
+		pc = &pred_cmds[(first-1) & PRED_MASK];
+		if (pc->senttime <= acktime || realtime - pc->senttime > PRED_MAXTIME)
+			break;
+		first--;
+	}
+
+// the jump debounce depends on the command before it
+	if (first > 0 && pred_numcmds - first < PRED_BACKUP)
+		ps->jumpreleased = !pred_cmds[(first-1) & PRED_MASK].jump;
+	else
+		ps->jumpreleased = true;
+
+	for (i=first ; i<pred_numcmds ; i++)
+		CL_PredPlayerMove (ps, &pred_cmds[i & PRED_MASK]);
+}
+
+/*
+=============
+CL_PredictBaseState
+
+The newest player state the server sent
+=============
+*/
+static void CL_PredictBaseState (predstate_t *ps)
+{
+	VectorCopy (cl_entities[cl.viewentity].msg_origins[0], ps->origin);
+	VectorCopy (cl.mvelocity[0], ps->velocity);
+	ps->onground = cl.onground;
+	ps->waterlevel = cl.inwater ? 2 : 0;
+	ps->jumpreleased = true;
+}
+
+/*
+=============
+CL_PredictAckTime
+
+Guess when the newest command included in a server state was sent
+=============
+*/
+static double CL_PredictAckTime (double basetime)
+{
+	double	frame;
+
+	frame = cl.mtime[0] - cl.mtime[1];
+	if (frame < 0)
+		frame = 0;
+	else if (frame > 0.1)
+		frame = 0.1;
+
+	return basetime - frame - cl_predict_lag.value;
+}
+
+/*
+=============
+CL_AddPredictCmd
+
+Called for every move actually sent to the server
+=============
+*/
+void CL_AddPredictCmd (usercmd_t *cmd, int buttons)
+{
+	predcmd_t	*pc;
+
+	pc = &pred_cmds[pred_numcmds & PRED_MASK];
+	pc->cmd = *cmd;
+	VectorCopy (cl.viewangles, pc->cmd.viewangles);
+	pc->jump = (buttons & 2) != 0;
+	pc->senttime = realtime;
+	pc->frametime = host_frametime;
+	pred_numcmds++;
+}
+
+/*
+=============
+CL_ClearPrediction
+=============
+*/
+void CL_ClearPrediction (void)
+{
+	pred_numcmds = 0;
+	pred_basetime = 0;
+	pred_lastbasetime = 0;
+	VectorCopy (vec3_origin, pred_error);
+}
+
+/*
+=============
+CL_PredictMove
+
+Called after the entities have been relinked.  Moves the view entity to
+where the player will be once the server has run the pending commands.
+=============
+*/
+void CL_PredictMove (void)
+{
+	entity_t	*ent;
+	predstate_t	ps, old;
+	qboolean	reconcile;
+	float		decay;
+
+	if (!cl_predict.value || sv.active || cls.demoplayback
+	|| cls.signon != SIGNONS || cl.intermission || cl.paused
+	|| cl.stats[STAT_HEALTH] <= 0 || !cl.worldmodel)
+	{
+		VectorCopy (vec3_origin, pred_error);
+		pred_lastbasetime = 0;
+		return;
+	}
+
+	ent = &cl_entities[cl.viewentity];
+	if (!ent->model || ent->msgtime != cl.mtime[0])
+		return;
+
+	reconcile = false;
+	if (ent->msgtime != pred_basetime)
+	{
+	// a new server state arrived.  Find out where the previous one would
+	// have put us right now, so the difference can be faded out instead
+	// of popping the view
+		pred_basetime = ent->msgtime;
+		if (pred_lastbasetime)
+		{
+			old = pred_lastbase;
+			CL_PredictReplay (&old, CL_PredictAckTime (pred_lastbasetime));
+			reconcile = true;
+		}
+		CL_PredictBaseState (&pred_lastbase);
+		pred_lastbasetime = cl.last_received_message;
+	}
+
+	ps = pred_lastbase;
+	CL_PredictReplay (&ps, CL_PredictAckTime (pred_lastbasetime));
+
+	if (reconcile)
+	{
+		VectorAdd (pred_error, old.origin, pred_error);
+		VectorSubtract (pred_error, ps.origin, pred_error);
+		if (Length (pred_error) > PRED_SNAPDIST)
+			VectorCopy (vec3_origin, pred_error);
+	}
+
+	decay = 1 - host_frametime*10;
+	if (decay < 0)
+		decay = 0;
+	VectorScale (pred_error, decay, pred_error);
+
+	VectorAdd (ps.origin, pred_error, ent->origin);
+	cl.velocity[0] = ps.velocity[0];
+	cl.velocity[1] = ps.velocity[1];
+	cl.velocity[2] = ps.velocity[2];
+	cl.onground = ps.onground;
+}
+
+/*
+=============
+CL_InitPrediction
+=============
+*/
+void CL_InitPrediction (void)
+{
+	Cvar_RegisterVariable (&cl_predict);
+	Cvar_RegisterVariable (&cl_predict_lag);
+}
@@ -325,6 +325,16 @@ void CL_BaseMove (usercmd_t *cmd);
 float CL_KeyState (kbutton_t *key);
 char *Key_KeynumToString (int keynum);
 
+//
+// cl_pred.c
+//
+extern	cvar_t	cl_predict;
+
+void CL_InitPrediction (void);
+void CL_ClearPrediction (void);
+void CL_AddPredictCmd (usercmd_t *cmd, int buttons);
+void CL_PredictMove (void);
+
 //
 // cl_demo.c
 //
@@ -342,6 +352,8 @@ void CL_TimeDemo_f (void);
 void CL_ParseServerMessage (void);
 void CL_NewTranslation (int slot);
 
+extern	int		cl_translationchanges;
+
 //
 // view
 //
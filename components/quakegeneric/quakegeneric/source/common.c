@@ -1307,7 +1307,7 @@ void COM_WriteFile (char *filename, void *data, int len)
 ============
 COM_CreatePath
 
-Only used for CopyFile
+Creates the directories leading up to path
 ============
 */
 void    COM_CreatePath (char *path)
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 cvar_t	*cvar_vars;
+int		cvar_changes;	// bumped whenever Cvar_Set changes a value
 char	*cvar_null_string = "";
 
 /*
@@ -120,6 +121,8 @@ void Cvar_Set (char *var_name, char *value)
 	var->string = Z_Malloc (Q_strlen(value)+1);
 	Q_strcpy (var->string, value);
 	var->value = Q_atof (var->string);
+	if (changed)
+		cvar_changes++;
 	if (var->server && changed)
 	{
 		if (sv.active)
@@ -257,7 +257,7 @@ void D_DrawSurfaces (void)
 				}
 
 				D_CalcGradients (pface);
-				Turbulent8 (s->spans);
+				D_DrawTurbulent (s->spans, pface->texinfo->texture);
 				D_DrawZSpans (s->spans);
 
 				if (s->insubmodel)
@@ -301,8 +301,11 @@ void D_DrawSurfaces (void)
 
 				cacheblock = (pixel_t *)pcurrentcache->data;
 				cachewidth = pcurrentcache->width;
+				cacheheight = pface->extents[1] >> miplevel;	// ->height is padded
+				cachetileshift = 4 - miplevel;
 
 				D_CalcGradients (pface);
+				D_SelectSpans (s->spans, miplevel);
 
 				(*d_drawspans) (s->spans);
 
@@ -37,19 +37,7 @@ typedef enum {
 	pt_static, pt_grav, pt_slowgrav, pt_fire, pt_explode, pt_explode2, pt_blob, pt_blob2
 } ptype_t;
 
-// !!! if this is changed, it must be changed in d_ifacea.h too !!!
-typedef struct particle_s
-{
-// driver-usable fields
-	vec3_t		org;
-	float		color;
-// drivers never touch the following fields
-	struct particle_s	*next;
-	vec3_t		vel;
-	float		ramp;
-	float		die;
-	ptype_t		type;
-} particle_t;
+#define NUM_PARTICLETYPES	(pt_blob2 + 1)
 
 #define PARTICLE_Z_CLIP	8.0
 
@@ -148,9 +136,11 @@ void D_Aff8Patch (void *pcolormap);
 void D_BeginDirectRect (int x, int y, byte *pbitmap, int width, int height);
 void D_DisableBackBufferAccess (void);
 void D_EndDirectRect (int x, int y, int width, int height);
+void D_PolysetInit (void);
 void D_PolysetDraw (void);
 void D_PolysetDrawFinalVerts (finalvert_t *fv, int numverts);
-void D_DrawParticle (particle_t *pparticle);
+void D_DrawParticles (int count, float *orgx, float *orgy, float *orgz,
+	byte *color);
 void D_DrawPoly (void);
 void D_DrawSprite (void);
 void D_DrawSurfaces (void);
@@ -201,12 +191,14 @@ typedef struct
 	int			surfmip;	// mipmapped ratio of surface texels / world pixels
 	int			surfwidth;	// in mipmapped texels
 	int			surfheight;	// in mipmapped texels
+	qboolean	tiled;		// lighting blocks stored column after column
 } drawsurf_t;
 
 extern drawsurf_t	r_drawsurf;
 
 void R_DrawSurface (void);
 void R_GenTile (msurface_t *psurf, void *pdest);
+void R_GenTurbTile (pixel_t *pbasetex, void *pdest);
 
 
 // !!! if this is changed, it must be changed in d_ifacea.h too !!!
@@ -27,6 +27,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 cvar_t	d_subdiv16 = {"d_subdiv16", "1"};
 cvar_t	d_mipcap = {"d_mipcap", "0"};
 cvar_t	d_mipscale = {"d_mipscale", "1"};
+cvar_t	d_tiledsurfs = {"d_tiledsurfs", "0"};
+cvar_t	d_subdiv = {"d_subdiv", "0"};			// 8, 16, 32, or 0 to adapt
+cvar_t	d_subdivtol = {"d_subdivtol", "0.5"};	// texels of error allowed
+cvar_t	d_hiz = {"d_hiz", "1"};
+
+qboolean		d_surftiled;
+qboolean		d_spansim;
+qboolean		d_spanref;
 
 surfcache_t		*d_initial_rover;
 qboolean		d_roverwrapped;
@@ -53,11 +61,18 @@ void D_Init (void)
 	Cvar_RegisterVariable (&d_subdiv16);
 	Cvar_RegisterVariable (&d_mipcap);
 	Cvar_RegisterVariable (&d_mipscale);
+	Cvar_RegisterVariable (&d_tiledsurfs);
+	Cvar_RegisterVariable (&d_subdiv);
+	Cvar_RegisterVariable (&d_subdivtol);
+	Cvar_RegisterVariable (&d_hiz);
 
 	r_drawpolys = false;
 	r_worldpolysbacktofront = false;
 	r_recursiveaffinetriangles = true;
 	r_aliasuvscale = 1.0;
+
+	D_PolysetInit ();
+	D_InitTurbTiles ();
 }
 
 
@@ -132,9 +147,18 @@ void D_SetupFrame (void)
 	else
 		screenwidth = vid.rowbytes;
 
+// cached surfaces have to be rebuilt in the new layout
+	if (!d_tiledsurfs.value != !d_surftiled)
+	{
+		d_surftiled = !d_surftiled;
+		D_FlushCaches ();
+	}
+
 	d_roverwrapped = false;
 	d_initial_rover = sc_rover;
 
+	D_ClearHiZ ();
+
 	d_minmip = d_mipcap.value;
 	if (d_minmip > 3)
 		d_minmip = 3;
@@ -143,7 +167,6 @@ void D_SetupFrame (void)
 
 	for (i=0 ; i<(NUM_MIPS-1) ; i++)
 		d_scalemip[i] = basemip[i] * d_mipscale.value;
-				d_drawspans = D_DrawSpans8;
 
 	d_aflatcolor = 0;
 }
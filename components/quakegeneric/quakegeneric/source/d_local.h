@@ -55,6 +55,22 @@ typedef struct sspan_s
 } sspan_t;
 
 extern cvar_t	d_subdiv16;
+extern cvar_t	d_tiledsurfs;
+
+extern qboolean	d_surftiled;	// layout the surface cache is being built in
+extern qboolean	d_spansim;		// draw through the texel cache model
+extern qboolean	d_spanref;		// divide at every pixel, for spanbench
+extern int		d_subdivcount[3];	// surfaces drawn at 8, 16 and 32 pixel runs
+extern cvar_t	d_subdiv;
+extern cvar_t	d_subdivtol;
+extern cvar_t	d_hiz;
+
+#define HIZ_SHIFT	4			// coarse z tiles are 16x16 pixels
+#define HIZ_MASK	((1 << HIZ_SHIFT) - 1)
+
+extern int		d_hizmodels;	// models and sprites skipped this frame
+extern int		d_hizpixels;	// span and particle pixels skipped
+extern int		d_simfetches, d_simmisses;
 
 extern float	scale_for_mip;
 
@@ -70,10 +86,34 @@ extern fixed16_t	sadjust, tadjust;
 extern fixed16_t	bbextents, bbextentt;
 
 
+void D_DrawSpans1 (espan_t *pspans);
 void D_DrawSpans8 (espan_t *pspans);
 void D_DrawSpans16 (espan_t *pspans);
+void D_DrawSpans32 (espan_t *pspans);
+void D_DrawSpans1Tiled (espan_t *pspans);
+void D_DrawSpans8Tiled0 (espan_t *pspans);
+void D_DrawSpans8Tiled1 (espan_t *pspans);
+void D_DrawSpans8Tiled2 (espan_t *pspans);
+void D_DrawSpans8Tiled3 (espan_t *pspans);
+void D_DrawSpans16Tiled0 (espan_t *pspans);
+void D_DrawSpans16Tiled1 (espan_t *pspans);
+void D_DrawSpans16Tiled2 (espan_t *pspans);
+void D_DrawSpans16Tiled3 (espan_t *pspans);
+void D_DrawSpans32Tiled0 (espan_t *pspans);
+void D_DrawSpans32Tiled1 (espan_t *pspans);
+void D_DrawSpans32Tiled2 (espan_t *pspans);
+void D_DrawSpans32Tiled3 (espan_t *pspans);
+void D_DrawSpans8Sim (espan_t *pspans);
+void D_DrawSpans8TiledSim (espan_t *pspans);
+void D_ResetSim (void);
+void D_SelectSpans (espan_t *pspan, int miplevel);
+void D_ClearHiZ (void);
+qboolean D_HiZOccluded (int u0, int v0, int u1, int v1, int izi);
+qboolean D_HiZSpanHidden (int u, int v, int count, int izi, int izistep);
 void D_DrawZSpans (espan_t *pspans);
 void Turbulent8 (espan_t *pspan);
+void D_InitTurbTiles (void);
+void D_DrawTurbulent (espan_t *pspan, texture_t *texture);
 void D_SpriteDrawSpans (sspan_t *pspan);
 
 void D_DrawSkyScans8 (espan_t *pspan);
@@ -46,51 +46,17 @@ void D_StartParticles (void)
 
 /*
 ==============
-D_DrawParticle
+D_DrawParticlePixels
 ==============
 */
-void D_DrawParticle (particle_t *pparticle)
+static void D_DrawParticlePixels (int u, int v, int izi, int pix, int color)
 {
-	vec3_t	local, transformed;
-	float	zi;
 	byte	*pdest;
 	short	*pz;
-	int		i, izi, pix, count, u, v;
-
-// transform point
-	VectorSubtract (pparticle->org, r_origin, local);
-
-	transformed[0] = DotProduct(local, r_pright);
-	transformed[1] = DotProduct(local, r_pup);
-	transformed[2] = DotProduct(local, r_ppn);		
-
-	if (transformed[2] < PARTICLE_Z_CLIP)
-		return;
-
-// project the point
-// FIXME: preadjust xcenter and ycenter
-	zi = 1.0 / transformed[2];
-	u = (int)(xcenter + zi * transformed[0] + 0.5);
-	v = (int)(ycenter - zi * transformed[1] + 0.5);
-
-	if ((v > d_vrectbottom_particle) || 
-		(u > d_vrectright_particle) ||
-		(v < d_vrecty) ||
-		(u < d_vrectx))
-	{
-		return;
-	}
+	int		i, count;
 
 	pz = d_pzbuffer + (d_zwidth * v) + u;
 	pdest = d_viewbuffer + d_scantable[v] + u;
-	izi = (int)(zi * 0x8000);
-
-	pix = izi >> d_pix_shift;
-
-	if (pix < d_pix_min)
-		pix = d_pix_min;
-	else if (pix > d_pix_max)
-		pix = d_pix_max;
 
 	switch (pix)
 	{
@@ -102,7 +68,7 @@ void D_DrawParticle (particle_t *pparticle)
 			if (pz[0] <= izi)
 			{
 				pz[0] = izi;
-				pdest[0] = pparticle->color;
+				pdest[0] = color;
 			}
 		}
 		break;
@@ -115,13 +81,13 @@ void D_DrawParticle (particle_t *pparticle)
 			if (pz[0] <= izi)
 			{
 				pz[0] = izi;
-				pdest[0] = pparticle->color;
+				pdest[0] = color;
 			}
 
 			if (pz[1] <= izi)
 			{
 				pz[1] = izi;
-				pdest[1] = pparticle->color;
+				pdest[1] = color;
 			}
 		}
 		break;
@@ -134,19 +100,19 @@ void D_DrawParticle (particle_t *pparticle)
 			if (pz[0] <= izi)
 			{
 				pz[0] = izi;
-				pdest[0] = pparticle->color;
+				pdest[0] = color;
 			}
 
 			if (pz[1] <= izi)
 			{
 				pz[1] = izi;
-				pdest[1] = pparticle->color;
+				pdest[1] = color;
 			}
 
 			if (pz[2] <= izi)
 			{
 				pz[2] = izi;
-				pdest[2] = pparticle->color;
+				pdest[2] = color;
 			}
 		}
 		break;
@@ -159,25 +125,25 @@ void D_DrawParticle (particle_t *pparticle)
 			if (pz[0] <= izi)
 			{
 				pz[0] = izi;
-				pdest[0] = pparticle->color;
+				pdest[0] = color;
 			}
 
 			if (pz[1] <= izi)
 			{
 				pz[1] = izi;
-				pdest[1] = pparticle->color;
+				pdest[1] = color;
 			}
 
 			if (pz[2] <= izi)
 			{
 				pz[2] = izi;
-				pdest[2] = pparticle->color;
+				pdest[2] = color;
 			}
 
 			if (pz[3] <= izi)
 			{
 				pz[3] = izi;
-				pdest[3] = pparticle->color;
+				pdest[3] = color;
 			}
 		}
 		break;
@@ -192,10 +158,96 @@ void D_DrawParticle (particle_t *pparticle)
 				if (pz[i] <= izi)
 				{
 					pz[i] = izi;
-					pdest[i] = pparticle->color;
+					pdest[i] = color;
 				}
 			}
 		}
 		break;
 	}
 }
+
+/*
+==============
+D_DrawParticles
+
+Particles arrive as a structure of arrays and are handled PARTICLE_BATCH
+at a time: one tight loop transforms and projects the batch, a second
+drops the ones off screen or behind the coarse z buffer and sizes the
+rest, and only the survivors reach the pixel loops.
+==============
+*/
+#define PARTICLE_BATCH	256
+
+void D_DrawParticles (int count, float *orgx, float *orgy, float *orgz,
+	byte *color)
+{
+	int		i, n, batch, u, v, izi, pix;
+	float	lx, ly, lz, tz, zi;
+	float	pu[PARTICLE_BATCH], pv[PARTICLE_BATCH], pzi[PARTICLE_BATCH];
+	int		su[PARTICLE_BATCH], sv[PARTICLE_BATCH], sizi[PARTICLE_BATCH];
+	int		spix[PARTICLE_BATCH];
+	byte	scolor[PARTICLE_BATCH];
+
+	for ( ; count > 0 ; count -= batch, orgx += batch, orgy += batch,
+		orgz += batch, color += batch)
+	{
+		batch = count < PARTICLE_BATCH ? count : PARTICLE_BATCH;
+
+	// transform and project; zi is left 0 for points closer than the near
+	// clip so the cull pass can drop them
+		for (i=0 ; i<batch ; i++)
+		{
+			lx = orgx[i] - r_origin[0];
+			ly = orgy[i] - r_origin[1];
+			lz = orgz[i] - r_origin[2];
+
+			tz = lx*r_ppn[0] + ly*r_ppn[1] + lz*r_ppn[2];
+			zi = tz < PARTICLE_Z_CLIP ? 0 : 1.0 / tz;
+
+		// FIXME: preadjust xcenter and ycenter
+			pu[i] = xcenter + zi * (lx*r_pright[0] + ly*r_pright[1] + lz*r_pright[2]) + 0.5;
+			pv[i] = ycenter - zi * (lx*r_pup[0] + ly*r_pup[1] + lz*r_pup[2]) + 0.5;
+			pzi[i] = zi;
+		}
+
+	// cull
+		n = 0;
+		for (i=0 ; i<batch ; i++)
+		{
+			if (!pzi[i])
+				continue;
+
+			u = (int)pu[i];
+			v = (int)pv[i];
+			if ((v > d_vrectbottom_particle) ||
+				(u > d_vrectright_particle) ||
+				(v < d_vrecty) ||
+				(u < d_vrectx))
+				continue;
+
+			izi = (int)(pzi[i] * 0x8000);
+			pix = izi >> d_pix_shift;
+			if (pix < d_pix_min)
+				pix = d_pix_min;
+			else if (pix > d_pix_max)
+				pix = d_pix_max;
+
+			if (D_HiZOccluded (u, v, u + pix - 1, v + (pix << d_y_aspect_shift) - 1, izi))
+			{
+				d_hizpixels += pix * (pix << d_y_aspect_shift);
+				continue;
+			}
+
+			su[n] = u;
+			sv[n] = v;
+			sizi[n] = izi;
+			spix[n] = pix;
+			scolor[n] = color[i];
+			n++;
+		}
+
+	// rasterize
+		for (i=0 ; i<n ; i++)
+			D_DrawParticlePixels (su[i], sv[i], sizi[i], spix[i], scolor[i]);
+	}
+}
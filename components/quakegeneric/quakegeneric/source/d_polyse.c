@@ -115,6 +115,21 @@ void D_PolysetSetEdgeTable (void);
 void D_RasterizeAliasPolySmooth (void);
 void D_PolysetScanLeftEdge (int height);
 
+static spanpackage_t	*d_polysetspans;
+
+/*
+================
+D_PolysetInit
+================
+*/
+void D_PolysetInit (void)
+{
+// one extra because of cache line pretouching
+	d_polysetspans = Tier_Alloc ((DPS_MAXSPANS + 1 +
+			((CACHE_SIZE - 1) / sizeof(spanpackage_t)) + 1) * sizeof(spanpackage_t),
+			mem_fast, "alias spans");
+}
+
 /*
 ================
 D_PolysetDraw
@@ -122,12 +137,8 @@ D_PolysetDraw
 */
 void D_PolysetDraw (void)
 {
-	spanpackage_t	spans[DPS_MAXSPANS + 1 +
-			((CACHE_SIZE - 1) / sizeof(spanpackage_t)) + 1];
-						// one extra because of cache line pretouching
-
 	a_spans = (spanpackage_t *)
-			(((intptr_t)&spans[0] + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
+			(((intptr_t)d_polysetspans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
 
 	if (r_affinetridesc.drawtype)
 	{
@@ -595,6 +606,7 @@ void D_PolysetDrawSpans8 (spanpackage_t *pspanpackage)
 	int		llight;
 	int		lzi;
 	short	*lpz;
+	int		offset;
 
 	do
 	{
@@ -611,6 +623,15 @@ void D_PolysetDrawSpans8 (spanpackage_t *pspanpackage)
 			d_aspancount += ubasestep;
 		}
 
+	// long spans are worth a look at the coarse z buffer first
+		if (lcount >= 8)
+		{
+			offset = pspanpackage->pz - d_pzbuffer;
+			if (D_HiZSpanHidden (offset % d_zwidth, offset / d_zwidth, lcount,
+				pspanpackage->zi, r_zistepx))
+				lcount = 0;
+		}
+
 		if (lcount)
 		{
 			lpdest = pspanpackage->pdest;
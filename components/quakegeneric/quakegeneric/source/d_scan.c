@@ -42,50 +42,82 @@ D_WarpScreen
 // the sine warp, to keep the edges from wrapping
 =============
 */
+static int	d_warprow[WARP_HEIGHT+(AMP2*2)];	// view buffer offset of each row
+static int	d_warpcol[WARP_WIDTH+(AMP2*2)];		// and of each column
+static int	d_warpsize[6];
+
 void D_WarpScreen (void)
 {
-	int		w, h;
-	int		u,v;
-	byte	*dest;
-	int		*turb;
-	int		*col;
-	byte	**row;
-	byte	*rowptr[MAXHEIGHT+(AMP2*2)];
-	int		column[MAXWIDTH+(AMP2*2)];
-	float	wratio, hratio;
+	int			w, h;
+	int			u,v;
+	byte		*dest, *src;
+	int			*turb;
+	int			*col;
+	int			*row;
+	float		wratio, hratio;
+	unsigned	ltemp;
 
 	w = r_refdef.vrect.width;
 	h = r_refdef.vrect.height;
 
-	wratio = w / (float)scr_vrect.width;
-	hratio = h / (float)scr_vrect.height;
-
-	for (v=0 ; v<scr_vrect.height+AMP2*2 ; v++)
+// the compression tables only change with the view size
+	if (d_warpsize[0] != w || d_warpsize[1] != h ||
+		d_warpsize[2] != scr_vrect.width || d_warpsize[3] != scr_vrect.height ||
+		d_warpsize[4] != r_refdef.vrect.y * screenwidth + r_refdef.vrect.x ||
+		d_warpsize[5] != screenwidth)
 	{
-		rowptr[v] = d_viewbuffer + (r_refdef.vrect.y * screenwidth) +
-				 (screenwidth * (int)((float)v * hratio * h / (h + AMP2 * 2)));
-	}
+		d_warpsize[0] = w;
+		d_warpsize[1] = h;
+		d_warpsize[2] = scr_vrect.width;
+		d_warpsize[3] = scr_vrect.height;
+		d_warpsize[4] = r_refdef.vrect.y * screenwidth + r_refdef.vrect.x;
+		d_warpsize[5] = screenwidth;
 
-	for (u=0 ; u<scr_vrect.width+AMP2*2 ; u++)
-	{
-		column[u] = r_refdef.vrect.x +
-				(int)((float)u * wratio * w / (w + AMP2 * 2));
+		wratio = w / (float)scr_vrect.width;
+		hratio = h / (float)scr_vrect.height;
+
+		for (v=0 ; v<scr_vrect.height+AMP2*2 ; v++)
+		{
+			d_warprow[v] = (r_refdef.vrect.y * screenwidth) +
+					 (screenwidth * (int)((float)v * hratio * h / (h + AMP2 * 2)));
+		}
+
+		for (u=0 ; u<scr_vrect.width+AMP2*2 ; u++)
+		{
+			d_warpcol[u] = r_refdef.vrect.x +
+					(int)((float)u * wratio * w / (w + AMP2 * 2));
+		}
 	}
 
 	turb = intsintable + ((int)(cl.time*SPEED)&(CYCLE-1));
+	src = d_viewbuffer;
 	dest = vid.buffer + scr_vrect.y * vid.rowbytes + scr_vrect.x;
 
 	for (v=0 ; v<scr_vrect.height ; v++, dest += vid.rowbytes)
 	{
-		col = &column[turb[v]];
-		row = &rowptr[v];
+		col = &d_warpcol[turb[v]];
+		row = &d_warprow[v];
+
+		if ((intptr_t)dest & 3)
+		{
+			for (u=0 ; u<scr_vrect.width ; u+=4)
+			{
+				dest[u+0] = src[row[turb[u+0]] + col[u+0]];
+				dest[u+1] = src[row[turb[u+1]] + col[u+1]];
+				dest[u+2] = src[row[turb[u+2]] + col[u+2]];
+				dest[u+3] = src[row[turb[u+3]] + col[u+3]];
+			}
+			continue;
+		}
 
+	// four pixels to a store into the frame buffer
 		for (u=0 ; u<scr_vrect.width ; u+=4)
 		{
-			dest[u+0] = row[turb[u+0]][col[u+0]];
-			dest[u+1] = row[turb[u+1]][col[u+1]];
-			dest[u+2] = row[turb[u+2]][col[u+2]];
-			dest[u+3] = row[turb[u+3]][col[u+3]];
+			ltemp = src[row[turb[u+0]] + col[u+0]];
+			ltemp |= src[row[turb[u+1]] + col[u+1]] << 8;
+			ltemp |= src[row[turb[u+2]] + col[u+2]] << 16;
+			ltemp |= src[row[turb[u+3]] + col[u+3]] << 24;
+			*(unsigned *)(dest + u) = ltemp;
 		}
 	}
 }
@@ -243,135 +275,556 @@ void Turbulent8 (espan_t *pspan)
 
 /*
 =============
-D_DrawSpans8
+Turbulent tiles
+
+R_GenTurbTile warps one whole 128x128 period of a water texture, and the
+result serves every surface with that texture for the rest of the frame,
+drawn by an ordinary perspective span drawer instead of the per pixel
+sine lookups of Turbulent8.  Building a tile costs about as much as
+warping 16k pixels directly, so only surfaces covering at least
+TURB_TILE_MIN pixels build one; smaller ones use a tile if it is already
+there this frame.
 =============
 */
-void D_DrawSpans8 (espan_t *pspan)
+#define TURB_TILES		4
+#define TURB_TILE_MIN	4096
+
+typedef struct
 {
-	int				count, spancount;
-	unsigned char	*pbase, *pdest;
-	fixed16_t		s, t, snext, tnext, sstep, tstep;
-	float			sdivz, tdivz, zi, z, du, dv, spancountminus1;
-	float			sdivz8stepu, tdivz8stepu, zi8stepu;
+	texture_t	*texture;
+	int			frame;
+	byte		*pixels;
+} turbtile_t;
+
+static turbtile_t	d_turbtiles[TURB_TILES];
 
-	sstep = 0;	// keep compiler happy
-	tstep = 0;	// ditto
+void D_InitTurbTiles (void)
+{
+	int		i;
+	byte	*pixels;
 
-	pbase = (unsigned char *)cacheblock;
+	pixels = Tier_Alloc (TURB_TILES*TILE_SIZE*TILE_SIZE, mem_fast, "turb tiles");
+	for (i=0 ; i<TURB_TILES ; i++)
+	{
+		d_turbtiles[i].frame = -1;
+		d_turbtiles[i].pixels = pixels + i*TILE_SIZE*TILE_SIZE;
+	}
+}
 
-	sdivz8stepu = d_sdivzstepu * 8;
-	tdivz8stepu = d_tdivzstepu * 8;
-	zi8stepu = d_zistepu * 8;
+static byte *D_TurbTile (texture_t *texture, espan_t *pspan)
+{
+	int			i, count;
+	turbtile_t	*tile, *free;
 
-	do
+	free = NULL;
+	for (i=0, tile=d_turbtiles ; i<TURB_TILES ; i++, tile++)
 	{
-		pdest = (unsigned char *)((byte *)d_viewbuffer +
-				(screenwidth * pspan->v) + pspan->u);
+		if (tile->frame != r_framecount)
+			free = tile;
+		else if (tile->texture == texture)
+			return tile->pixels;
+	}
 
-		count = pspan->count;
+	if (!free)
+		return NULL;
 
-	// calculate the initial s/z, t/z, 1/z, s, and t and clamp
-		du = (float)pspan->u;
-		dv = (float)pspan->v;
+	count = 0;
+	for ( ; pspan ; pspan = pspan->pnext)
+		count += pspan->count;
+	if (count < TURB_TILE_MIN)
+		return NULL;
 
-		sdivz = d_sdivzorigin + dv*d_sdivzstepv + du*d_sdivzstepu;
-		tdivz = d_tdivzorigin + dv*d_tdivzstepv + du*d_tdivzstepu;
-		zi = d_ziorigin + dv*d_zistepv + du*d_zistepu;
-		z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+	R_GenTurbTile ((pixel_t *)((byte *)texture + texture->offsets[0]),
+		free->pixels);
+	free->texture = texture;
+	free->frame = r_framecount;
 
-		s = (int)(sdivz * z) + sadjust;
-		if (s > bbextents)
-			s = bbextents;
-		else if (s < 0)
-			s = 0;
+	return free->pixels;
+}
 
-		t = (int)(tdivz * z) + tadjust;
-		if (t > bbextentt)
-			t = bbextentt;
-		else if (t < 0)
-			t = 0;
+#define SPAN_NAME		D_DrawTurbTile16
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_TEXEL(s,t)	*(pbase + ((((t) >> 16) & (TILE_SIZE-1)) << 7) \
+							+ (((s) >> 16) & (TILE_SIZE-1)))
+#include "d_spans.h"
 
-		do
+/*
+=============
+D_DrawTurbulent
+
+cacheblock is the surface's texture; it is swapped for the tile when
+there is one
+=============
+*/
+void D_DrawTurbulent (espan_t *pspan, texture_t *texture)
+{
+	byte	*tile;
+
+	tile = D_TurbTile (texture, pspan);
+	if (!tile)
+	{
+		Turbulent8 (pspan);
+		return;
+	}
+
+	cacheblock = tile;
+	D_DrawTurbTile16 (pspan);
+}
+
+/*
+=============
+D_DrawSpans
+
+The surface cache is either row-major, cachewidth texels to a row, or
+tiled: the blocks R_DrawSurface lights at a time (16 texels square at mip
+0, cachetileshift gives the size) stored column after column, so that
+spans crossing the texture vertically stay within a few cache lines.
+
+Each layout gets a drawer per subdivision length, and the tiled ones one
+per mip level as well so the block shift and mask are constants;
+D_SelectSpans picks among them for every surface.  The 1 pixel drawers
+divide at every pixel and are only used as the reference for spanbench.
+=============
+*/
+#define LINEAR_TEXEL(s,t)	*(pbase + ((s) >> 16) + ((t) >> 16) * cachewidth)
+
+#define TILED_LOCALS		int tileheight;
+#define TILED_SETUP			tileheight = cacheheight;
+#define TILED_TEXEL(s,t,sh)	*(pbase + (((s) >> 16) & ~((1 << (sh)) - 1)) * tileheight \
+								+ (((t) >> 16) << (sh)) + (((s) >> 16) & ((1 << (sh)) - 1)))
+
+#define SPAN_NAME		D_DrawSpans1
+#define SPAN_SUBDIV		1
+#define SPAN_SHIFT		0
+#define SPAN_TEXEL(s,t)	LINEAR_TEXEL(s,t)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_TEXEL(s,t)	LINEAR_TEXEL(s,t)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans16
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_TEXEL(s,t)	LINEAR_TEXEL(s,t)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans32
+#define SPAN_SUBDIV		32
+#define SPAN_SHIFT		5
+#define SPAN_TEXEL(s,t)	LINEAR_TEXEL(s,t)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans1Tiled
+#define SPAN_SUBDIV		1
+#define SPAN_SHIFT		0
+#define SPAN_LOCALS		int tileshift, tileheight;
+#define SPAN_SETUP		tileshift = cachetileshift; tileheight = cacheheight;
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,tileshift)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8Tiled0
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,4)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8Tiled1
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,3)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8Tiled2
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,2)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8Tiled3
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,1)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans16Tiled0
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,4)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans16Tiled1
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,3)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans16Tiled2
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,2)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans16Tiled3
+#define SPAN_SUBDIV		16
+#define SPAN_SHIFT		4
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,1)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans32Tiled0
+#define SPAN_SUBDIV		32
+#define SPAN_SHIFT		5
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,4)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans32Tiled1
+#define SPAN_SUBDIV		32
+#define SPAN_SHIFT		5
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,3)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans32Tiled2
+#define SPAN_SUBDIV		32
+#define SPAN_SHIFT		5
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,2)
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans32Tiled3
+#define SPAN_SUBDIV		32
+#define SPAN_SHIFT		5
+#define SPAN_LOCALS		TILED_LOCALS
+#define SPAN_SETUP		TILED_SETUP
+#define SPAN_TEXEL(s,t)	TILED_TEXEL(s,t,1)
+#include "d_spans.h"
+
+/*
+=============
+Texel cache simulation
+
+For surfbench: the same drawers, feeding every texel address through a
+model of a small direct mapped data cache
+=============
+*/
+#define	SIM_LINESHIFT	6		// 64 byte lines
+#define	SIM_LINES		256		// 16k
+
+static uintptr_t	d_simtags[SIM_LINES];
+int					d_simfetches, d_simmisses;
+
+static byte *D_SimFetch (byte *p)
+{
+	uintptr_t	line;
+
+	line = (uintptr_t)p >> SIM_LINESHIFT;
+	if (d_simtags[line & (SIM_LINES-1)] != line)
+	{
+		d_simtags[line & (SIM_LINES-1)] = line;
+		d_simmisses++;
+	}
+	d_simfetches++;
+	return p;
+}
+
+void D_ResetSim (void)
+{
+	memset (d_simtags, 0, sizeof(d_simtags));
+	d_simfetches = d_simmisses = 0;
+}
+
+#define SPAN_NAME		D_DrawSpans8Sim
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_TEXEL(s,t)	*D_SimFetch (&LINEAR_TEXEL(s,t))
+#include "d_spans.h"
+
+#define SPAN_NAME		D_DrawSpans8TiledSim
+#define SPAN_SUBDIV		8
+#define SPAN_SHIFT		3
+#define SPAN_LOCALS		int tileshift, tileheight;
+#define SPAN_SETUP		tileshift = cachetileshift; tileheight = cacheheight;
+#define SPAN_TEXEL(s,t)	*D_SimFetch (&TILED_TEXEL(s,t,tileshift))
+#include "d_spans.h"
+
+/*
+=============
+D_SelectSpans
+
+Points d_drawspans at the drawer for the current surface.  With d_subdiv
+0 the subdivision follows the surface's perspective distortion: the
+texture coordinate is a ratio of linear functions of u, so interpolating
+it linearly over n pixels is off by about
+	n*n/4 * |d(1/z)/du| / (1/z) * |ds/du|
+texels of the cached mip.  That is worst where 1/z is smallest, and 1/z
+is linear on screen, so it is measured once, at the corner of the
+surface's screen bounds that 1/z falls towards; the longest run keeping it
+under d_subdivtol there wins.  Walls seen head on and floors, where 1/z is
+constant along a scanline, skip the measurement and get 32.
+=============
+*/
+static void (*d_linearspans[3]) (espan_t *pspan) =
+{
+	D_DrawSpans8, D_DrawSpans16, D_DrawSpans32
+};
+
+static void (*d_tiledspans[3][4]) (espan_t *pspan) =
+{
+	{D_DrawSpans8Tiled0, D_DrawSpans8Tiled1, D_DrawSpans8Tiled2, D_DrawSpans8Tiled3},
+	{D_DrawSpans16Tiled0, D_DrawSpans16Tiled1, D_DrawSpans16Tiled2, D_DrawSpans16Tiled3},
+	{D_DrawSpans32Tiled0, D_DrawSpans32Tiled1, D_DrawSpans32Tiled2, D_DrawSpans32Tiled3}
+};
+
+int		d_subdivcount[3];
+
+/*
+=============
+D_SpanDistortion
+
+Interpolation error per squared pixel of run at screen point u, v, using
+the gradients D_CalcGradients set up
+=============
+*/
+static float D_SpanDistortion (float u, float v)
+{
+	float	zi, sdivz, tdivz, dsdu, dtdu;
+
+	zi = d_ziorigin + v*d_zistepv + u*d_zistepu;
+	if (zi <= 0)
+		return 1.0e10;		// behind the view plane; don't stretch spans
+
+	sdivz = d_sdivzorigin + v*d_sdivzstepv + u*d_sdivzstepu;
+	tdivz = d_tdivzorigin + v*d_tdivzstepv + u*d_tdivzstepu;
+
+// texels per pixel, from the quotient rule on (s/z) / (1/z)
+	dsdu = fabs(d_sdivzstepu*zi - sdivz*d_zistepu) / (zi*zi);
+	dtdu = fabs(d_tdivzstepu*zi - tdivz*d_zistepu) / (zi*zi);
+	if (dtdu > dsdu)
+		dsdu = dtdu;
+
+	return 0.25 * fabs(d_zistepu) / zi * dsdu;
+}
+
+void D_SelectSpans (espan_t *pspan, int miplevel)
+{
+	int		i;
+	int		umin, umax, vmin, vmax;
+	float	distortion;
+
+	if (d_spanref)
+	{
+		d_drawspans = d_surftiled ? D_DrawSpans1Tiled : D_DrawSpans1;
+		return;
+	}
+
+	if (d_spansim)
+	{
+		d_drawspans = d_surftiled ? D_DrawSpans8TiledSim : D_DrawSpans8Sim;
+		return;
+	}
+
+	switch ((int)d_subdiv.value)
+	{
+	case 8:
+		i = 0;
+		break;
+	case 16:
+		i = 1;
+		break;
+	case 32:
+		i = 2;
+		break;
+	default:
+		if (d_zistepu == 0)
 		{
-		// calculate s and t at the far end of the span
-			if (count >= 8)
-				spancount = 8;
-			else
-				spancount = count;
+			i = 2;
+			break;
+		}
 
-			count -= spancount;
+		umin = vmin = 0x7fffffff;
+		umax = vmax = -0x7fffffff;
+		for ( ; pspan ; pspan = pspan->pnext)
+		{
+			if (pspan->u < umin)
+				umin = pspan->u;
+			if (pspan->u + pspan->count - 1 > umax)
+				umax = pspan->u + pspan->count - 1;
+			if (pspan->v < vmin)
+				vmin = pspan->v;
+			if (pspan->v > vmax)
+				vmax = pspan->v;
+		}
 
-			if (count)
-			{
-			// calculate s/z, t/z, zi->fixed s and t at far end of span,
-			// calculate s and t steps across span by shifting
-				sdivz += sdivz8stepu;
-				tdivz += tdivz8stepu;
-				zi += zi8stepu;
-				z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+		distortion = D_SpanDistortion (d_zistepu > 0 ? umin : umax,
+				d_zistepv > 0 ? vmin : vmax);
 
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
-				else if (snext < 8)
-					snext = 8;	// prevent round-off error on <0 steps from
-								//  from causing overstepping & running off the
-								//  edge of the texture
+		if (distortion * 32*32 <= d_subdivtol.value)
+			i = 2;
+		else if (distortion * 16*16 <= d_subdivtol.value)
+			i = 1;
+		else
+			i = 0;
+		break;
+	}
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
-				else if (tnext < 8)
-					tnext = 8;	// guard against round-off error on <0 steps
+	d_subdivcount[i]++;
+	if (d_surftiled)
+		d_drawspans = d_tiledspans[i][miplevel];
+	else
+		d_drawspans = d_linearspans[i];
+}
 
-				sstep = (snext - s) >> 3;
-				tstep = (tnext - t) >> 3;
-			}
-			else
-			{
-			// calculate s/z, t/z, zi->fixed s and t at last pixel in span (so
-			// can't step off polygon), clamp, calculate s and t steps across
-			// span by division, biasing steps low so we don't run off the
-			// texture
-				spancountminus1 = (float)(spancount - 1);
-				sdivz += d_sdivzstepu * spancountminus1;
-				tdivz += d_tdivzstepu * spancountminus1;
-				zi += d_zistepu * spancountminus1;
-				z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
-				else if (snext < 8)
-					snext = 8;	// prevent round-off error on <0 steps from
-								//  from causing overstepping & running off the
-								//  edge of the texture
+/*
+=============
+Hierarchical Z
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
-				else if (tnext < 8)
-					tnext = 8;	// guard against round-off error on <0 steps
+The farthest 1/z the world pass left in each 16x16 tile of the z buffer,
+folded in span by span as D_DrawZSpans writes them.  Alias models, sprites
+and particles are all drawn after the world and only ever bring z closer,
+so anything whose nearest point is behind every tile it covers would fail
+each of its per pixel z tests and can be skipped outright.
+=============
+*/
+#define HIZ_COLS	((WARP_WIDTH + HIZ_MASK) >> HIZ_SHIFT)
+#define HIZ_ROWS	((WARP_HEIGHT + HIZ_MASK) >> HIZ_SHIFT)
+#define HIZ_UNKNOWN	0x7FFF		// no world span reached the tile yet
 
-				if (spancount > 1)
-				{
-					sstep = (snext - s) / (spancount - 1);
-					tstep = (tnext - t) / (spancount - 1);
-				}
-			}
+static short	d_hiztiles[HIZ_ROWS][HIZ_COLS];
+int				d_hizmodels, d_hizpixels;
 
-			do
-			{
-				*pdest++ = *(pbase + (s >> 16) + (t >> 16) * cachewidth);
-				s += sstep;
-				t += tstep;
-			} while (--spancount > 0);
+void D_ClearHiZ (void)
+{
+	int		i;
+	short	*tile;
 
-			s = snext;
-			t = tnext;
+	tile = &d_hiztiles[0][0];
+	for (i=0 ; i<HIZ_ROWS*HIZ_COLS ; i++)
+		tile[i] = HIZ_UNKNOWN;
+}
 
-		} while (count > 0);
+/*
+=============
+D_HiZSpan
 
-	} while ((pspan = pspan->pnext) != NULL);
+1/z is linear along the span, so the farthest point of each piece of it
+within a tile is at one end of the piece
+=============
+*/
+static void D_HiZSpan (int u, int v, int count, int izi, int izistep)
+{
+	int		last, end, z0, z1;
+	short	*tile;
+
+	if (count <= 0)
+		return;
+
+	tile = &d_hiztiles[v >> HIZ_SHIFT][u >> HIZ_SHIFT];
+	end = u + count - 1;
+
+	do
+	{
+		last = u | HIZ_MASK;
+		if (last > end)
+			last = end;
+
+		z0 = izi >> 16;
+		izi += (last - u) * izistep;
+		z1 = izi >> 16;
+		if (z1 < z0)
+			z0 = z1;
+		if (z0 < *tile)
+			*tile = z0;
+
+		izi += izistep;
+		u = last + 1;
+		tile++;
+	} while (u <= end);
+}
+
+/*
+=============
+D_HiZOccluded
+
+True if a screen rectangle whose nearest point is at izi (1/z * 0x8000)
+lies entirely behind the world
+=============
+*/
+qboolean D_HiZOccluded (int u0, int v0, int u1, int v1, int izi)
+{
+	int		x, y;
+	short	*row;
+
+	if (!d_hiz.value)
+		return false;
+
+	if (u0 < r_refdef.vrect.x)
+		u0 = r_refdef.vrect.x;
+	if (v0 < r_refdef.vrect.y)
+		v0 = r_refdef.vrect.y;
+	if (u1 >= r_refdef.vrectright)
+		u1 = r_refdef.vrectright - 1;
+	if (v1 >= r_refdef.vrectbottom)
+		v1 = r_refdef.vrectbottom - 1;
+	if (u0 > u1 || v0 > v1)
+		return false;
+
+	for (y = v0 >> HIZ_SHIFT ; y <= v1 >> HIZ_SHIFT ; y++)
+	{
+		row = d_hiztiles[y];
+		for (x = u0 >> HIZ_SHIFT ; x <= u1 >> HIZ_SHIFT ; x++)
+		{
+			if (row[x] <= izi || row[x] == HIZ_UNKNOWN)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+=============
+D_HiZSpanHidden
+
+Per span version for the model and sprite drawers, with izi and izistep
+in their 16.16 form; counts the pixels it saves
+=============
+*/
+qboolean D_HiZSpanHidden (int u, int v, int count, int izi, int izistep)
+{
+	int		last;
+
+	last = izi + (count - 1) * izistep;
+	if (last > izi)
+		izi = last;
+
+	if (!D_HiZOccluded (u, v, u + count - 1, v, izi >> 16))
+		return false;
+
+	d_hizpixels += count;
+	return true;
 }
 
 /*
@@ -406,6 +859,8 @@ void D_DrawZSpans (espan_t *pspan)
 	// we count on FP exceptions being turned off to avoid range problems
 		izi = (int)(zi * 0x8000 * 0x10000);
 
+		D_HiZSpan (pspan->u, pspan->v, count, izi, izistep);
+
 		if ((intptr_t)pdest & 0x02)
 		{
 			*pdest++ = (short)(izi >> 16);
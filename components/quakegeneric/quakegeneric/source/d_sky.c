@@ -26,36 +26,131 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define SKY_SPAN_SHIFT	5
 #define SKY_SPAN_MAX	(1 << SKY_SPAN_SHIFT)
 
+// the composited sky is 128 texels to a row
+#define SKY_TEXEL(s,t)	r_skysource[(((t) & R_SKY_TMASK) >> 9) + \
+							(((s) & R_SKY_SMASK) >> 16)]
+
+/*
+The direction through a screen pixel is 4096*vpn + wu*vright + wv*vup,
+stretched vertically, with wu depending only on the column and wv only on
+the row.  Once a frame the column terms go in a table; each span adds its
+row term once, so a sample costs three adds and the normalize.
+*/
+static int		d_skyframe = -1;
+static float	d_skycol[WARP_WIDTH][3];
+static vec3_t	d_skybase, d_skyup;
+static float	d_skyscale, d_skyoffset;
+static int		d_skyhalfheight;
 
 /*
 =================
-D_Sky_uv_To_st
+D_SkySetupFrame
 =================
 */
-void D_Sky_uv_To_st (int u, int v, fixed16_t *s, fixed16_t *t)
+static void D_SkySetupFrame (void)
 {
-	float	wu, wv, temp;
-	vec3_t	end;
+	int		u, halfwidth;
+	float	temp, wu;
+
+	d_skyframe = r_framecount;
 
 	if (r_refdef.vrect.width >= r_refdef.vrect.height)
 		temp = (float)r_refdef.vrect.width;
 	else
 		temp = (float)r_refdef.vrect.height;
+	d_skyscale = 8192.0 / temp;
+
+	halfwidth = (int)vid.width >> 1;
+	d_skyhalfheight = (int)vid.height >> 1;
+
+	for (u=0 ; u<(int)vid.width && u<WARP_WIDTH ; u++)
+	{
+		wu = d_skyscale * (float)(u - halfwidth);
+		d_skycol[u][0] = wu*vright[0];
+		d_skycol[u][1] = wu*vright[1];
+		d_skycol[u][2] = wu*vright[2] * 3;
+	}
+
+	d_skybase[0] = 4096*vpn[0];
+	d_skybase[1] = 4096*vpn[1];
+	d_skybase[2] = 4096*vpn[2] * 3;
+	d_skyup[0] = vup[0];
+	d_skyup[1] = vup[1];
+	d_skyup[2] = vup[2] * 3;
+
+	d_skyoffset = skytime*skyspeed;
+}
+
+/*
+=================
+D_Sky_uv_To_st
 
-	wu = 8192.0 * (float)(u-((int)vid.width>>1)) / temp;
-	wv = 8192.0 * (float)(((int)vid.height>>1)-v) / temp;
+row is the span's row term from D_DrawSkyScans8
+=================
+*/
+static void D_Sky_uv_To_st (vec3_t row, int u, fixed16_t *s, fixed16_t *t)
+{
+	float	*col, x, y, z, scale;
 
-	end[0] = 4096*vpn[0] + wu*vright[0] + wv*vup[0];
-	end[1] = 4096*vpn[1] + wu*vright[1] + wv*vup[1];
-	end[2] = 4096*vpn[2] + wu*vright[2] + wv*vup[2];
-	end[2] *= 3;
-	VectorNormalize (end);
+	col = d_skycol[u];
+	x = row[0] + col[0];
+	y = row[1] + col[1];
+	z = row[2] + col[2];
 
-	temp = skytime*skyspeed;	// TODO: add D_SetupFrame & set this there
-	*s = (int)((temp + 6*(SKYSIZE/2-1)*end[0]) * 0x10000);
-	*t = (int)((temp + 6*(SKYSIZE/2-1)*end[1]) * 0x10000);
+	scale = 6*(SKYSIZE/2-1) / sqrt (x*x + y*y + z*z);
+	*s = (int)((d_skyoffset + x*scale) * 0x10000);
+	*t = (int)((d_skyoffset + y*scale) * 0x10000);
 }
 
+/*
+=================
+D_DrawSkyRun
+
+Long runs, which is most of a big sky, go out four texels to a store
+=================
+*/
+static void D_DrawSkyRun (byte *pdest, fixed16_t s, fixed16_t t,
+	fixed16_t sstep, fixed16_t tstep, int count)
+{
+	unsigned	ltemp;
+
+	if (count >= 8)
+	{
+		while ((intptr_t)pdest & 3)
+		{
+			*pdest++ = SKY_TEXEL (s, t);
+			s += sstep;
+			t += tstep;
+			count--;
+		}
+
+		while (count >= 4)
+		{
+			ltemp = SKY_TEXEL (s, t);
+			s += sstep;
+			t += tstep;
+			ltemp |= SKY_TEXEL (s, t) << 8;
+			s += sstep;
+			t += tstep;
+			ltemp |= SKY_TEXEL (s, t) << 16;
+			s += sstep;
+			t += tstep;
+			ltemp |= SKY_TEXEL (s, t) << 24;
+			s += sstep;
+			t += tstep;
+			*(unsigned *)pdest = ltemp;
+			pdest += 4;
+			count -= 4;
+		}
+	}
+
+	while (count-- > 0)
+	{
+		*pdest++ = SKY_TEXEL (s, t);
+		s += sstep;
+		t += tstep;
+	}
+}
 
 /*
 =================
@@ -68,10 +163,15 @@ void D_DrawSkyScans8 (espan_t *pspan)
 	unsigned char	*pdest;
 	fixed16_t		s, t, snext, tnext, sstep, tstep;
 	int				spancountminus1;
+	float			wv;
+	vec3_t			row;
 
 	sstep = 0;	// keep compiler happy
 	tstep = 0;	// ditto
 
+	if (d_skyframe != r_framecount)
+		D_SkySetupFrame ();
+
 	do
 	{
 		pdest = (unsigned char *)((byte *)d_viewbuffer +
@@ -79,10 +179,14 @@ void D_DrawSkyScans8 (espan_t *pspan)
 
 		count = pspan->count;
 
-	// calculate the initial s & t
+	// calculate the row's part of the direction and the initial s & t
 		u = pspan->u;
 		v = pspan->v;
-		D_Sky_uv_To_st (u, v, &s, &t);
+		wv = d_skyscale * (float)(d_skyhalfheight - v);
+		row[0] = d_skybase[0] + wv*d_skyup[0];
+		row[1] = d_skybase[1] + wv*d_skyup[1];
+		row[2] = d_skybase[2] + wv*d_skyup[2];
+		D_Sky_uv_To_st (row, u, &s, &t);
 
 		do
 		{
@@ -99,7 +203,7 @@ void D_DrawSkyScans8 (espan_t *pspan)
 
 			// calculate s and t at far end of span,
 			// calculate s and t steps across span by shifting
-				D_Sky_uv_To_st (u, v, &snext, &tnext);
+				D_Sky_uv_To_st (row, u, &snext, &tnext);
 
 				sstep = (snext - s) >> SKY_SPAN_SHIFT;
 				tstep = (tnext - t) >> SKY_SPAN_SHIFT;
@@ -113,20 +217,15 @@ void D_DrawSkyScans8 (espan_t *pspan)
 				if (spancountminus1 > 0)
 				{
 					u += spancountminus1;
-					D_Sky_uv_To_st (u, v, &snext, &tnext);
+					D_Sky_uv_To_st (row, u, &snext, &tnext);
 
 					sstep = (snext - s) / spancountminus1;
 					tstep = (tnext - t) / spancountminus1;
 				}
 			}
 
-			do
-			{
-				*pdest++ = r_skysource[((t & R_SKY_TMASK) >> 8) +
-						((s & R_SKY_SMASK) >> 16)];
-				s += sstep;
-				t += tstep;
-			} while (--spancount > 0);
+			D_DrawSkyRun (pdest, s, t, sstep, tstep, spancount);
+			pdest += spancount;
 
 			s = snext;
 			t = tnext;
@@ -135,4 +234,3 @@ void D_DrawSkyScans8 (espan_t *pspan)
 
 	} while ((pspan = pspan->pnext) != NULL);
 }
-
@@ -0,0 +1,195 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// d_spans.h -- body of the perspective textured span drawer
+//
+// Included by d_scan.c once per variant, with
+//	SPAN_NAME			the function to define
+//	SPAN_SUBDIV			pixels between perspective divides, a power of two
+//	SPAN_SHIFT			log2 of SPAN_SUBDIV
+//	SPAN_TEXEL(s,t)		the cache texel at 16.16 s and t, addressed from pbase
+//	SPAN_LOCALS			(optional) declarations SPAN_TEXEL needs
+//	SPAN_SETUP			(optional) statement that initializes them
+//
+// The gradients are copied to locals up front so the compiler can keep
+// them in registers instead of reloading the globals around every store.
+
+#ifndef SPAN_LOCALS
+#define SPAN_LOCALS
+#endif
+#ifndef SPAN_SETUP
+#define SPAN_SETUP
+#endif
+
+void SPAN_NAME (espan_t *pspan)
+{
+	int				count, spancount;
+	unsigned char	*pbase, *pdest, *viewbuffer;
+	fixed16_t		s, t, snext, tnext, sstep, tstep;
+	fixed16_t		sadj, tadj, sext, text;
+	float			sdivz, tdivz, zi, z, du, dv, spancountminus1;
+	float			sdivzstepu, tdivzstepu, zistepu;
+	float			sdivzstepv, tdivzstepv, zistepv;
+	float			sdivzorigin, tdivzorigin, ziorigin;
+	float			sdivzNstepu, tdivzNstepu, ziNstepu;
+	int				rowbytes;
+	SPAN_LOCALS
+
+	sstep = 0;	// keep compiler happy
+	tstep = 0;	// ditto
+
+	pbase = (unsigned char *)cacheblock;
+	SPAN_SETUP
+
+	viewbuffer = (unsigned char *)d_viewbuffer;
+	rowbytes = screenwidth;
+	sadj = sadjust;
+	tadj = tadjust;
+	sext = bbextents;
+	text = bbextentt;
+	sdivzstepu = d_sdivzstepu;
+	tdivzstepu = d_tdivzstepu;
+	zistepu = d_zistepu;
+	sdivzstepv = d_sdivzstepv;
+	tdivzstepv = d_tdivzstepv;
+	zistepv = d_zistepv;
+	sdivzorigin = d_sdivzorigin;
+	tdivzorigin = d_tdivzorigin;
+	ziorigin = d_ziorigin;
+
+	sdivzNstepu = sdivzstepu * SPAN_SUBDIV;
+	tdivzNstepu = tdivzstepu * SPAN_SUBDIV;
+	ziNstepu = zistepu * SPAN_SUBDIV;
+
+	do
+	{
+		pdest = viewbuffer + (rowbytes * pspan->v) + pspan->u;
+
+		count = pspan->count;
+
+	// calculate the initial s/z, t/z, 1/z, s, and t and clamp
+		du = (float)pspan->u;
+		dv = (float)pspan->v;
+
+		sdivz = sdivzorigin + dv*sdivzstepv + du*sdivzstepu;
+		tdivz = tdivzorigin + dv*tdivzstepv + du*tdivzstepu;
+		zi = ziorigin + dv*zistepv + du*zistepu;
+		z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+
+		s = (int)(sdivz * z) + sadj;
+		if (s > sext)
+			s = sext;
+		else if (s < 0)
+			s = 0;
+
+		t = (int)(tdivz * z) + tadj;
+		if (t > text)
+			t = text;
+		else if (t < 0)
+			t = 0;
+
+		do
+		{
+		// calculate s and t at the far end of the span
+			if (count >= SPAN_SUBDIV)
+				spancount = SPAN_SUBDIV;
+			else
+				spancount = count;
+
+			count -= spancount;
+
+			if (count)
+			{
+			// calculate s/z, t/z, zi->fixed s and t at far end of span,
+			// calculate s and t steps across span by shifting
+				sdivz += sdivzNstepu;
+				tdivz += tdivzNstepu;
+				zi += ziNstepu;
+				z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+
+				snext = (int)(sdivz * z) + sadj;
+				if (snext > sext)
+					snext = sext;
+				else if (snext < 8)
+					snext = 8;	// prevent round-off error on <0 steps from
+								//  from causing overstepping & running off the
+								//  edge of the texture
+
+				tnext = (int)(tdivz * z) + tadj;
+				if (tnext > text)
+					tnext = text;
+				else if (tnext < 8)
+					tnext = 8;	// guard against round-off error on <0 steps
+
+				sstep = (snext - s) >> SPAN_SHIFT;
+				tstep = (tnext - t) >> SPAN_SHIFT;
+			}
+			else
+			{
+			// calculate s/z, t/z, zi->fixed s and t at last pixel in span (so
+			// can't step off polygon), clamp, calculate s and t steps across
+			// span by division, biasing steps low so we don't run off the
+			// texture
+				spancountminus1 = (float)(spancount - 1);
+				sdivz += sdivzstepu * spancountminus1;
+				tdivz += tdivzstepu * spancountminus1;
+				zi += zistepu * spancountminus1;
+				z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+				snext = (int)(sdivz * z) + sadj;
+				if (snext > sext)
+					snext = sext;
+				else if (snext < 8)
+					snext = 8;	// prevent round-off error on <0 steps from
+								//  from causing overstepping & running off the
+								//  edge of the texture
+
+				tnext = (int)(tdivz * z) + tadj;
+				if (tnext > text)
+					tnext = text;
+				else if (tnext < 8)
+					tnext = 8;	// guard against round-off error on <0 steps
+
+				if (spancount > 1)
+				{
+					sstep = (snext - s) / (spancount - 1);
+					tstep = (tnext - t) / (spancount - 1);
+				}
+			}
+
+			do
+			{
+				*pdest++ = SPAN_TEXEL (s, t);
+				s += sstep;
+				t += tstep;
+			} while (--spancount > 0);
+
+			s = snext;
+			t = tnext;
+
+		} while (count > 0);
+
+	} while ((pspan = pspan->pnext) != NULL);
+}
+
+#undef SPAN_NAME
+#undef SPAN_SUBDIV
+#undef SPAN_SHIFT
+#undef SPAN_TEXEL
+#undef SPAN_LOCALS
+#undef SPAN_SETUP
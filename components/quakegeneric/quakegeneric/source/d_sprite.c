@@ -76,6 +76,9 @@ void D_SpriteDrawSpans (sspan_t *pspan)
 	// we count on FP exceptions being turned off to avoid range problems
 		izi = (int)(zi * 0x8000 * 0x10000);
 
+		if (D_HiZSpanHidden (pspan->u, pspan->v, count, izi, izistep))
+			goto NextSpan;
+
 		s = (int)(sdivz * z) + sadjust;
 		if (s > bbextents)
 			s = bbextents;
@@ -384,7 +387,7 @@ D_DrawSprite
 void D_DrawSprite (void)
 {
 	int			i, nump;
-	float		ymin, ymax;
+	float		ymin, ymax, umin, umax;
 	emitpoint_t	*pverts;
 	sspan_t		spans[MAXHEIGHT+1];
 
@@ -419,6 +422,24 @@ void D_DrawSprite (void)
 	if (ymin >= ymax)
 		return;		// doesn't cross any scans at all
 
+	umin = 999999.9;
+	umax = -999999.9;
+	pverts = r_spritedesc.pverts;
+	for (i=0 ; i<r_spritedesc.nump ; i++, pverts++)
+	{
+		if (pverts->u < umin)
+			umin = pverts->u;
+		if (pverts->u > umax)
+			umax = pverts->u;
+	}
+
+	if (D_HiZOccluded ((int)umin - 1, (int)ymin - 1, (int)umax + 1, (int)ymax,
+		(int)(r_spritedesc.nearzi * 0x8000) + 1))
+	{
+		d_hizmodels++;
+		return;
+	}
+
 	cachewidth = r_spritedesc.pspriteframe->width;
 	sprite_height = r_spritedesc.pspriteframe->height;
 	cacheblock = (byte *)&r_spritedesc.pspriteframe->pixels[0];
@@ -293,8 +293,12 @@ surfcache_t *D_CacheSurface (msurface_t *surface, int miplevel)
 	surfscale = 1.0 / (1<<miplevel);
 	r_drawsurf.surfmip = miplevel;
 	r_drawsurf.surfwidth = surface->extents[0] >> miplevel;
-	r_drawsurf.rowbytes = r_drawsurf.surfwidth;
 	r_drawsurf.surfheight = surface->extents[1] >> miplevel;
+	r_drawsurf.tiled = d_surftiled;
+	if (d_surftiled)
+		r_drawsurf.rowbytes = 16 >> miplevel;
+	else
+		r_drawsurf.rowbytes = r_drawsurf.surfwidth;
 	
 //
 // allocate memory if needed
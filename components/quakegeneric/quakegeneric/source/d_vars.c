@@ -39,6 +39,8 @@ fixed16_t	sadjust, tadjust, bbextents, bbextentt;
 
 pixel_t			*cacheblock;
 int				cachewidth;
+int				cacheheight;
+int				cachetileshift;		// log2 of the block size in tiled caches
 pixel_t			*d_viewbuffer;
 short			*d_pzbuffer;
 unsigned int	d_zrowbytes;
@@ -547,6 +547,10 @@ Host_ServerFrame
 */
 void Host_ServerFrame (void)
 {
+	double	start;
+
+	start = Sys_FloatTime ();
+
 // run the world state	
 	pr_global_struct->frametime = host_frametime;
 
@@ -566,6 +570,8 @@ void Host_ServerFrame (void)
 
 // send all messages to the clients
 	SV_SendClientMessages ();
+
+	Bot_ServerFrame (Sys_FloatTime () - start);
 }
 
 /*
@@ -9,6 +9,7 @@ OBJECTS=&
 	cl_input.o&
 	cl_main.o&
 	cl_parse.o&
+	cl_pred.o&
 	cl_tent.o&
 	cmd.o&
 	common.o&
@@ -36,6 +37,7 @@ OBJECTS=&
 	menu.o&
 	model.o&
 	net_loop.o&
+	net_bot.o&
 	net_main.o&
 	net_none.o&
 	net_vcr.o&
@@ -59,7 +61,10 @@ OBJECTS=&
 	r_vars.o&
 	sbar.o&
 	screen.o&
-	snd_null.o&
+	snd_dma.o&
+	snd_mem.o&
+	snd_mix.o&
+	snd_sim.o&
 	sv_main.o&
 	sv_move.o&
 	sv_phys.o&
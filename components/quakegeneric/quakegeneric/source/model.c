@@ -111,11 +111,12 @@ mleaf_t *Mod_PointInLeaf (vec3_t p, model_t *model)
 /*
 ===================
 Mod_DecompressVis
+
+Decompresses into decompressed, which must hold MAX_MAP_LEAFS/8 bytes
 ===================
 */
-byte *Mod_DecompressVis (byte *in, model_t *model)
+byte *Mod_DecompressVisTo (byte *in, model_t *model, byte *decompressed)
 {
-	static byte	decompressed[MAX_MAP_LEAFS/8];
 	int		c;
 	byte	*out;
 	int		row;
@@ -153,6 +154,13 @@ byte *Mod_DecompressVis (byte *in, model_t *model)
 	return decompressed;
 }
 
+byte *Mod_DecompressVis (byte *in, model_t *model)
+{
+	static byte	decompressed[MAX_MAP_LEAFS/8];
+
+	return Mod_DecompressVisTo (in, model, decompressed);
+}
+
 byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 {
 	if (leaf == model->leafs)
@@ -160,6 +168,21 @@ byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 	return Mod_DecompressVis (leaf->compressed_vis, model);
 }
 
+/*
+===================
+Mod_LeafPVSTo
+
+Mod_LeafPVS for callers that can run in parallel: visbuf is used instead of
+the shared decompression buffer and must hold MAX_MAP_LEAFS/8 bytes
+===================
+*/
+byte *Mod_LeafPVSTo (mleaf_t *leaf, model_t *model, byte *visbuf)
+{
+	if (leaf == model->leafs)
+		return mod_novis;
+	return Mod_DecompressVisTo (leaf->compressed_vis, model, visbuf);
+}
+
 /*
 ===================
 Mod_ClearAll
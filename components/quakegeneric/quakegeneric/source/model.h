@@ -378,5 +378,6 @@ void	Mod_TouchModel (char *name);
 
 mleaf_t *Mod_PointInLeaf (float *p, model_t *model);
 byte	*Mod_LeafPVS (mleaf_t *leaf, model_t *model);
+byte	*Mod_LeafPVSTo (mleaf_t *leaf, model_t *model, byte *visbuf);
 
 #endif	// __MODEL__
@@ -121,6 +121,39 @@ struct qsockaddr
 #define CCREP_PLAYER_INFO	0x84
 #define CCREP_RULE_INFO		0x85
 
+#define	NET_HISTBUCKETS	9	// <1, <2, <5, <10, <20, <50, <100, <200, >=200 ms
+
+typedef struct
+{
+	int				messagesSent;
+	int				messagesReceived;
+	int				bytesSent;
+	int				bytesReceived;
+
+	// datagram driver only
+	int				packetsSent;
+	int				packetsReceived;
+	int				packetsReSent;		// reliable retransmits
+	int				droppedDatagrams;	// unreliable sequence gaps
+	int				duplicates;
+
+	double			reliableSendTime;	// last reliable packet, for RTT
+	qboolean		timingReliable;		// false once it has been resent
+	float			rtt;				// last round trip, seconds
+	float			jitter;				// smoothed datagram interarrival jitter
+	double			lastArrival;
+	float			lastGap;
+	int				rttHistogram[NET_HISTBUCKETS];
+	int				jitterHistogram[NET_HISTBUCKETS];
+
+	// per second rates, updated by NET_UpdateRates
+	double			rateTime;
+	int				rateBytesSent;
+	int				rateBytesReceived;
+	float			sendRate;
+	float			receiveRate;
+} netstats_t;
+
 typedef struct qsocket_s
 {
 	struct qsocket_s	*next;
@@ -151,6 +184,8 @@ typedef struct qsocket_s
 	struct qsockaddr	addr;
 	char				address[NET_NAMELEN];
 
+	netstats_t		stats;
+
 } qsocket_t;
 
 extern qsocket_t	*net_activeSockets;
@@ -276,6 +311,12 @@ int			NET_GetMessage (struct qsocket_s *sock);
 // returns 1 if a message was received
 // returns 2 if an unreliable message was received
 // returns -1 if the connection died
+// the loopback driver points net_message straight into its queue, so the
+// data is only valid until the next NET_GetMessage
+
+void		NET_ResetMessage (void);
+// gives net_message its own buffer back.  Call before filling net_message
+// outside of NET_GetMessage
 
 int			NET_SendMessage (struct qsocket_s *sock, sizebuf_t *data);
 int			NET_SendUnreliableMessage (struct qsocket_s *sock, sizebuf_t *data);
@@ -300,6 +341,16 @@ void		NET_Close (struct qsocket_s *sock);
 void NET_Poll(void);
 
 
+void NET_SampleRTT (qsocket_t *sock, double rtt);
+void NET_SampleArrival (qsocket_t *sock);
+// datagram drivers feed the per socket telemetry through these
+
+void NET_UpdateRates (qsocket_t *sock);
+// refreshes stats.sendRate and stats.receiveRate about once a second
+
+void NET_PrintTelemetry (qsocket_t *sock);
+
+
 typedef struct _PollProcedure
 {
 	struct _PollProcedure	*next;
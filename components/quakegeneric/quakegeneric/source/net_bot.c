@@ -0,0 +1,588 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// net_bot.c -- synthetic clients for loading the server
+
+/*
+
+The bot driver hands the server connections that look like any other
+client: they go through SV_ConnectClient, the prespawn/spawn/begin signon
+and send a clc_move every frame, so the whole receive, physics and send
+path is exercised.  Everything the server sends them is counted and
+thrown away.
+
+Moves are either generated from a seeded random walk, so runs can be
+repeated, or replayed from moves recorded off the local player with
+bot_record.
+
+*/
+
+#include "quakedef.h"
+#include "net_bot.h"
+
+#define	MAX_BOTS		MAX_SCOREBOARD
+#define	MAX_BOTRECORD	4096
+
+typedef struct
+{
+	vec3_t	angles;
+	short	forwardmove;
+	short	sidemove;
+	short	upmove;
+	byte	buttons;
+	byte	impulse;
+} botmove_t;
+
+typedef struct
+{
+	qsocket_t	*sock;
+	int			number;
+	int			stage;			// signon commands sent so far
+	int			lastframe;		// host_framecount of the last message
+	qboolean	recorded;		// replay bot_record moves
+	int			playback;		// next recorded move
+	unsigned	seed;
+	float		idealyaw;
+	double		nextchange;		// sv.time to pick new random intentions
+	botmove_t	move;
+} bot_t;
+
+#define	BOT_SPAWNED		3		// prespawn, spawn and begin all sent
+
+static bot_t	bots[MAX_BOTS];
+static int		bot_numbots;
+static int		bot_pending;		// waiting for Bot_CheckNewConnections
+static qboolean	bot_pendingrecorded;
+
+static botmove_t	bot_record[MAX_BOTRECORD];
+static int			bot_recordlength;
+static qboolean		bot_recording;
+
+static int		bot_frames;
+static double	bot_frametime;
+static double	bot_maxframetime;
+static int		bot_movecalls;
+static int		bot_lastmovecount;
+static int		bot_reliablemessages;
+static int		bot_unreliablemessages;
+static double	bot_reliablebytes;
+static double	bot_unreliablebytes;
+
+/*
+===============================================================================
+
+BOT BRAINS
+
+===============================================================================
+*/
+
+static int Bot_Random (bot_t *bot)
+{
+	bot->seed = bot->seed * 1103515245 + 12345;
+	return (bot->seed >> 16) & 0x7fff;
+}
+
+static client_t *Bot_Client (qsocket_t *sock)
+{
+	int			i;
+	client_t	*client;
+
+	for (i=0, client = svs.clients ; i<svs.maxclients ; i++, client++)
+		if (client->active && client->netconnection == sock)
+			return client;
+	return NULL;
+}
+
+/*
+===================
+Bot_RandomMove
+
+Runs in a random direction for a second or two, firing and jumping now
+and then, and turns towards the new heading at a human rate.
+===================
+*/
+static void Bot_RandomMove (bot_t *bot)
+{
+	botmove_t	*move;
+	float		delta, turn;
+
+	move = &bot->move;
+	move->impulse = 0;
+
+	if (sv.time >= bot->nextchange)
+	{
+		bot->nextchange = sv.time + 0.5 + (Bot_Random (bot) % 2000) * 0.001;
+		bot->idealyaw = Bot_Random (bot) % 360;
+
+		switch (Bot_Random (bot) & 3)
+		{
+		case 0:	move->forwardmove = 0; break;
+		case 1:	move->forwardmove = 200; break;
+		case 2:	move->forwardmove = 400; break;
+		case 3:	move->forwardmove = -200; break;
+		}
+		move->sidemove = (Bot_Random (bot) % 3 - 1) * 350;
+		move->upmove = 0;
+		move->angles[PITCH] = (Bot_Random (bot) % 60) - 30;
+
+		move->buttons = 0;
+		if (!(Bot_Random (bot) & 3))
+			move->buttons |= 1;
+		if (!(Bot_Random (bot) & 7))
+			move->buttons |= 2;
+		if (!(Bot_Random (bot) & 15))
+			move->impulse = 10;		// next weapon
+	}
+
+	delta = anglemod (bot->idealyaw - move->angles[YAW]);
+	if (delta > 180)
+		delta -= 360;
+	turn = 180 * host_frametime;
+	if (delta > turn)
+		delta = turn;
+	else if (delta < -turn)
+		delta = -turn;
+	move->angles[YAW] = anglemod (move->angles[YAW] + delta);
+}
+
+static void Bot_StringCmd (char *s)
+{
+	MSG_WriteByte (&net_message, clc_stringcmd);
+	MSG_WriteString (&net_message, s);
+}
+
+/*
+===================
+Bot_SignonCommands
+
+Sends the signon commands a real client would answer svc_signonnum
+with, one stage at a time.  Each waits until the server has flushed the
+reply to the previous one, so the signon data never piles up in the
+client's reliable buffer.
+===================
+*/
+static qboolean Bot_SignonCommands (bot_t *bot, client_t *client)
+{
+	if (bot->stage == BOT_SPAWNED)
+		bot->stage = 0;		// the level changed and serverinfo was sent again
+
+	if (client->message.cursize)
+		return false;
+
+	switch (bot->stage)
+	{
+	case 0:
+		Bot_StringCmd ("prespawn");
+		break;
+	case 1:
+		Bot_StringCmd (va("name \"bot%i\"\n", bot->number));
+		Bot_StringCmd (va("color %i %i\n", bot->number % 14, bot->number % 14));
+		Bot_StringCmd ("spawn ");
+		break;
+	case 2:
+		Bot_StringCmd ("begin");
+		break;
+	}
+	bot->stage++;
+	return true;
+}
+
+/*
+===============================================================================
+
+DRIVER
+
+===============================================================================
+*/
+
+/*
+===================
+Bot_Add_f
+
+bot_add [count] [random | recorded]
+===================
+*/
+static void Bot_Add_f (void)
+{
+	int		i, count, slots;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("bot_add: no server running\n");
+		return;
+	}
+	if (svs.maxclients < 2)
+	{
+		Con_Printf ("bot_add: bots need maxplayers > 1\n");
+		return;
+	}
+
+	count = 1;
+	if (Cmd_Argc () > 1)
+		count = Q_atoi (Cmd_Argv (1));
+
+	bot_pendingrecorded = false;
+	if (Cmd_Argc () > 2 && !Q_strcmp (Cmd_Argv (2), "recorded"))
+	{
+		if (!bot_recordlength)
+		{
+			Con_Printf ("bot_add: nothing recorded, use bot_record first\n");
+			return;
+		}
+		bot_pendingrecorded = true;
+	}
+
+	slots = 0;
+	for (i=0 ; i<svs.maxclients ; i++)
+		if (!svs.clients[i].active)
+			slots++;
+	if (count > slots)
+	{
+		Con_Printf ("bot_add: only %i free client slots\n", slots);
+		count = slots;
+	}
+
+	bot_pending = count;
+}
+
+/*
+===================
+Bot_Remove_f
+
+bot_remove [count]
+Drops the most recently added bots, all of them when no count is given.
+===================
+*/
+static void Bot_Remove_f (void)
+{
+	int			i, count;
+	client_t	*client, *save;
+
+	if (cmd_source != src_command || !sv.active)
+		return;
+
+	count = MAX_BOTS;
+	if (Cmd_Argc () > 1)
+		count = Q_atoi (Cmd_Argv (1));
+
+	save = host_client;
+	for (i=MAX_BOTS-1 ; i>=0 && count > 0 ; i--)
+	{
+		if (!bots[i].sock)
+			continue;
+		client = Bot_Client (bots[i].sock);
+		if (!client)
+			continue;
+		host_client = client;
+		SV_DropClient (false);
+		count--;
+	}
+	host_client = save;
+	bot_pending = 0;
+}
+
+/*
+===================
+Bot_Record_f
+
+bot_record [stop]
+Captures the local player's moves for "bot_add <count> recorded".
+===================
+*/
+static void Bot_Record_f (void)
+{
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "stop"))
+	{
+		bot_recording = false;
+		Con_Printf ("%i moves recorded\n", bot_recordlength);
+		return;
+	}
+
+	bot_recordlength = 0;
+	bot_recording = true;
+	Con_Printf ("recording moves\n");
+}
+
+void Bot_RecordMove (vec3_t angles, usercmd_t *cmd, int buttons, int impulse)
+{
+	botmove_t	*move;
+
+	if (!bot_recording)
+		return;
+
+	if (bot_recordlength == MAX_BOTRECORD)
+	{
+		Con_Printf ("bot_record: buffer full, %i moves recorded\n", bot_recordlength);
+		bot_recording = false;
+		return;
+	}
+
+	move = &bot_record[bot_recordlength++];
+	VectorCopy (angles, move->angles);
+	move->forwardmove = cmd->forwardmove;
+	move->sidemove = cmd->sidemove;
+	move->upmove = cmd->upmove;
+	move->buttons = buttons;
+	move->impulse = impulse;
+}
+
+/*
+===================
+Bot_ServerFrame
+
+Called after every server frame with the time it took.
+===================
+*/
+void Bot_ServerFrame (double seconds)
+{
+	int		moves;
+
+	moves = sv_movecount - bot_lastmovecount;
+	bot_lastmovecount = sv_movecount;
+
+	if (!bot_numbots)
+		return;
+
+	bot_frames++;
+	bot_frametime += seconds;
+	if (seconds > bot_maxframetime)
+		bot_maxframetime = seconds;
+	bot_movecalls += moves;
+}
+
+/*
+===================
+Bot_Stats_f
+
+bot_stats [reset]
+===================
+*/
+static void Bot_Stats_f (void)
+{
+	int		frames;
+
+	frames = bot_frames ? bot_frames : 1;
+
+	Con_Printf ("bots            = %i\n", bot_numbots);
+	Con_Printf ("server frames   = %i\n", bot_frames);
+	Con_Printf ("frame time      = %.2f ms avg, %.2f ms max\n", bot_frametime * 1000 / frames, bot_maxframetime * 1000);
+	Con_Printf ("SV_Move calls   = %i (%.1f per frame)\n", bot_movecalls, (float)bot_movecalls / frames);
+	Con_Printf ("reliable sent   = %i msgs, %.0f bytes (%.0f per frame)\n", bot_reliablemessages, bot_reliablebytes, bot_reliablebytes / frames);
+	Con_Printf ("unreliable sent = %i msgs, %.0f bytes (%.0f per frame)\n", bot_unreliablemessages, bot_unreliablebytes, bot_unreliablebytes / frames);
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+	{
+		bot_frames = 0;
+		bot_frametime = bot_maxframetime = 0;
+		bot_movecalls = 0;
+		bot_reliablemessages = bot_unreliablemessages = 0;
+		bot_reliablebytes = bot_unreliablebytes = 0;
+	}
+}
+
+
+int Bot_Init (void)
+{
+	Cmd_AddCommand ("bot_add", Bot_Add_f);
+	Cmd_AddCommand ("bot_remove", Bot_Remove_f);
+	Cmd_AddCommand ("bot_record", Bot_Record_f);
+	Cmd_AddCommand ("bot_stats", Bot_Stats_f);
+	return 0;
+}
+
+
+void Bot_Shutdown (void)
+{
+}
+
+
+void Bot_Listen (qboolean state)
+{
+}
+
+
+void Bot_SearchForHosts (qboolean xmit)
+{
+}
+
+
+qsocket_t *Bot_Connect (char *host)
+{
+	return NULL;
+}
+
+
+qsocket_t *Bot_CheckNewConnections (void)
+{
+	int			i;
+	bot_t		*bot;
+	qsocket_t	*sock;
+
+	if (!bot_pending || !sv.active)
+		return NULL;
+
+	for (i=0 ; i<svs.maxclients ; i++)
+		if (!svs.clients[i].active)
+			break;
+	if (i == svs.maxclients)
+	{
+		bot_pending = 0;
+		return NULL;
+	}
+
+	for (i=0, bot = bots ; i<MAX_BOTS ; i++, bot++)
+		if (!bot->sock)
+			break;
+	if (i == MAX_BOTS)
+	{
+		bot_pending = 0;
+		return NULL;
+	}
+
+	if ((sock = NET_NewQSocket ()) == NULL)
+	{
+		Con_Printf ("Bot_CheckNewConnections: no qsocket available\n");
+		bot_pending = 0;
+		return NULL;
+	}
+	sprintf (sock->address, "bot%i", i);
+
+	memset (bot, 0, sizeof(*bot));
+	bot->sock = sock;
+	bot->number = i;
+	bot->lastframe = -1;
+	bot->seed = i * 7919 + 1;
+	bot->recorded = bot_pendingrecorded;
+	bot->playback = (i * 97) % (bot_recordlength ? bot_recordlength : 1);
+	sock->driverdata = bot;
+
+	bot_pending--;
+	bot_numbots++;
+	return sock;
+}
+
+
+/*
+===================
+Bot_GetMessage
+
+Produces at most one message per server frame: the next signon command
+until the bot is spawned, a clc_move after that.
+===================
+*/
+int Bot_GetMessage (qsocket_t *sock)
+{
+	bot_t		*bot;
+	client_t	*client;
+	botmove_t	*move;
+	int			i;
+
+	bot = (bot_t *)sock->driverdata;
+	if (!bot)
+		return -1;
+
+	client = Bot_Client (sock);
+	if (!client || bot->lastframe == host_framecount)
+		return 0;
+
+	SZ_Clear (&net_message);
+
+	if (!client->spawned)
+	{
+		if (!Bot_SignonCommands (bot, client))
+			return 0;
+		bot->lastframe = host_framecount;
+		return 1;
+	}
+	bot->lastframe = host_framecount;
+
+	if (bot->recorded && bot_recordlength)
+	{
+		move = &bot_record[bot->playback];
+		bot->playback = (bot->playback + 1) % bot_recordlength;
+	}
+	else
+	{
+		Bot_RandomMove (bot);
+		move = &bot->move;
+	}
+
+	MSG_WriteByte (&net_message, clc_move);
+	MSG_WriteFloat (&net_message, sv.time);
+	for (i=0 ; i<3 ; i++)
+		MSG_WriteAngle (&net_message, move->angles[i]);
+	MSG_WriteShort (&net_message, move->forwardmove);
+	MSG_WriteShort (&net_message, move->sidemove);
+	MSG_WriteShort (&net_message, move->upmove);
+	MSG_WriteByte (&net_message, move->buttons);
+	MSG_WriteByte (&net_message, move->impulse);
+
+	return 2;
+}
+
+
+int Bot_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	if (!sock->driverdata)
+		return -1;
+
+	bot_reliablemessages++;
+	bot_reliablebytes += data->cursize;
+	return 1;
+}
+
+
+int Bot_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	if (!sock->driverdata)
+		return -1;
+
+	bot_unreliablemessages++;
+	bot_unreliablebytes += data->cursize;
+	return 1;
+}
+
+
+qboolean Bot_CanSendMessage (qsocket_t *sock)
+{
+	return sock->driverdata != NULL;
+}
+
+
+qboolean Bot_CanSendUnreliableMessage (qsocket_t *sock)
+{
+	return true;
+}
+
+
+void Bot_Close (qsocket_t *sock)
+{
+	bot_t	*bot;
+
+	bot = (bot_t *)sock->driverdata;
+	if (!bot)
+		return;
+
+	memset (bot, 0, sizeof(*bot));
+	sock->driverdata = NULL;
+	bot_numbots--;
+}
@@ -179,6 +179,9 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 		return -1;
 
 	sock->lastSendTime = net_time;
+	sock->stats.reliableSendTime = net_time;
+	sock->stats.timingReliable = true;
+	sock->stats.packetsSent++;
 	packetsSent++;
 	return 1;
 }
@@ -212,6 +215,9 @@ int SendMessageNext (qsocket_t *sock)
 		return -1;
 
 	sock->lastSendTime = net_time;
+	sock->stats.reliableSendTime = net_time;
+	sock->stats.timingReliable = true;
+	sock->stats.packetsSent++;
 	packetsSent++;
 	return 1;
 }
@@ -245,6 +251,8 @@ int ReSendMessage (qsocket_t *sock)
 		return -1;
 
 	sock->lastSendTime = net_time;
+	sock->stats.timingReliable = false;	// the ack could be for either copy
+	sock->stats.packetsReSent++;
 	packetsReSent++;
 	return 1;
 }
@@ -286,6 +294,7 @@ int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
 		return -1;
 
+	sock->stats.packetsSent++;
 	packetsSent++;
 	return 1;
 }
@@ -345,6 +354,7 @@ int	Datagram_GetMessage (qsocket_t *sock)
 
 		sequence = BigLong(packetBuffer.sequence);
 		packetsReceived++;
+		sock->stats.packetsReceived++;
 
 		if (flags & NETFLAG_UNRELIABLE)
 		{
@@ -358,9 +368,11 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			{
 				count = sequence - sock->unreliableReceiveSequence;
 				droppedDatagrams += count;
+				sock->stats.droppedDatagrams += count;
 				Con_DPrintf("Dropped %u datagram(s)\n", count);
 			}
 			sock->unreliableReceiveSequence = sequence + 1;
+			NET_SampleArrival (sock);
 
 			length -= NET_HEADERSIZE;
 
@@ -389,6 +401,11 @@ int	Datagram_GetMessage (qsocket_t *sock)
 				Con_DPrintf("Duplicate ACK received\n");
 				continue;
 			}
+			if (sock->stats.timingReliable)
+			{
+				NET_SampleRTT (sock, net_time - sock->stats.reliableSendTime);
+				sock->stats.timingReliable = false;
+			}
 			sock->sendMessageLength -= MAX_DATAGRAM;
 			if (sock->sendMessageLength > 0)
 			{
@@ -412,6 +429,7 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			if (sequence != sock->receiveSequence)
 			{
 				receivedDuplicateCount++;
+				sock->stats.duplicates++;
 				continue;
 			}
 			sock->receiveSequence++;
@@ -447,6 +465,7 @@ void PrintStats(qsocket_t *s)
 	Con_Printf("canSend = %4u   \n", s->canSend);
 	Con_Printf("sendSeq = %4u   ", s->sendSequence);
 	Con_Printf("recvSeq = %4u   \n", s->receiveSequence);
+	NET_PrintTelemetry (s);
 	Con_Printf("\n");
 }
 
@@ -26,10 +26,91 @@ qboolean	localconnectpending = false;
 qsocket_t	*loop_client = NULL;
 qsocket_t	*loop_server = NULL;
 
+/*
+===============================================================================
+
+MESSAGE QUEUES
+
+Each loop socket queues the messages sent to it in two halves: its
+receiveMessage and sendMessage buffers, the latter being unused by the
+loop driver otherwise.  The peer appends to the fill half while messages
+are handed out in place from the other one, by pointing net_message
+straight at them; once that runs dry the halves trade places.  The only
+copy left is the one out of the sender's sizebuf.
+
+===============================================================================
+*/
+
+#define	LOOP_HEADERSIZE	4		// type, length (2 bytes), alignment
+
+typedef struct
+{
+	byte	*half[2];
+	int		fill;				// half the peer appends to
+	int		readpos;			// next message in the other half
+	int		drainlength;		// bytes queued in the other half
+} loopqueue_t;
+
+static loopqueue_t	loop_queues[2];	// [0] = client side, [1] = server side
+
+static int	loop_bytescopied;		// memcpy'd by senders
+static int	loop_bytesinplace;		// handed to the receiver without a copy
+static int	loop_messages;
+static int	loop_startframe;
+
+static loopqueue_t *Loop_Queue (qsocket_t *sock)
+{
+	return (sock == loop_server) ? &loop_queues[1] : &loop_queues[0];
+}
+
+static void Loop_ClearQueue (qsocket_t *sock)
+{
+	loopqueue_t	*q;
+
+	q = Loop_Queue (sock);
+	q->half[0] = sock->receiveMessage;
+	q->half[1] = sock->sendMessage;
+	q->fill = 0;
+	q->readpos = 0;
+	q->drainlength = 0;
+
+	sock->receiveMessageLength = 0;	// bytes queued in the fill half
+	sock->sendMessageLength = 0;
+	sock->canSend = true;
+}
+
+/*
+===================
+Loop_Stats_f
+===================
+*/
+static void Loop_Stats_f (void)
+{
+	int		frames;
+
+	frames = host_framecount - loop_startframe;
+	if (frames < 1)
+		frames = 1;
+
+	Con_Printf ("loopback messages       = %i\n", loop_messages);
+	Con_Printf ("bytes copied            = %i (%i per frame)\n", loop_bytescopied, loop_bytescopied / frames);
+	Con_Printf ("bytes delivered in place = %i (%i per frame)\n", loop_bytesinplace, loop_bytesinplace / frames);
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+	{
+		loop_bytescopied = loop_bytesinplace = loop_messages = 0;
+		loop_startframe = host_framecount;
+	}
+}
+
+static void Loop_Check_f (void);
+
 int Loop_Init (void)
 {
 	if (cls.state == ca_dedicated)
 		return -1;
+	Cmd_AddCommand ("net_loopstats", Loop_Stats_f);
+	Cmd_AddCommand ("net_loopcheck", Loop_Check_f);
 	return 0;
 }
 
@@ -78,9 +159,7 @@ qsocket_t *Loop_Connect (char *host)
 		}
 		Q_strcpy (loop_client->address, "localhost");
 	}
-	loop_client->receiveMessageLength = 0;
-	loop_client->sendMessageLength = 0;
-	loop_client->canSend = true;
+	Loop_ClearQueue (loop_client);
 
 	if (!loop_server)
 	{
@@ -91,9 +170,7 @@ qsocket_t *Loop_Connect (char *host)
 		}
 		Q_strcpy (loop_server->address, "LOCAL");
 	}
-	loop_server->receiveMessageLength = 0;
-	loop_server->sendMessageLength = 0;
-	loop_server->canSend = true;
+	Loop_ClearQueue (loop_server);
 
 	loop_client->driverdata = (void *)loop_server;
 	loop_server->driverdata = (void *)loop_client;
@@ -108,12 +185,8 @@ qsocket_t *Loop_CheckNewConnections (void)
 		return NULL;
 
 	localconnectpending = false;
-	loop_server->sendMessageLength = 0;
-	loop_server->receiveMessageLength = 0;
-	loop_server->canSend = true;
-	loop_client->sendMessageLength = 0;
-	loop_client->receiveMessageLength = 0;
-	loop_client->canSend = true;
+	Loop_ClearQueue (loop_server);
+	Loop_ClearQueue (loop_client);
 	return loop_server;
 }
 
@@ -128,21 +201,33 @@ int Loop_GetMessage (qsocket_t *sock)
 {
 	int		ret;
 	int		length;
+	byte	*msg;
+	loopqueue_t	*q;
 
-	if (sock->receiveMessageLength == 0)
-		return 0;
+	q = Loop_Queue (sock);
 
-	ret = sock->receiveMessage[0];
-	length = sock->receiveMessage[1] + (sock->receiveMessage[2] << 8);
-	// alignment byte skipped here
-	SZ_Clear (&net_message);
-	SZ_Write (&net_message, &sock->receiveMessage[4], length);
+	if (q->readpos >= q->drainlength)
+	{
+		if (sock->receiveMessageLength == 0)
+			return 0;
+
+	// everything handed out already, take over what the peer has queued
+		q->drainlength = sock->receiveMessageLength;
+		q->readpos = 0;
+		q->fill ^= 1;
+		sock->receiveMessageLength = 0;
+	}
+
+	msg = q->half[q->fill ^ 1] + q->readpos;
+	ret = msg[0];
+	length = msg[1] + (msg[2] << 8);
 
-	length = IntAlign(length + 4);
-	sock->receiveMessageLength -= length;
+	net_message.data = msg + LOOP_HEADERSIZE;
+	net_message.maxsize = length;
+	net_message.cursize = length;
+	loop_bytesinplace += length;
 
-	if (sock->receiveMessageLength)
-		Q_memcpy(sock->receiveMessage, &sock->receiveMessage[length], sock->receiveMessageLength);
+	q->readpos += IntAlign(length + LOOP_HEADERSIZE);
 
 	if (sock->driverdata && ret == 1)
 		((qsocket_t *)sock->driverdata)->canSend = true;
@@ -151,23 +236,30 @@ int Loop_GetMessage (qsocket_t *sock)
 }
 
 
-int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
-{
-	byte *buffer;
-	int  *bufferLength;
+/*
+===================
+Loop_QueueMessage
 
-	if (!sock->driverdata)
-		return -1;
+Appends a message to the fill half of the peer's queue.  Returns false
+if it does not fit.
+===================
+*/
+static qboolean Loop_QueueMessage (qsocket_t *sock, sizebuf_t *data, int type)
+{
+	qsocket_t	*peer;
+	byte		*buffer;
+	int			length;
 
-	bufferLength = &((qsocket_t *)sock->driverdata)->receiveMessageLength;
+	peer = (qsocket_t *)sock->driverdata;
+	length = data->cursize + LOOP_HEADERSIZE;
 
-	if ((*bufferLength + data->cursize + 4) > NET_MAXMESSAGE)
-		Sys_Error("Loop_SendMessage: overflow\n");
+	if (peer->receiveMessageLength + length > NET_MAXMESSAGE)
+		return false;
 
-	buffer = ((qsocket_t *)sock->driverdata)->receiveMessage + *bufferLength;
+	buffer = Loop_Queue (peer)->half[Loop_Queue (peer)->fill] + peer->receiveMessageLength;
 
 	// message type
-	*buffer++ = 1;
+	*buffer++ = type;
 
 	// length
 	*buffer++ = data->cursize & 0xff;
@@ -178,41 +270,34 @@ int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	// message
 	Q_memcpy(buffer, data->data, data->cursize);
-	*bufferLength = IntAlign(*bufferLength + data->cursize + 4);
+	loop_bytescopied += data->cursize;
+	loop_messages++;
 
-	sock->canSend = false;
-	return 1;
+	peer->receiveMessageLength = IntAlign(peer->receiveMessageLength + length);
+	return true;
 }
 
 
-int Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+int Loop_SendMessage (qsocket_t *sock, sizebuf_t *data)
 {
-	byte *buffer;
-	int  *bufferLength;
-
 	if (!sock->driverdata)
 		return -1;
 
-	bufferLength = &((qsocket_t *)sock->driverdata)->receiveMessageLength;
-
-	if ((*bufferLength + data->cursize + sizeof(byte) + sizeof(short)) > NET_MAXMESSAGE)
-		return 0;
-
-	buffer = ((qsocket_t *)sock->driverdata)->receiveMessage + *bufferLength;
+	if (!Loop_QueueMessage (sock, data, 1))
+		Sys_Error("Loop_SendMessage: overflow\n");
 
-	// message type
-	*buffer++ = 2;
+	sock->canSend = false;
+	return 1;
+}
 
-	// length
-	*buffer++ = data->cursize & 0xff;
-	*buffer++ = data->cursize >> 8;
 
-	// align
-	buffer++;
+int Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	if (!sock->driverdata)
+		return -1;
 
-	// message
-	Q_memcpy(buffer, data->data, data->cursize);
-	*bufferLength = IntAlign(*bufferLength + data->cursize + 4);
+	if (!Loop_QueueMessage (sock, data, 2))
+		return 0;
 	return 1;
 }
 
@@ -235,11 +320,287 @@ void Loop_Close (qsocket_t *sock)
 {
 	if (sock->driverdata)
 		((qsocket_t *)sock->driverdata)->driverdata = NULL;
-	sock->receiveMessageLength = 0;
-	sock->sendMessageLength = 0;
-	sock->canSend = true;
+	Loop_ClearQueue (sock);
 	if (sock == loop_client)
 		loop_client = NULL;
 	else
 		loop_server = NULL;
 }
+
+
+/*
+===============================================================================
+
+LOOPBACK CHECK
+
+net_loopcheck pushes a stream of generated messages through a private
+pair of loop sockets and parses every one twice: in place, as
+Loop_GetMessage hands it out, and from a copy in net_message's own
+buffer, the way the copying driver delivered it.  The message type,
+length and everything parsed out of it have to agree.  The sender keeps
+appending while each message is read, and the queues fill up and swap
+halves many times over.
+
+===============================================================================
+*/
+
+#define	LOOPCHECK_MESSAGES		2000
+#define	LOOPCHECK_MAXSIZE		1400
+#define	LOOPCHECK_TRANSCRIPT	(LOOPCHECK_MAXSIZE*2 + 16)	// parses grow bytes to ints
+
+static unsigned	loopcheck_seed;
+
+static int Loop_CheckRand (void)
+{
+	loopcheck_seed = loopcheck_seed * 1103515245 + 12345;
+	return (loopcheck_seed >> 16) & 0x7fff;
+}
+
+/*
+===================
+Loop_CheckBuild
+
+Fills sb with message number n: a run of tagged values of every kind
+MSG_Write* knows.  The same n always gives the same message.
+===================
+*/
+static void Loop_CheckBuild (sizebuf_t *sb, int n)
+{
+	int		i, type, items;
+	char	string[32];
+
+	SZ_Clear (sb);
+	loopcheck_seed = n * 2654435761u;
+	items = Loop_CheckRand () % 256;
+	while (items-- && sb->cursize + 32 <= LOOPCHECK_MAXSIZE)
+	{
+		type = Loop_CheckRand () & 7;
+		MSG_WriteByte (sb, type);
+		switch (type)
+		{
+		case 0:
+			MSG_WriteChar (sb, (Loop_CheckRand () & 255) - 128);
+			break;
+		case 1:
+			MSG_WriteByte (sb, Loop_CheckRand () & 255);
+			break;
+		case 2:
+			MSG_WriteShort (sb, Loop_CheckRand () - 16384);
+			break;
+		case 3:
+			MSG_WriteLong (sb, (Loop_CheckRand () << 16) ^ Loop_CheckRand ());
+			break;
+		case 4:
+			MSG_WriteFloat (sb, (Loop_CheckRand () - 16384) * 0.37);
+			break;
+		case 5:
+			i = Loop_CheckRand () % 24;
+			string[i] = 0;
+			while (i--)
+				string[i] = 'a' + Loop_CheckRand () % 26;
+			MSG_WriteString (sb, string);
+			break;
+		case 6:
+			MSG_WriteCoord (sb, (Loop_CheckRand () - 16384) * 0.25);
+			break;
+		case 7:
+			MSG_WriteAngle (sb, Loop_CheckRand () % 360);
+			break;
+		}
+	}
+}
+
+static void Loop_CheckPut (byte *transcript, int *length, void *data, int size)
+{
+	if (*length + size > LOOPCHECK_TRANSCRIPT)
+		return;
+	memcpy (transcript + *length, data, size);
+	*length += size;
+}
+
+/*
+===================
+Loop_CheckParse
+
+Reads net_message the way Loop_CheckBuild wrote it, recording every
+value read in transcript.  Returns the transcript's length.
+===================
+*/
+static int Loop_CheckParse (byte *transcript)
+{
+	int		length, type, i;
+	float	f;
+	char	*s;
+
+	length = 0;
+	MSG_BeginReading ();
+	while (1)
+	{
+		type = MSG_ReadByte ();
+		if (type == -1)
+			break;
+		Loop_CheckPut (transcript, &length, &type, sizeof(type));
+		switch (type)
+		{
+		case 0:
+			i = MSG_ReadChar ();
+			break;
+		case 1:
+			i = MSG_ReadByte ();
+			break;
+		case 2:
+			i = MSG_ReadShort ();
+			break;
+		case 3:
+			i = MSG_ReadLong ();
+			break;
+		case 4:
+			f = MSG_ReadFloat ();
+			memcpy (&i, &f, sizeof(i));
+			break;
+		case 5:
+			s = MSG_ReadString ();
+			Loop_CheckPut (transcript, &length, s, strlen(s) + 1);
+			continue;
+		case 6:
+			f = MSG_ReadCoord ();
+			memcpy (&i, &f, sizeof(i));
+			break;
+		case 7:
+			f = MSG_ReadAngle ();
+			memcpy (&i, &f, sizeof(i));
+			break;
+		default:
+			return length;	// lost track of the message
+		}
+		Loop_CheckPut (transcript, &length, &i, sizeof(i));
+	}
+	Loop_CheckPut (transcript, &length, &msg_badread, sizeof(msg_badread));
+
+	return length;
+}
+
+/*
+===================
+Loop_Check_f
+
+Borrows the driver's socket slots for a private pair; nothing else can
+use them before it puts them back
+===================
+*/
+static void Loop_Check_f (void)
+{
+	qsocket_t	*sender, *receiver;
+	qsocket_t	*client, *server;
+	loopqueue_t	queues[2];
+	sizebuf_t	message, sb;
+	byte		*block, *inplace, *copied;
+	int			copiedbytes, inplacebytes, messages;
+	int			sent, received, lastsent, lastreceived, bytes;
+	int			i, ret, length, inplacelength, copiedlength;
+	qboolean	failed;
+
+	block = Tier_TryAlloc (2*sizeof(qsocket_t) + LOOPCHECK_MAXSIZE +
+		2*LOOPCHECK_TRANSCRIPT, mem_bulk, "loopcheck");
+	if (!block)
+	{
+		Con_Printf ("no memory for the check\n");
+		return;
+	}
+	sender = (qsocket_t *)block;
+	receiver = sender + 1;
+	memset (&sb, 0, sizeof(sb));
+	sb.data = (byte *)(receiver + 1);
+	sb.maxsize = LOOPCHECK_MAXSIZE;
+	inplace = sb.data + LOOPCHECK_MAXSIZE;
+	copied = inplace + LOOPCHECK_TRANSCRIPT;
+
+	client = loop_client;
+	server = loop_server;
+	queues[0] = loop_queues[0];
+	queues[1] = loop_queues[1];
+	copiedbytes = loop_bytescopied;
+	inplacebytes = loop_bytesinplace;
+	messages = loop_messages;
+	message = net_message;
+
+	loop_client = sender;
+	loop_server = receiver;
+	sender->driverdata = (void *)receiver;
+	receiver->driverdata = (void *)sender;
+	Loop_ClearQueue (sender);
+	Loop_ClearQueue (receiver);
+
+	sent = received = bytes = 0;
+	failed = false;
+	while (received < LOOPCHECK_MESSAGES && !failed)
+	{
+		lastsent = sent;
+		lastreceived = received;
+
+	// a burst of sends, until the queue is full
+		for (i = 1 + (sent + received) % 7 ; i && sent < LOOPCHECK_MESSAGES ; i--)
+		{
+			Loop_CheckBuild (&sb, sent);
+			if (!Loop_QueueMessage (sender, &sb, 1 + (sent & 1)))
+				break;
+			sent++;
+		}
+
+	// and a burst of reads
+		for (i = 1 + (3*sent + received) % 5 ; i ; i--)
+		{
+			ret = Loop_GetMessage (receiver);
+			if (!ret)
+				break;
+
+			if (sent < LOOPCHECK_MESSAGES)
+			{	// sending on while the message is still being read
+				Loop_CheckBuild (&sb, sent);
+				if (Loop_QueueMessage (sender, &sb, 1 + (sent & 1)))
+					sent++;
+			}
+
+			length = net_message.cursize;
+			inplacelength = Loop_CheckParse (inplace);
+
+			NET_ResetMessage ();
+			Loop_CheckBuild (&net_message, received);
+			copiedlength = Loop_CheckParse (copied);
+
+			if (ret != 1 + (received & 1) || length != net_message.cursize
+			|| inplacelength != copiedlength
+			|| memcmp (inplace, copied, inplacelength))
+			{
+				Con_Printf ("message %i: type %i, %i bytes, %i parsed in place; "
+					"type %i, %i bytes, %i parsed from a copy\n", received,
+					ret, length, inplacelength, 1 + (received & 1),
+					net_message.cursize, copiedlength);
+				failed = true;
+				break;
+			}
+			bytes += length;
+			received++;
+		}
+
+		if (sent == lastsent && received == lastreceived && !failed)
+		{
+			Con_Printf ("queue stuck after %i messages\n", received);
+			failed = true;
+		}
+	}
+
+	loop_client = client;
+	loop_server = server;
+	loop_queues[0] = queues[0];
+	loop_queues[1] = queues[1];
+	loop_bytescopied = copiedbytes;
+	loop_bytesinplace = inplacebytes;
+	loop_messages = messages;
+	net_message = message;
+	Tier_Free (block);
+
+	if (!failed)
+		Con_Printf ("%i messages, %i bytes: in place and copied parse the same\n",
+			received, bytes);
+}
@@ -51,11 +51,14 @@ static int		slistLastShown;
 
 static void Slist_Send(void);
 static void Slist_Poll(void);
+static void NET_Csv_f (void);
 PollProcedure	slistSendProcedure = {NULL, 0.0, Slist_Send};
 PollProcedure	slistPollProcedure = {NULL, 0.0, Slist_Poll};
 
 
 sizebuf_t		net_message;
+static byte		*net_messagebuffer;
+static int		net_messagemaxsize;
 int				net_activeconnections = 0;
 
 int messagesSent = 0;
@@ -76,6 +79,183 @@ cvar_t	config_modem_clear = {"_config_modem_clear", "ATZ", true};
 cvar_t	config_modem_init = {"_config_modem_init", "", true};
 cvar_t	config_modem_hangup = {"_config_modem_hangup", "AT H", true};
 
+/*
+===============================================================================
+
+TELEMETRY
+
+Every qsocket keeps message and byte counts, whatever its driver.  The
+datagram driver adds packet counts, retransmits, unreliable drops, the
+round trip of each reliable packet that was acknowledged without being
+resent, and the interarrival jitter of unreliable datagrams.  Arrival
+times are taken when the game polls, so frame pacing shows up in the
+jitter, just as it does on screen.
+
+===============================================================================
+*/
+
+static int	net_histbounds[NET_HISTBUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100, 200};
+
+static void NET_HistogramAdd (int *histogram, double seconds)
+{
+	int		i, ms;
+
+	ms = (int)(seconds * 1000);
+	for (i=0 ; i<NET_HISTBUCKETS-1 ; i++)
+		if (ms < net_histbounds[i])
+			break;
+	histogram[i]++;
+}
+
+void NET_SampleRTT (qsocket_t *sock, double rtt)
+{
+	sock->stats.rtt = rtt;
+	NET_HistogramAdd (sock->stats.rttHistogram, rtt);
+}
+
+/*
+===================
+NET_SampleArrival
+
+Smooths the variation between successive gaps the way RFC 1889 does
+with transit times: J += (|D| - J) / 16.
+===================
+*/
+void NET_SampleArrival (qsocket_t *sock)
+{
+	netstats_t	*st;
+	float		gap, d;
+
+	st = &sock->stats;
+	if (st->lastArrival)
+	{
+		gap = net_time - st->lastArrival;
+		if (st->lastGap)
+		{
+			d = fabs (gap - st->lastGap);
+			st->jitter += (d - st->jitter) / 16;
+			NET_HistogramAdd (st->jitterHistogram, d);
+		}
+		st->lastGap = gap;
+	}
+	st->lastArrival = net_time;
+}
+
+void NET_UpdateRates (qsocket_t *sock)
+{
+	netstats_t	*st;
+	double		elapsed;
+
+	st = &sock->stats;
+	elapsed = net_time - st->rateTime;
+	if (elapsed < 1.0)
+		return;
+
+	st->sendRate = (st->bytesSent - st->rateBytesSent) / elapsed;
+	st->receiveRate = (st->bytesReceived - st->rateBytesReceived) / elapsed;
+	st->rateBytesSent = st->bytesSent;
+	st->rateBytesReceived = st->bytesReceived;
+	st->rateTime = net_time;
+}
+
+static void NET_PrintHistogram (char *name, int *histogram)
+{
+	int		i;
+
+	Con_Printf ("%s", name);
+	for (i=0 ; i<NET_HISTBUCKETS ; i++)
+		Con_Printf (" %5i", histogram[i]);
+	Con_Printf ("\n");
+}
+
+void NET_PrintTelemetry (qsocket_t *s)
+{
+	netstats_t	*st;
+
+	st = &s->stats;
+	SetNetTime ();
+	NET_UpdateRates (s);
+
+	Con_Printf ("messages out/in = %i / %i\n", st->messagesSent, st->messagesReceived);
+	Con_Printf ("bytes out/in    = %i / %i (%.0f / %.0f per sec)\n", st->bytesSent, st->bytesReceived, st->sendRate, st->receiveRate);
+	Con_Printf ("packets out/in  = %i / %i\n", st->packetsSent, st->packetsReceived);
+	Con_Printf ("resent          = %i\n", st->packetsReSent);
+	Con_Printf ("dropped         = %i\n", st->droppedDatagrams);
+	Con_Printf ("duplicates      = %i\n", st->duplicates);
+	Con_Printf ("rtt             = %.1f ms\n", st->rtt * 1000);
+	Con_Printf ("jitter          = %.1f ms\n", st->jitter * 1000);
+	Con_Printf ("ms      <1    <2    <5   <10   <20   <50  <100  <200 more\n");
+	NET_PrintHistogram ("rtt   ", st->rttHistogram);
+	NET_PrintHistogram ("jitter", st->jitterHistogram);
+}
+
+/*
+===================
+NET_Csv_f
+
+net_csv [file]
+Appends a row per open socket to a CSV file in the game directory,
+writing the header first if the file is new.
+===================
+*/
+static void NET_Csv_f (void)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	qboolean	header;
+	qsocket_t	*s;
+	netstats_t	*st;
+	int			i;
+
+	i = snprintf (name, sizeof(name), "%s/%s", com_gamedir,
+			Cmd_Argc () > 1 ? Cmd_Argv (1) : "netstats.csv");
+	if (i < 0 || i >= sizeof(name))
+	{
+		Con_Printf ("net_csv: file name too long\n");
+		return;
+	}
+
+	f = fopen (name, "r");
+	header = (f == NULL);
+	if (f)
+		fclose (f);
+
+	f = fopen (name, "a");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return;
+	}
+
+	if (header)
+	{
+		fprintf (f, "time,address,messages_out,messages_in,bytes_out,bytes_in,packets_out,packets_in,resent,dropped,duplicates,rtt_ms,jitter_ms");
+		for (i=0 ; i<NET_HISTBUCKETS ; i++)
+			fprintf (f, ",rtt_h%i", i);
+		for (i=0 ; i<NET_HISTBUCKETS ; i++)
+			fprintf (f, ",jitter_h%i", i);
+		fprintf (f, "\n");
+	}
+
+	for (s = net_activeSockets ; s ; s = s->next)
+	{
+		st = &s->stats;
+		fprintf (f, "%.3f,%s,%i,%i,%i,%i,%i,%i,%i,%i,%i,%.2f,%.2f", realtime, s->address,
+			st->messagesSent, st->messagesReceived, st->bytesSent, st->bytesReceived,
+			st->packetsSent, st->packetsReceived, st->packetsReSent, st->droppedDatagrams,
+			st->duplicates, st->rtt * 1000, st->jitter * 1000);
+		for (i=0 ; i<NET_HISTBUCKETS ; i++)
+			fprintf (f, ",%i", st->rttHistogram[i]);
+		for (i=0 ; i<NET_HISTBUCKETS ; i++)
+			fprintf (f, ",%i", st->jitterHistogram[i]);
+		fprintf (f, "\n");
+	}
+
+	fclose (f);
+	Con_Printf ("Wrote %s\n", name);
+}
+
+
 #ifdef IDGODS
 cvar_t	idgods = {"idgods", "0"};
 #endif
@@ -141,6 +321,8 @@ qsocket_t *NET_NewQSocket (void)
 	sock->receiveSequence = 0;
 	sock->unreliableReceiveSequence = 0;
 	sock->receiveMessageLength = 0;
+	memset (&sock->stats, 0, sizeof(sock->stats));
+	sock->stats.rateTime = net_time;
 
 	return sock;
 }
@@ -314,6 +496,7 @@ void NET_Slist_f (void)
 
 static void Slist_Send(void)
 {
+	NET_ResetMessage ();
 	for (net_driverlevel=0; net_driverlevel < net_numdrivers; net_driverlevel++)
 	{
 		if (!slistLocal && net_driverlevel == 0)
@@ -330,6 +513,7 @@ static void Slist_Send(void)
 
 static void Slist_Poll(void)
 {
+	NET_ResetMessage ();
 	for (net_driverlevel=0; net_driverlevel < net_numdrivers; net_driverlevel++)
 	{
 		if (!slistLocal && net_driverlevel == 0)
@@ -373,6 +557,7 @@ qsocket_t *NET_Connect (char *host)
 
 	printf("NET_Connect %s\n", host);
 	SetNetTime();
+	NET_ResetMessage ();
 
 	if (host && *host == 0)
 		host = NULL;
@@ -460,6 +645,7 @@ qsocket_t *NET_CheckNewConnections (void)
 	qsocket_t	*ret;
 
 	SetNetTime();
+	NET_ResetMessage ();
 
 	for (net_driverlevel=0 ; net_driverlevel<net_numdrivers; net_driverlevel++)
 	{
@@ -515,6 +701,20 @@ void NET_Close (qsocket_t *sock)
 }
 
 
+/*
+=================
+NET_ResetMessage
+
+The loopback driver hands out messages in place by pointing net_message
+at its queues; this gives net_message its own buffer back.
+=================
+*/
+void NET_ResetMessage (void)
+{
+	net_message.data = net_messagebuffer;
+	net_message.maxsize = net_messagemaxsize;
+}
+
 /*
 =================
 NET_GetMessage
@@ -552,6 +752,7 @@ int	NET_GetMessage (qsocket_t *sock)
 	}
 
 	SetNetTime();
+	NET_ResetMessage ();
 
 	ret = sfunc.QGetMessage(sock);
 
@@ -568,6 +769,9 @@ int	NET_GetMessage (qsocket_t *sock)
 
 	if (ret > 0)
 	{
+		sock->stats.messagesReceived++;
+		sock->stats.bytesReceived += net_message.cursize;
+
 		if (sock->driver)
 		{
 			sock->lastMessageTime = net_time;
@@ -638,8 +842,13 @@ int NET_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	SetNetTime();
 	r = sfunc.QSendMessage(sock, data);
-	if (r == 1 && sock->driver)
-		messagesSent++;
+	if (r == 1)
+	{
+		if (sock->driver)
+			messagesSent++;
+		sock->stats.messagesSent++;
+		sock->stats.bytesSent += data->cursize;
+	}
 
 	if (recording)
 	{
@@ -669,8 +878,13 @@ int NET_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 
 	SetNetTime();
 	r = sfunc.SendUnreliableMessage(sock, data);
-	if (r == 1 && sock->driver)
-		unreliableMessagesSent++;
+	if (r == 1)
+	{
+		if (sock->driver)
+			unreliableMessagesSent++;
+		sock->stats.messagesSent++;
+		sock->stats.bytesSent += data->cursize;
+	}
 
 	if (recording)
 	{
@@ -850,6 +1064,8 @@ void NET_Init (void)
 
 	// allocate space for network message buffer
 	SZ_Alloc (&net_message, NET_MAXMESSAGE);
+	net_messagebuffer = net_message.data;
+	net_messagemaxsize = net_message.maxsize;
 
 	Cvar_RegisterVariable (&net_messagetimeout);
 	Cvar_RegisterVariable (&hostname);
@@ -869,6 +1085,7 @@ void NET_Init (void)
 	Cmd_AddCommand ("listen", NET_Listen_f);
 	Cmd_AddCommand ("maxplayers", MaxPlayers_f);
 	Cmd_AddCommand ("port", NET_Port_f);
+	Cmd_AddCommand ("net_csv", NET_Csv_f);
 
 	// initialize all the drivers
 	for (net_driverlevel=0 ; net_driverlevel<net_numdrivers ; net_driverlevel++)
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 #include "net_loop.h"
+#include "net_bot.h"
 
 net_driver_t net_drivers[MAX_NET_DRIVERS] =
 {
@@ -39,8 +40,25 @@ net_driver_t net_drivers[MAX_NET_DRIVERS] =
 	Loop_Close,
 	Loop_Shutdown
 	}
+	,
+	{
+	"Bots",
+	false,
+	Bot_Init,
+	Bot_Listen,
+	Bot_SearchForHosts,
+	Bot_Connect,
+	Bot_CheckNewConnections,
+	Bot_GetMessage,
+	Bot_SendMessage,
+	Bot_SendUnreliableMessage,
+	Bot_CanSendMessage,
+	Bot_CanSendUnreliableMessage,
+	Bot_Close,
+	Bot_Shutdown
+	}
 };
-int net_numdrivers = 1;
+int net_numdrivers = 2;
 
 net_landriver_t	net_landrivers[MAX_NET_DRIVERS];
 int net_numlandrivers = 0;
@@ -30,7 +30,7 @@ void QG_Create(int argc, char *argv[])
 	static quakeparms_t    parms;
 
 	parms.memsize = 20*1024*1024;
-	parms.membase = malloc (parms.memsize);
+	parms.membase = Tier_Alloc (parms.memsize, mem_bulk, "hunk");
 	parms.basedir = ".";
 
 	COM_InitArgv (argc, argv);
@@ -55,6 +55,54 @@ int				r_anumverts;
 
 float	aliastransform[3][4];
 
+// static entities keep their last lit and projected vertices in the cache;
+// the lighting stays valid as long as the pose and light do, the projection
+// only while the view transform is also bit-for-bit unchanged
+typedef struct
+{
+	float		transform[3][4];
+	float		xcenter, ycenter, xscale, yscale, ziscale;
+	int			vrect[4];
+	int			trivial_accept;
+} aliasviewkey_t;
+
+typedef struct
+{
+	int				numverts;
+	trivertx_t		*pverts;		// pose the lighting was done for
+	int				ambientlight;
+	float			shadelight;
+	vec3_t			lightvec;
+	aliasviewkey_t	view;
+	qboolean		lit;			// finalverts v[4] valid
+	qboolean		projected;		// all of finalverts (and auxverts) valid
+	qboolean		clipped;		// auxverts were stored
+// finalvert_t[numverts] and auxvert_t[numverts] follow
+} aliaspose_t;
+
+static aliaspose_t		*r_apose;	// NULL if the entity isn't cached
+static trivertx_t		*r_aposeverts;
+static aliasviewkey_t	r_aviewkey;
+int						r_aposecached;
+
+// colored players draw from a copy of their skin with the color ranges
+// already remapped, so they can use the shared colormap instead of their
+// own translation table.  A player's colormap is also on their corpses and
+// gibbed head, so each slot keeps a few copies
+#define	MAX_SLOTSKINS	3
+
+typedef struct
+{
+	model_t			*model;
+	int				skin;			// offset of the source skin in the model
+	int				colors;
+	int				framecount;		// last drawn
+	cache_user_t	cache;
+} transskin_t;
+
+static transskin_t	r_transskins[MAX_SCOREBOARD][MAX_SLOTSKINS];
+static void			*r_askincolormap;
+
 typedef struct {
 	int	index0;
 	int	index1;
@@ -79,6 +127,9 @@ void R_AliasTransformVector (vec3_t in, vec3_t out);
 void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av,
 	trivertx_t *pverts, stvert_t *pstverts);
 void R_AliasProjectFinalVert (finalvert_t *fv, auxvert_t *av);
+void R_AliasLightFinalVerts (finalvert_t *fv);
+qboolean R_AliasReusePose (void);
+void R_AliasStorePose (void);
 
 
 /*
@@ -97,6 +148,7 @@ qboolean R_AliasCheckBBox (void)
 	qboolean			zclipped, zfullyclipped;
 	unsigned			anyclip, allclip;
 	int					minz;
+	float				umin, umax, vmin, vmax, nearzi;
 	
 // expand, rotate, and translate points into worldspace
 
@@ -199,6 +251,9 @@ qboolean R_AliasCheckBBox (void)
 // project the vertices that remain after clipping
 	anyclip = 0;
 	allclip = ALIAS_XY_CLIP_MASK;
+	umin = vmin = 999999;
+	umax = vmax = -999999;
+	nearzi = 0;
 
 // TODO: probably should do this loop in ASM, especially if we use floats
 	for (i=0 ; i<numv ; i++)
@@ -213,6 +268,17 @@ qboolean R_AliasCheckBBox (void)
 		v0 = (viewaux[i].fv[0] * xscale * zi) + xcenter;
 		v1 = (viewaux[i].fv[1] * yscale * zi) + ycenter;
 
+		if (v0 < umin)
+			umin = v0;
+		if (v0 > umax)
+			umax = v0;
+		if (v1 < vmin)
+			vmin = v1;
+		if (v1 > vmax)
+			vmax = v1;
+		if (zi > nearzi)
+			nearzi = zi;
+
 		flags = 0;
 
 		if (v0 < r_refdef.fvrectx)
@@ -231,6 +297,13 @@ qboolean R_AliasCheckBBox (void)
 	if (allclip)
 		return false;	// trivial reject off one side
 
+	if (D_HiZOccluded ((int)umin - 1, (int)vmin - 1, (int)umax + 1, (int)vmax + 1,
+		(int)(nearzi * 0x8000) + 1))
+	{
+		d_hizmodels++;
+		return false;	// behind the world everywhere it would land
+	}
+
 	currententity->trivial_accept = !anyclip & !zclipped;
 
 	if (currententity->trivial_accept)
@@ -279,24 +352,30 @@ void R_AliasPreparePoints (void)
  	fv = pfinalverts;
 	av = pauxverts;
 
-	for (i=0 ; i<r_anumverts ; i++, fv++, av++, r_apverts++, pstverts++)
+	if (!R_AliasReusePose ())
 	{
-		R_AliasTransformFinalVert (fv, av, r_apverts, pstverts);
-		if (av->fv[2] < ALIAS_Z_CLIP_PLANE)
-			fv->flags |= ALIAS_Z_CLIP;
-		else
+		for (i=0 ; i<r_anumverts ; i++, fv++, av++, r_apverts++, pstverts++)
 		{
-			 R_AliasProjectFinalVert (fv, av);
-
-			if (fv->v[0] < r_refdef.aliasvrect.x)
-				fv->flags |= ALIAS_LEFT_CLIP;
-			if (fv->v[1] < r_refdef.aliasvrect.y)
-				fv->flags |= ALIAS_TOP_CLIP;
-			if (fv->v[0] > r_refdef.aliasvrectright)
-				fv->flags |= ALIAS_RIGHT_CLIP;
-			if (fv->v[1] > r_refdef.aliasvrectbottom)
-				fv->flags |= ALIAS_BOTTOM_CLIP;	
+			R_AliasTransformFinalVert (fv, av, r_apverts, pstverts);
+			if (av->fv[2] < ALIAS_Z_CLIP_PLANE)
+				fv->flags |= ALIAS_Z_CLIP;
+			else
+			{
+				 R_AliasProjectFinalVert (fv, av);
+
+				if (fv->v[0] < r_refdef.aliasvrect.x)
+					fv->flags |= ALIAS_LEFT_CLIP;
+				if (fv->v[1] < r_refdef.aliasvrect.y)
+					fv->flags |= ALIAS_TOP_CLIP;
+				if (fv->v[0] > r_refdef.aliasvrectright)
+					fv->flags |= ALIAS_RIGHT_CLIP;
+				if (fv->v[1] > r_refdef.aliasvrectbottom)
+					fv->flags |= ALIAS_BOTTOM_CLIP;	
+			}
 		}
+
+		R_AliasLightFinalVerts (pfinalverts);
+		R_AliasStorePose ();
 	}
 
 //
@@ -415,9 +494,6 @@ R_AliasTransformFinalVert
 void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av,
 	trivertx_t *pverts, stvert_t *pstverts)
 {
-	int		temp;
-	float	lightcos, *plightnormal;
-
 	av->fv[0] = DotProduct(pverts->v, aliastransform[0]) +
 			aliastransform[0][3];
 	av->fv[1] = DotProduct(pverts->v, aliastransform[1]) +
@@ -429,23 +505,6 @@ void R_AliasTransformFinalVert (finalvert_t *fv, auxvert_t *av,
 	fv->v[3] = pstverts->t;
 
 	fv->flags = pstverts->onseam;
-
-// lighting
-	plightnormal = r_avertexnormals[pverts->lightnormalindex];
-	lightcos = DotProduct (plightnormal, r_plightvec);
-	temp = r_ambientlight;
-
-	if (lightcos < 0)
-	{
-		temp += (int)(r_shadelight * lightcos);
-
-	// clamp; because we limited the minimum ambient and shading light, we
-	// don't have to clamp low light, just bright
-		if (temp < 0)
-			temp = 0;
-	}
-
-	fv->v[4] = temp;
 }
 
 /*
@@ -455,8 +514,8 @@ R_AliasTransformAndProjectFinalVerts
 */
 void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts)
 {
-	int			i, temp;
-	float		lightcos, *plightnormal, zi;
+	int			i;
+	float		zi;
 	trivertx_t	*pverts;
 
 	pverts = r_apverts;
@@ -480,8 +539,39 @@ void R_AliasTransformAndProjectFinalVerts (finalvert_t *fv, stvert_t *pstverts)
 		fv->v[2] = pstverts->s;
 		fv->v[3] = pstverts->t;
 		fv->flags = pstverts->onseam;
+	}
+}
+
+/*
+================
+R_AliasLightFinalVerts
+
+Vertex lighting only depends on the pose and the light, not the view, so a
+cached static entity takes it from its last frame whenever those still match
+================
+*/
+void R_AliasLightFinalVerts (finalvert_t *fv)
+{
+	int			i, temp;
+	float		lightcos, *plightnormal;
+	trivertx_t	*pverts;
+	finalvert_t	*cached;
+
+	if (r_apose && r_apose->lit && r_apose->pverts == r_aposeverts &&
+		r_apose->ambientlight == r_ambientlight &&
+		r_apose->shadelight == r_shadelight &&
+		VectorCompare (r_apose->lightvec, r_plightvec))
+	{
+		cached = (finalvert_t *)(r_apose + 1);
+		for (i=0 ; i<r_anumverts ; i++)
+			fv[i].v[4] = cached[i].v[4];
+		return;
+	}
 
-	// lighting
+	pverts = r_aposeverts;
+
+	for (i=0 ; i<r_anumverts ; i++, fv++, pverts++)
+	{
 		plightnormal = r_avertexnormals[pverts->lightnormalindex];
 		lightcos = DotProduct (plightnormal, r_plightvec);
 		temp = r_ambientlight;
@@ -534,7 +624,12 @@ void R_AliasPrepareUnclippedPoints (void)
 // FIXME: just use pfinalverts directly?
 	fv = pfinalverts;
 
-	R_AliasTransformAndProjectFinalVerts (fv, pstverts);
+	if (!R_AliasReusePose ())
+	{
+		R_AliasTransformAndProjectFinalVerts (fv, pstverts);
+		R_AliasLightFinalVerts (fv);
+		R_AliasStorePose ();
+	}
 
 	if (r_affinetridesc.drawtype)
 		D_PolysetDrawFinalVerts (fv, r_anumverts);
@@ -547,6 +642,113 @@ void R_AliasPrepareUnclippedPoints (void)
 	D_PolysetDraw ();
 }
 
+/*
+===============
+R_AliasTranslatedSkin
+
+Returns the current entity's skin at offset skinofs with its player's
+colors applied, translating it again only when the colors or the skin
+changed, or NULL if the entity isn't a player or the copy couldn't be made.
+Players with colors 0 just draw their own skin through the translation
+table, and so does anything that would throw out a copy already drawn this
+frame.  May reload the model, so paliashdr and pmdl have to be refetched
+after.
+===============
+*/
+byte *R_AliasTranslatedSkin (int skinofs)
+{
+	int			i, slot, size;
+	int			colors, top, bottom;
+	byte		remap[256];
+	byte		*skin, *source;
+	transskin_t	*ts, *oldest;
+
+	for (slot=0 ; slot<cl.maxclients && slot<MAX_SCOREBOARD ; slot++)
+		if (currententity->colormap == cl.scores[slot].translations)
+			break;
+	if (slot == cl.maxclients || slot == MAX_SCOREBOARD)
+		return NULL;
+
+	colors = cl.scores[slot].colors;
+	if (!colors)
+		return NULL;
+
+	oldest = NULL;
+	for (i=0, ts=r_transskins[slot] ; i<MAX_SLOTSKINS ; i++, ts++)
+	{
+		skin = Cache_Check (&ts->cache);
+		if (!skin)
+		{
+			if (!oldest || Cache_Check (&oldest->cache))
+				oldest = ts;
+			continue;
+		}
+		if (ts->model == currententity->model && ts->skin == skinofs)
+		{
+			if (ts->colors == colors)
+			{
+				ts->framecount = r_framecount;
+				return skin;
+			}
+			oldest = ts;		// the same skin in old colors
+			break;
+		}
+		if (!oldest || (Cache_Check (&oldest->cache) &&
+			ts->framecount < oldest->framecount))
+			oldest = ts;
+	}
+
+	ts = oldest;
+	if (Cache_Check (&ts->cache))
+	{
+		if (ts->framecount == r_framecount && (ts->model != currententity->model
+			|| ts->skin != skinofs))
+			return NULL;	// more copies in view than the slot keeps
+		Cache_Free (&ts->cache);
+	}
+
+	size = pmdl->skinwidth * pmdl->skinheight;
+	Cache_Alloc (&ts->cache, size, "transskin");
+
+// making room may have thrown out the model, and reloading it may have thrown
+// out the copy again
+	paliashdr = (aliashdr_t *)Mod_Extradata (currententity->model);
+	pmdl = (mdl_t *)((byte *)paliashdr + paliashdr->model);
+	skin = Cache_Check (&ts->cache);
+	if (!skin)
+		return NULL;
+
+// the same remapping CL_NewTranslation applies to every light level
+	for (i=0 ; i<256 ; i++)
+		remap[i] = i;
+
+	top = colors & 0xf0;
+	bottom = (colors & 15) << 4;
+	for (i=0 ; i<16 ; i++)
+	{
+		if (top < 128)	// the artists made some backwards ranges.  sigh.
+			remap[TOP_RANGE+i] = top + i;
+		else
+			remap[TOP_RANGE+i] = top + 15 - i;
+
+		if (bottom < 128)
+			remap[BOTTOM_RANGE+i] = bottom + i;
+		else
+			remap[BOTTOM_RANGE+i] = bottom + 15 - i;
+	}
+
+	source = (byte *)paliashdr + skinofs;
+	for (i=0 ; i<size ; i++)
+		skin[i] = remap[source[i]];
+
+	ts->model = currententity->model;
+	ts->skin = skinofs;
+	ts->colors = colors;
+	ts->framecount = r_framecount;
+
+	return skin;
+}
+
 /*
 ===============
 R_AliasSetupSkin
@@ -559,6 +761,8 @@ void R_AliasSetupSkin (void)
 	maliasskingroup_t	*paliasskingroup;
 	float				*pskinintervals, fullskininterval;
 	float				skintargettime, skintime;
+	aliashdr_t			*pahdr;
+	byte				*skin;
 
 	skinnum = currententity->skinnum;
 	if ((skinnum >= pmdl->numskins) || (skinnum < 0))
@@ -601,6 +805,29 @@ void R_AliasSetupSkin (void)
 	r_affinetridesc.skinwidth = a_skinwidth;
 	r_affinetridesc.seamfixupX16 =  (a_skinwidth >> 1) << 16;
 	r_affinetridesc.skinheight = pmdl->skinheight;
+
+	r_askincolormap = currententity->colormap;
+	if (r_skincache.value && currententity->colormap != vid.colormap)
+	{
+		pahdr = paliashdr;
+		skin = R_AliasTranslatedSkin (pskindesc->skin);
+
+		if (paliashdr != pahdr)
+		{	// making room for the copy threw out the model, which was
+			// reloaded somewhere else
+			pskindesc = (maliasskindesc_t *)((byte *)paliashdr +
+					((byte *)pskindesc - (byte *)pahdr));
+			r_affinetridesc.pskindesc = pskindesc;
+			r_affinetridesc.pskin = (void *)((byte *)paliashdr +
+					pskindesc->skin);
+		}
+
+		if (skin)
+		{
+			r_affinetridesc.pskin = skin;
+			r_askincolormap = vid.colormap;
+		}
+	}
 }
 
 /*
@@ -689,6 +916,124 @@ void R_AliasSetupFrame (void)
 }
 
 
+/*
+================
+R_AliasPoseCache
+
+Returns the pose cache of the current static entity, allocating it if it
+was never made or was flushed, or NULL if it couldn't be kept
+================
+*/
+aliaspose_t *R_AliasPoseCache (void)
+{
+	aliaspose_t	*pose;
+	int			size;
+
+	pose = Cache_Check (&currententity->posecache);
+	if (pose && pose->numverts == pmdl->numverts)
+		return pose;
+	if (pose)
+		Cache_Free (&currententity->posecache);	// model changed
+
+	size = sizeof(aliaspose_t) +
+			pmdl->numverts * (sizeof(finalvert_t) + sizeof(auxvert_t));
+	pose = Cache_Alloc (&currententity->posecache, size, "aliaspose");
+	pose->numverts = pmdl->numverts;
+	pose->lit = false;
+	pose->projected = false;
+
+// making room may have thrown out the model, and reloading it may have thrown
+// out the pose again
+	paliashdr = (aliashdr_t *)Mod_Extradata (currententity->model);
+	pmdl = (mdl_t *)((byte *)paliashdr + paliashdr->model);
+
+	return Cache_Check (&currententity->posecache);
+}
+
+/*
+================
+R_AliasReusePose
+
+Copies the cached vertices of a static entity if nothing they depend on
+has changed since they were stored
+================
+*/
+qboolean R_AliasReusePose (void)
+{
+	finalvert_t	*cached;
+
+	if (!r_apose || !r_apose->projected || r_apose->pverts != r_aposeverts ||
+		r_apose->ambientlight != r_ambientlight ||
+		r_apose->shadelight != r_shadelight ||
+		!VectorCompare (r_apose->lightvec, r_plightvec) ||
+		memcmp (&r_apose->view, &r_aviewkey, sizeof(r_aviewkey)))
+		return false;
+
+	cached = (finalvert_t *)(r_apose + 1);
+	memcpy (pfinalverts, cached, r_anumverts * sizeof(finalvert_t));
+	if (r_apose->clipped)
+		memcpy (pauxverts, cached + r_anumverts,
+				r_anumverts * sizeof(auxvert_t));
+
+	r_aposecached++;
+	return true;
+}
+
+/*
+================
+R_AliasStorePose
+================
+*/
+void R_AliasStorePose (void)
+{
+	finalvert_t	*cached;
+
+	if (!r_apose)
+		return;
+
+	cached = (finalvert_t *)(r_apose + 1);
+	memcpy (cached, pfinalverts, r_anumverts * sizeof(finalvert_t));
+
+// the unclipped path never fills in the auxverts
+	r_apose->clipped = !r_aviewkey.trivial_accept;
+	if (r_apose->clipped)
+		memcpy (cached + r_anumverts, pauxverts,
+				r_anumverts * sizeof(auxvert_t));
+
+	r_apose->pverts = r_aposeverts;
+	r_apose->ambientlight = r_ambientlight;
+	r_apose->shadelight = r_shadelight;
+	VectorCopy (r_plightvec, r_apose->lightvec);
+	r_apose->view = r_aviewkey;
+	r_apose->lit = true;
+	r_apose->projected = true;
+}
+
+/*
+================
+R_AliasSetupPoseKey
+
+Records what the cached vertices depend on: the pose after frame groups are
+resolved and everything the view transform and projection use
+================
+*/
+void R_AliasSetupPoseKey (void)
+{
+	r_aposeverts = r_apverts;
+
+	memcpy (r_aviewkey.transform, aliastransform, sizeof(aliastransform));
+	r_aviewkey.xcenter = aliasxcenter;
+	r_aviewkey.ycenter = aliasycenter;
+	r_aviewkey.xscale = aliasxscale;
+	r_aviewkey.yscale = aliasyscale;
+	r_aviewkey.ziscale = ziscale;
+	r_aviewkey.vrect[0] = r_refdef.aliasvrect.x;
+	r_aviewkey.vrect[1] = r_refdef.aliasvrect.y;
+	r_aviewkey.vrect[2] = r_refdef.aliasvrectright;
+	r_aviewkey.vrect[3] = r_refdef.aliasvrectbottom;
+	r_aviewkey.trivial_accept = currententity->trivial_accept;
+}
+
 /*
 ================
 R_AliasDrawModel
@@ -710,7 +1055,14 @@ void R_AliasDrawModel (alight_t *plighting)
 	paliashdr = (aliashdr_t *)Mod_Extradata (currententity->model);
 	pmdl = (mdl_t *)((byte *)paliashdr + paliashdr->model);
 
+// static entities never move, so only a view change invalidates their pose
+	r_apose = NULL;
+	if (r_staticcache.value && R_IsStaticEntity (currententity))
+		r_apose = R_AliasPoseCache ();
+
 	R_AliasSetupSkin ();
+	if (r_apose)	// the skin copy may have pushed it out
+		r_apose = Cache_Check (&currententity->posecache);
 	R_AliasSetUpTransform (currententity->trivial_accept);
 	R_AliasSetupLighting (plighting);
 	R_AliasSetupFrame ();
@@ -726,13 +1078,15 @@ void R_AliasDrawModel (alight_t *plighting)
 		D_PolysetUpdateTables ();		// FIXME: precalc...
 	}
 
-	acolormap = currententity->colormap;
+	acolormap = r_askincolormap;
 
 	if (currententity != &cl.viewent)
 		ziscale = (float)0x8000 * (float)0x10000;
 	else
 		ziscale = (float)0x8000 * (float)0x10000 * 3.0;
 
+	R_AliasSetupPoseKey ();
+
 	if (currententity->trivial_accept)
 		R_AliasPrepareUnclippedPoints ();
 	else
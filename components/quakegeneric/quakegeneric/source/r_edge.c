@@ -37,6 +37,8 @@ have a sentinal at both ends?
 edge_t	*auxedges;
 edge_t	*r_edges, *edge_p, *edge_max;
 
+byte	*r_basespans;		// MAXSPANS, from R_Init
+
 surf_t	*surfaces, *surface_p, *surf_max;
 
 // surfaces are generated in back to front order by the bsp, so if a surf
@@ -52,8 +54,23 @@ int		r_currentkey;
 
 extern	int	screenwidth;
 
+extern	pixel_t			*d_viewbuffer;
+extern	short			*d_pzbuffer;
+extern	unsigned int	d_zwidth;
+
 int	current_iv;
 
+// tiled mode: spans are drawn a band of R_TILEROWS lines at a time into
+// on-chip buffers, which are then copied out to the frame and z buffers
+// a whole row at a time
+byte	*r_tilecolor;
+short	*r_tilez;
+int		r_tilewidth;
+
+static qboolean	r_tiling;
+static int		r_bandstart;
+static espan_t	*basespan_p;
+
 int	edge_head_u_shift20, edge_tail_u_shift20;
 
 static void (*pdrawfunc)(void);
@@ -638,19 +655,75 @@ Output:
 Each surface has a linked list of its visible spans
 ==============
 */
+/*
+==============
+R_FlushSpans
+
+Draws the spans collected so far.  When tiling, they land in the band
+buffers, and when the band is complete it is copied out.
+==============
+*/
+static void R_FlushSpans (qboolean endband)
+{
+	pixel_t	*viewbuffer;
+	short	*zbuffer;
+	surf_t	*s;
+	int		v, x, w;
+
+	if (r_drawculledpolys)
+	{
+		R_DrawCulledPolys ();
+	}
+	else if (r_tiling)
+	{
+		viewbuffer = d_viewbuffer;
+		zbuffer = d_pzbuffer;
+		d_viewbuffer = r_tilecolor - r_bandstart*screenwidth;
+		d_pzbuffer = r_tilez - r_bandstart*d_zwidth;
+		D_DrawSurfaces ();
+		d_viewbuffer = viewbuffer;
+		d_pzbuffer = zbuffer;
+
+		if (endband)
+		{
+			x = r_refdef.vrect.x;
+			w = r_refdef.vrectright - x;
+			for (v=r_bandstart ; v<=current_iv ; v++)
+			{
+				memcpy (d_viewbuffer + v*screenwidth + x,
+					r_tilecolor + (v - r_bandstart)*screenwidth + x, w);
+				memcpy (d_pzbuffer + v*d_zwidth + x,
+					r_tilez + (v - r_bandstart)*d_zwidth + x, w*sizeof(short));
+			}
+			r_bandstart = current_iv + 1;
+		}
+	}
+	else
+	{
+		D_DrawSurfaces ();
+	}
+
+// clear the surface span pointers
+	for (s = &surfaces[1] ; s<surface_p ; s++)
+		s->spans = NULL;
+
+	span_p = basespan_p;
+}
+
 void R_ScanEdges (void)
 {
 	int		iv, bottom;
-	byte	basespans[MAXSPANS*sizeof(espan_t)+CACHE_SIZE];
-	espan_t	*basespan_p;
-	surf_t	*s;
 
 	basespan_p = (espan_t *)
-			((intptr_t)(basespans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
+			((intptr_t)(r_basespans + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
 	max_span_p = &basespan_p[MAXSPANS - r_refdef.vrect.width];
 
 	span_p = basespan_p;
 
+	r_tiling = r_tiled.value && r_tilecolor && !r_drawculledpolys
+		&& screenwidth <= r_tilewidth && d_zwidth <= r_tilewidth;
+	r_bandstart = r_refdef.vrect.y;
+
 // clear active edges to just the background edges around the whole screen
 // FIXME: most of this only needs to be set up once
 	edge_head.u = r_refdef.vrect.x << 20;
@@ -705,21 +778,12 @@ void R_ScanEdges (void)
 			VID_UnlockBuffer ();
 			S_ExtraUpdate ();	// don't let sound get messed up if going slow
 			VID_LockBuffer ();
-		
-			if (r_drawculledpolys)
-			{
-				R_DrawCulledPolys ();
-			}
-			else
-			{
-				D_DrawSurfaces ();
-			}
-
-		// clear the surface span pointers
-			for (s = &surfaces[1] ; s<surface_p ; s++)
-				s->spans = NULL;
 
-			span_p = basespan_p;
+			R_FlushSpans (r_tiling && iv + 1 - r_bandstart == R_TILEROWS);
+		}
+		else if (r_tiling && iv + 1 - r_bandstart == R_TILEROWS)
+		{
+			R_FlushSpans (true);
 		}
 
 		if (removeedges[iv])
@@ -743,10 +807,7 @@ void R_ScanEdges (void)
 	(*pdrawfunc) ();
 
 // draw whatever's left in the span list
-	if (r_drawculledpolys)
-		R_DrawCulledPolys ();
-	else
-		D_DrawSurfaces ();
+	R_FlushSpans (true);
 }
 
 
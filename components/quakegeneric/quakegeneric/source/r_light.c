@@ -138,23 +138,30 @@ LIGHT SAMPLING
 =============================================================================
 */
 
-int RecursiveLightPoint (mnode_t *node, vec3_t start, vec3_t end)
+/*
+=============
+R_FindLightSample
+
+Traces from start to end and returns the first lightmapped surface hit,
+with *psample set to its lightmap texel (NULL if the surface is unlit).
+The texel only depends on the two points, so callers that never move can
+keep it and reweight it by the current light styles each frame.
+=============
+*/
+msurface_t *R_FindLightSample (mnode_t *node, vec3_t start, vec3_t end,
+	byte **psample)
 {
-	int			r;
 	float		front, back, frac;
 	int			side;
 	mplane_t	*plane;
 	vec3_t		mid;
-	msurface_t	*surf;
+	msurface_t	*surf, *hit;
 	int			s, t, ds, dt;
 	int			i;
 	mtexinfo_t	*tex;
-	byte		*lightmap;
-	unsigned	scale;
-	int			maps;
 
 	if (node->contents < 0)
-		return -1;		// didn't hit anything
+		return NULL;		// didn't hit anything
 	
 // calculate mid point
 
@@ -165,7 +172,7 @@ int RecursiveLightPoint (mnode_t *node, vec3_t start, vec3_t end)
 	side = front < 0;
 	
 	if ( (back < 0) == side)
-		return RecursiveLightPoint (node->children[side], start, end);
+		return R_FindLightSample (node->children[side], start, end, psample);
 	
 	frac = front / (front-back);
 	mid[0] = start[0] + (end[0] - start[0])*frac;
@@ -173,12 +180,12 @@ int RecursiveLightPoint (mnode_t *node, vec3_t start, vec3_t end)
 	mid[2] = start[2] + (end[2] - start[2])*frac;
 	
 // go down front side	
-	r = RecursiveLightPoint (node->children[side], start, mid);
-	if (r >= 0)
-		return r;		// hit something
+	hit = R_FindLightSample (node->children[side], start, mid, psample);
+	if (hit)
+		return hit;		// hit something
 		
 	if ( (back < 0) == side )
-		return -1;		// didn't hit anuthing
+		return NULL;		// didn't hit anuthing
 		
 // check for impact on this node
 
@@ -203,36 +210,60 @@ int RecursiveLightPoint (mnode_t *node, vec3_t start, vec3_t end)
 		if ( ds > surf->extents[0] || dt > surf->extents[1] )
 			continue;
 
-		if (!surf->samples)
-			return 0;
-
-		ds >>= 4;
-		dt >>= 4;
-
-		lightmap = surf->samples;
-		r = 0;
-		if (lightmap)
+		*psample = NULL;
+		if (surf->samples)
 		{
-
-			lightmap += dt * ((surf->extents[0]>>4)+1) + ds;
-
-			for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
-					maps++)
-			{
-				scale = d_lightstylevalue[surf->styles[maps]];
-				r += *lightmap * scale;
-				lightmap += ((surf->extents[0]>>4)+1) *
-						((surf->extents[1]>>4)+1);
-			}
-			
-			r >>= 8;
+			ds >>= 4;
+			dt >>= 4;
+			*psample = surf->samples + dt * ((surf->extents[0]>>4)+1) + ds;
 		}
 		
-		return r;
+		return surf;
 	}
 
 // go down back side
-	return RecursiveLightPoint (node->children[!side], mid, end);
+	return R_FindLightSample (node->children[!side], mid, end, psample);
+}
+
+/*
+=============
+R_SampleLight
+
+Weights a lightmap texel found by R_FindLightSample by the current styles
+=============
+*/
+int R_SampleLight (msurface_t *surf, byte *lightmap)
+{
+	int			r;
+	int			maps;
+	unsigned	scale;
+
+	if (!lightmap)
+		return 0;
+
+	r = 0;
+	for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
+			maps++)
+	{
+		scale = d_lightstylevalue[surf->styles[maps]];
+		r += *lightmap * scale;
+		lightmap += ((surf->extents[0]>>4)+1) *
+				((surf->extents[1]>>4)+1);
+	}
+	
+	return r >> 8;
+}
+
+int RecursiveLightPoint (mnode_t *node, vec3_t start, vec3_t end)
+{
+	msurface_t	*surf;
+	byte		*lightmap;
+
+	surf = R_FindLightSample (node, start, end, &lightmap);
+	if (!surf)
+		return -1;		// didn't hit anything
+
+	return R_SampleLight (surf, lightmap);
 }
 
 int R_LightPoint (vec3_t p)
@@ -258,3 +289,40 @@ int R_LightPoint (vec3_t p)
 	return r;
 }
 
+/*
+=============
+R_StaticLightPoint
+
+R_LightPoint for an entity that never moves: the trace down to the floor
+is done once and only the light style weighting is redone each frame
+=============
+*/
+int R_StaticLightPoint (entity_t *ent)
+{
+	vec3_t		end;
+	int			r;
+	
+	if (!cl.worldmodel->lightdata)
+		return 255;
+
+	if (!ent->lightcached)
+	{
+		end[0] = ent->origin[0];
+		end[1] = ent->origin[1];
+		end[2] = ent->origin[2] - 2048;
+
+		ent->lightsurf = R_FindLightSample (cl.worldmodel->nodes,
+				ent->origin, end, &ent->lightsample);
+		ent->lightcached = true;
+	}
+
+	r = 0;
+	if (ent->lightsurf)
+		r = R_SampleLight (ent->lightsurf, ent->lightsample);
+
+	if (r < r_refdef.ambientlight)
+		r = r_refdef.ambientlight;
+
+	return r;
+}
+
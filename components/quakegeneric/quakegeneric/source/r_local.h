@@ -70,6 +70,9 @@ extern cvar_t	r_numsurfs;
 extern cvar_t	r_reportedgeout;
 extern cvar_t	r_maxedges;
 extern cvar_t	r_numedges;
+extern cvar_t	r_tiled;
+extern cvar_t	r_staticcache;
+extern cvar_t	r_skincache;
 
 #define XCENTERING	(1.0 / 2.0)
 #define YCENTERING	(1.0 / 2.0)
@@ -244,9 +247,22 @@ void R_ReadPointFile_f (void);
 void R_SurfacePatch (void);
 
 extern int		r_amodels_drawn;
+extern int		r_aposecached;
+extern int		r_liveparticles;
+
+// static entities are never relinked, so their lighting and poses are cached
+#define R_IsStaticEntity(e)	((e) >= cl_static_entities && \
+							 (e) < cl_static_entities + cl.num_statics)
 extern edge_t	*auxedges;
 extern int		r_numallocatededges;
 extern edge_t	*r_edges, *edge_p, *edge_max;
+extern byte		*r_basespans;
+
+#define	R_TILEROWS	16		// lines per band in r_tiled mode
+
+extern byte		*r_tilecolor;
+extern short	*r_tilez;
+extern int		r_tilewidth;
 
 extern	edge_t	*newedges[MAXHEIGHT];
 extern	edge_t	*removeedges[MAXHEIGHT];
@@ -290,12 +306,19 @@ extern qboolean	r_fov_greater_than_90;
 
 void R_StoreEfrags (efrag_t **ppefrag);
 void R_TimeRefresh_f (void);
+void R_CamPath_f (void);
+void R_SurfBench_f (void);
+void R_SpanBench_f (void);
+void R_ViewStats_f (void);
+void R_RecordPathFrame (void);
+extern qboolean	r_pathrecording;
 void R_TimeGraph (void);
 void R_PrintAliasStats (void);
 void R_PrintTimes (void);
 void R_PrintDSpeeds (void);
 void R_AnimateLight (void);
 int R_LightPoint (vec3_t p);
+int R_StaticLightPoint (entity_t *ent);
 void R_SetupFrame (void);
 void R_cshift_f (void);
 void R_EmitEdge (mvertex_t *pv0, mvertex_t *pv1);
@@ -45,9 +45,12 @@ mvertex_t	*r_pcurrentvertbase;
 
 int			c_surf;
 int			r_maxsurfsseen, r_maxedgesseen, r_cnumsurfs;
-qboolean	r_surfsonstack;
+qboolean	r_surfsonstack;		// using the r_surfpool default rather than the hunk
 int			r_clipflags;
 
+static edge_t	*r_edgepool;	// NUMSTACKEDGES, unless r_maxedges wants more
+static surf_t	*r_surfpool;	// NUMSTACKSURFACES
+
 byte		*r_warpbuffer;
 
 byte		*r_stack_start;
@@ -135,6 +138,10 @@ cvar_t	r_maxedges = {"r_maxedges", "0"};
 cvar_t	r_numedges = {"r_numedges", "0"};
 cvar_t	r_aliastransbase = {"r_aliastransbase", "200"};
 cvar_t	r_aliastransadj = {"r_aliastransadj", "100"};
+cvar_t	r_tiled = {"r_tiled", "0"};
+cvar_t	r_staticcache = {"r_staticcache", "1"};
+cvar_t	r_skincache = {"r_skincache", "1"};
+cvar_t	r_reuseview = {"r_reuseview", "1"};
 
 extern cvar_t	scr_fov;
 
@@ -190,6 +197,10 @@ void R_Init (void)
 	
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);	
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);	
+	Cmd_AddCommand ("campath", R_CamPath_f);
+	Cmd_AddCommand ("surfbench", R_SurfBench_f);
+	Cmd_AddCommand ("spanbench", R_SpanBench_f);
+	Cmd_AddCommand ("viewstats", R_ViewStats_f);
 
 	Cvar_RegisterVariable (&r_draworder);
 	Cvar_RegisterVariable (&r_speeds);
@@ -212,6 +223,10 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_numedges);
 	Cvar_RegisterVariable (&r_aliastransbase);
 	Cvar_RegisterVariable (&r_aliastransadj);
+	Cvar_RegisterVariable (&r_tiled);
+	Cvar_RegisterVariable (&r_staticcache);
+	Cvar_RegisterVariable (&r_skincache);
+	Cvar_RegisterVariable (&r_reuseview);
 
 	Cvar_SetValue ("r_maxedges", (float)NUMSTACKEDGES);
 	Cvar_SetValue ("r_maxsurfs", (float)NUMSTACKSURFACES);
@@ -228,6 +243,28 @@ void R_Init (void)
 
 	R_InitParticles ();
 
+// the edge, surface and span lists are touched for every pixel row, so
+// they go in fast memory if there is any
+	r_edgepool = Tier_Alloc ((NUMSTACKEDGES + ((CACHE_SIZE - 1) / sizeof(edge_t)) + 1)
+		* sizeof(edge_t), mem_fast, "edges");
+	r_surfpool = Tier_Alloc ((NUMSTACKSURFACES + ((CACHE_SIZE - 1) / sizeof(surf_t)) + 1)
+		* sizeof(surf_t), mem_fast, "surfaces");
+	r_basespans = Tier_Alloc (MAXSPANS*sizeof(espan_t)+CACHE_SIZE, mem_fast, "spans");
+
+// the band buffers are only worth having on chip
+	r_tilewidth = vid.rowbytes > vid.width ? vid.rowbytes : vid.width;
+	if (r_tilewidth < WARP_WIDTH)
+		r_tilewidth = WARP_WIDTH;
+	r_tilecolor = Tier_Alloc (r_tilewidth*R_TILEROWS, mem_fast, "tile color");
+	r_tilez = Tier_Alloc (r_tilewidth*R_TILEROWS*sizeof(short), mem_fast, "tile z");
+	if (!Tier_IsFast (r_tilecolor) || !Tier_IsFast (r_tilez))
+	{
+		Tier_Free (r_tilecolor);
+		Tier_Free (r_tilez);
+		r_tilecolor = NULL;
+		r_tilez = NULL;
+	}
+
 	D_Init ();
 }
 
@@ -535,7 +572,10 @@ void R_DrawEntitiesOnList (void)
 		// trivial accept status
 			if (R_AliasCheckBBox ())
 			{
-				j = R_LightPoint (currententity->origin);
+				if (r_staticcache.value && R_IsStaticEntity (currententity))
+					j = R_StaticLightPoint (currententity);
+				else
+					j = R_LightPoint (currententity->origin);
 	
 				lighting.ambientlight = j;
 				lighting.shadelight = j;
@@ -846,11 +886,6 @@ R_EdgeDrawing
 */
 void R_EdgeDrawing (void)
 {
-	edge_t	ledges[NUMSTACKEDGES +
-				((CACHE_SIZE - 1) / sizeof(edge_t)) + 1];
-	surf_t	lsurfs[NUMSTACKSURFACES +
-				((CACHE_SIZE - 1) / sizeof(surf_t)) + 1];
-
 	if (auxedges)
 	{
 		r_edges = auxedges;
@@ -858,13 +893,13 @@ void R_EdgeDrawing (void)
 	else
 	{
 		r_edges =  (edge_t *)
-				(((intptr_t)&ledges[0] + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
+				(((intptr_t)r_edgepool + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
 	}
 
 	if (r_surfsonstack)
 	{
 		surfaces =  (surf_t *)
-				(((intptr_t)&lsurfs[0] + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
+				(((intptr_t)r_surfpool + CACHE_SIZE - 1) & ~(CACHE_SIZE - 1));
 		surf_max = &surfaces[r_cnumsurfs];
 	// surface 0 doesn't really exist; it's just a dummy because index 0
 	// is used to indicate no edge attached to surface
@@ -1041,10 +1076,231 @@ void R_RenderView (void)
 	if ( (intptr_t)(&r_warpbuffer) & 3 )
 		Sys_Error ("Globals are missaligned");
 
+	if (r_pathrecording)
+		R_RecordPathFrame ();
+
 	R_RenderView_ (my_warpbuffer);
 	in_renderview=0;
 }
 
+/*
+=============================================================================
+
+VIEW REUSE
+
+When paused, in a menu or at the console the 3D view usually comes out the
+same frame after frame.  Everything it depends on is gathered into a key
+each frame; once two frames in a row have the same key, the second is also
+copied aside, and from then on the copy is put back instead of rendering for
+as long as the key holds.  The 2D layers are drawn over it as usual.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	struct model_s	*model;
+	byte			*colormap;
+	int				frame, skinnum, effects;
+	vec3_t			origin, angles;
+} entkey_t;
+
+#define	MAX_KEYCVARS	256
+
+typedef struct
+{
+	int			vrect[4];
+	vec3_t		vieworg, viewangles;
+	float		fov_x, fov_y;
+	double		time;
+	int			cvarchanges;
+	float		cvars[MAX_KEYCVARS];	// some code sets values directly
+	int			translations;
+	int			liveparticles;
+	char		styles[MAX_LIGHTSTYLES];
+	float		dlights[MAX_DLIGHTS][4];
+	int			numents;
+	entkey_t	ents[MAX_VISEDICTS+1];	// only numents are filled in
+} viewkey_t;
+
+static byte		*r_viewsave;
+static viewkey_t	*r_viewkeys;		// this frame, last frame, saved view
+static int		r_viewkeysize[3];
+static qboolean	r_viewsaved;
+static int		r_viewsreused, r_viewsdrawn;
+
+static void R_EntityKey (entkey_t *key, entity_t *ent)
+{
+	key->model = ent->model;
+	key->colormap = ent->colormap;
+	key->frame = ent->frame;
+	key->skinnum = ent->skinnum;
+	key->effects = ent->effects;
+	VectorCopy (ent->origin, key->origin);
+	VectorCopy (ent->angles, key->angles);
+}
+
+/*
+================
+R_BuildViewKey
+
+Everything the 3D view depends on: the view, the client time that drives
+all animation, what the entities, lights and particles are doing, the
+player colors, and every cvar's value.  Returns how many bytes of key are
+in use, which are cleared first so padding compares equal, or 0 if there
+are too many cvars to hold.
+================
+*/
+static int R_BuildViewKey (viewkey_t *key)
+{
+	int			i, k, size;
+	dlight_t	*dl;
+	cvar_t		*var;
+
+	size = (byte *)&key->ents[cl_numvisedicts+1] - (byte *)key;
+	memset (key, 0, size);
+
+	key->vrect[0] = r_refdef.vrect.x;
+	key->vrect[1] = r_refdef.vrect.y;
+	key->vrect[2] = r_refdef.vrect.width;
+	key->vrect[3] = r_refdef.vrect.height;
+	VectorCopy (r_refdef.vieworg, key->vieworg);
+	VectorCopy (r_refdef.viewangles, key->viewangles);
+	key->fov_x = r_refdef.fov_x;
+	key->fov_y = r_refdef.fov_y;
+	key->time = cl.time;
+	key->cvarchanges = cvar_changes;
+	for (i=0, var=cvar_vars ; var ; i++, var=var->next)
+	{
+		if (i == MAX_KEYCVARS)
+			return 0;
+		key->cvars[i] = var->value;
+	}
+	key->translations = cl_translationchanges;
+	key->liveparticles = r_liveparticles;
+
+// the style values R_AnimateLight is going to pick
+	k = (int)(cl.time*10);
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+	{
+		if (cl_lightstyle[i].length)
+			key->styles[i] = cl_lightstyle[i].map[k % cl_lightstyle[i].length];
+	}
+
+	for (i=0, k=0, dl=cl_dlights ; i<MAX_DLIGHTS ; i++, dl++)
+	{
+		if (dl->die < cl.time || !dl->radius)
+			continue;
+		VectorCopy (dl->origin, key->dlights[k]);
+		key->dlights[k][3] = dl->radius;
+		k++;
+	}
+
+	key->numents = cl_numvisedicts;
+	for (i=0 ; i<cl_numvisedicts ; i++)
+		R_EntityKey (&key->ents[i], cl_visedicts[i]);
+	R_EntityKey (&key->ents[i], &cl.viewent);
+
+	return size;
+}
+
+static qboolean R_SameViewKey (int a, int b)
+{
+	return r_viewkeysize[a] == r_viewkeysize[b] &&
+			!memcmp (&r_viewkeys[a], &r_viewkeys[b], r_viewkeysize[a]);
+}
+
+static void R_CopyViewKey (int to, int from)
+{
+	memcpy (&r_viewkeys[to], &r_viewkeys[from], r_viewkeysize[from]);
+	r_viewkeysize[to] = r_viewkeysize[from];
+}
+
+static void R_CopyView (byte *dest, int destrowbytes, byte *src,
+	int srcrowbytes)
+{
+	int		i;
+
+	for (i=0 ; i<r_refdef.vrect.height ; i++)
+	{
+		memcpy (dest, src, r_refdef.vrect.width);
+		dest += destrowbytes;
+		src += srcrowbytes;
+	}
+}
+
+/*
+================
+R_ReuseView
+
+Returns true if the saved view was put back into the frame buffer, in which
+case R_RenderView and R_KeepView are skipped for this frame
+================
+*/
+qboolean R_ReuseView (void)
+{
+// the timing displays have to see every frame rendered
+	if (!r_reuseview.value || r_timegraph.value || r_speeds.value ||
+		r_dspeeds.value)
+	{
+		r_viewsaved = false;
+		r_viewkeysize[1] = 0;
+		return false;
+	}
+
+	if (!r_viewkeys)
+		r_viewkeys = Tier_Alloc (3 * sizeof(viewkey_t), mem_bulk, "viewkeys");
+
+	r_viewkeysize[0] = R_BuildViewKey (&r_viewkeys[0]);
+	if (!r_viewkeysize[0] || !r_viewsaved || !R_SameViewKey (0, 2))
+		return false;
+
+	R_CopyView (vid.buffer + r_refdef.vrect.y * vid.rowbytes +
+			r_refdef.vrect.x, vid.rowbytes, r_viewsave, r_refdef.vrect.width);
+	r_viewsreused++;
+	return true;
+}
+
+/*
+================
+R_KeepView
+
+Saves the view that was just drawn if it matched the one before it, since
+then it is likely to be wanted again
+================
+*/
+void R_KeepView (void)
+{
+	r_viewsdrawn++;
+
+	if (!r_viewkeys || !r_viewkeysize[0])
+		return;		// R_ReuseView didn't build a key
+
+	if (R_SameViewKey (0, 1))
+	{
+		if (!r_viewsave)
+			r_viewsave = Tier_Alloc (vid.width * vid.height, mem_bulk,
+					"viewsave");
+		R_CopyView (r_viewsave, r_refdef.vrect.width, vid.buffer +
+				r_refdef.vrect.y * vid.rowbytes + r_refdef.vrect.x,
+				vid.rowbytes);
+		R_CopyViewKey (2, 0);
+		r_viewsaved = true;
+	}
+	R_CopyViewKey (1, 0);
+	r_viewkeysize[0] = 0;
+}
+
+/*
+================
+R_ViewStats_f
+================
+*/
+void R_ViewStats_f (void)
+{
+	Con_Printf ("%i views drawn, %i reused\n", r_viewsdrawn, r_viewsreused);
+}
+
 /*
 ================
 R_InitTurb
@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "r_local.h"
+#include "d_local.h"
+#include "esp_attr.h"
 
 
 /*
@@ -101,6 +103,287 @@ void R_TimeRefresh_f (void)
 }
 
 
+/*
+===============================================================================
+
+CAMERA PATHS
+
+"campath record" stores the view of every rendered frame until "campath
+stop", so that benchmarks can replay the same walk through a level.
+
+===============================================================================
+*/
+
+#define	MAX_PATHFRAMES	1024
+
+typedef struct
+{
+	vec3_t	origin;
+	vec3_t	angles;
+} pathframe_t;
+
+EXT_RAM_BSS_ATTR static pathframe_t	r_path[MAX_PATHFRAMES];
+static int		r_pathframes;
+qboolean		r_pathrecording;
+
+/*
+====================
+R_RecordPathFrame
+====================
+*/
+void R_RecordPathFrame (void)
+{
+	if (r_pathframes == MAX_PATHFRAMES)
+	{
+		r_pathrecording = false;
+		return;
+	}
+	VectorCopy (r_refdef.vieworg, r_path[r_pathframes].origin);
+	VectorCopy (r_refdef.viewangles, r_path[r_pathframes].angles);
+	r_pathframes++;
+}
+
+/*
+====================
+R_CamPath_f
+
+campath [record | stop | clear]
+====================
+*/
+void R_CamPath_f (void)
+{
+	if (Cmd_Argc () > 1)
+	{
+		if (!Q_strcmp (Cmd_Argv (1), "record"))
+		{
+			r_pathframes = 0;
+			r_pathrecording = true;
+		}
+		else if (!Q_strcmp (Cmd_Argv (1), "stop"))
+			r_pathrecording = false;
+		else if (!Q_strcmp (Cmd_Argv (1), "clear"))
+			r_pathframes = 0;
+	}
+	Con_Printf ("%i frames in the camera path%s\n", r_pathframes,
+		r_pathrecording ? ", recording" : "");
+}
+
+/*
+====================
+R_RenderPath
+
+Renders the recorded path, or a spin in place like timerefresh if there is
+none
+====================
+*/
+static void R_SetPathView (int frame)
+{
+	if (r_pathframes)
+	{
+		VectorCopy (r_path[frame].origin, r_refdef.vieworg);
+		VectorCopy (r_path[frame].angles, r_refdef.viewangles);
+	}
+	else
+		r_refdef.viewangles[1] = frame/128.0*360.0;
+}
+
+static void R_UpdatePathView (void)
+{
+	vrect_t		vr;
+
+	vr.x = r_refdef.vrect.x;
+	vr.y = r_refdef.vrect.y;
+	vr.width = r_refdef.vrect.width;
+	vr.height = r_refdef.vrect.height;
+	vr.pnext = NULL;
+	VID_Update (&vr);
+}
+
+static int R_RenderPath (void)
+{
+	int			i, frames;
+
+	frames = r_pathframes ? r_pathframes : 128;
+	for (i=0 ; i<frames ; i++)
+	{
+		R_SetPathView (i);
+
+		VID_LockBuffer ();
+		R_RenderView ();
+		VID_UnlockBuffer ();
+
+		R_UpdatePathView ();
+	}
+	return frames;
+}
+
+/*
+====================
+R_SurfBench_f
+
+Compares the row-major and tiled surface cache layouts over the camera
+path: time per frame, and how often texel fetches miss a 16k direct mapped
+cache model
+====================
+*/
+void R_SurfBench_f (void)
+{
+	vec3_t		origin, angles;
+	float		tiled, start, time;
+	int			layout, frames;
+
+	if (r_pathrecording)
+	{
+		Con_Printf ("still recording a camera path\n");
+		return;
+	}
+
+	VectorCopy (r_refdef.vieworg, origin);
+	VectorCopy (r_refdef.viewangles, angles);
+	tiled = d_tiledsurfs.value;
+
+	for (layout=0 ; layout<2 ; layout++)
+	{
+		Cvar_SetValue ("d_tiledsurfs", layout);
+
+		R_RenderPath ();		// build the surface cache in this layout
+		start = Sys_FloatTime ();
+		frames = R_RenderPath ();
+		time = Sys_FloatTime () - start;
+
+		d_spansim = true;
+		D_ResetSim ();
+		R_RenderPath ();
+		d_spansim = false;
+
+		Con_Printf ("%s: %i frames, %.2f ms/frame, %i texels, %.1f%% cache misses\n",
+			layout ? "tiled " : "linear", frames, time*1000/frames, d_simfetches,
+			d_simfetches ? 100.0*d_simmisses/d_simfetches : 0.0);
+	}
+
+	Cvar_SetValue ("d_tiledsurfs", tiled);
+	VectorCopy (origin, r_refdef.vieworg);
+	VectorCopy (angles, r_refdef.viewangles);
+}
+
+/*
+====================
+R_PathError
+
+Renders every frame of the camera path twice, with the reference drawers
+that divide at every pixel and then with the current d_subdiv setting, and
+returns the percentage of view pixels that came out different
+====================
+*/
+static float R_PathError (byte *ref)
+{
+	int			i, x, y, frames, width, height, diffs;
+	byte		*src, *dest;
+
+	frames = r_pathframes ? r_pathframes : 128;
+	diffs = 0;
+	width = r_refdef.vrect.width;
+	height = r_refdef.vrect.height;
+
+	for (i=0 ; i<frames ; i++)
+	{
+		R_SetPathView (i);
+
+		VID_LockBuffer ();
+		d_spanref = true;
+		R_RenderView ();
+		d_spanref = false;
+
+		src = vid.buffer + r_refdef.vrect.y*vid.rowbytes + r_refdef.vrect.x;
+		for (y=0 ; y<height ; y++, src += vid.rowbytes)
+			memcpy (ref + y*width, src, width);
+
+		R_RenderView ();
+
+		src = vid.buffer + r_refdef.vrect.y*vid.rowbytes + r_refdef.vrect.x;
+		for (y=0 ; y<height ; y++, src += vid.rowbytes)
+		{
+			dest = ref + y*width;
+			for (x=0 ; x<width ; x++)
+				if (src[x] != dest[x])
+					diffs++;
+		}
+		VID_UnlockBuffer ();
+
+		R_UpdatePathView ();
+	}
+
+	return 100.0 * diffs / ((float)frames * width * height);
+}
+
+/*
+====================
+R_SpanBench_f
+
+Runs the camera path at each span subdivision and with the adaptive
+choice: time per frame, pixels that differ from per pixel perspective
+division, and how the adaptive setting split the surfaces
+====================
+*/
+void R_SpanBench_f (void)
+{
+	static int	modes[4] = {8, 16, 32, 0};
+	vec3_t		origin, angles;
+	float		subdiv, start, time, error;
+	int			i, frames, total;
+	byte		*ref;
+
+	if (r_pathrecording)
+	{
+		Con_Printf ("still recording a camera path\n");
+		return;
+	}
+
+	ref = Tier_TryAlloc (r_refdef.vrect.width * r_refdef.vrect.height, mem_bulk,
+		"spanbench");
+	if (!ref)
+	{
+		Con_Printf ("no memory for the reference frame\n");
+		return;
+	}
+
+	VectorCopy (r_refdef.vieworg, origin);
+	VectorCopy (r_refdef.viewangles, angles);
+	subdiv = d_subdiv.value;
+
+	R_RenderPath ();		// warm the surface cache
+
+	for (i=0 ; i<4 ; i++)
+	{
+		Cvar_SetValue ("d_subdiv", modes[i]);
+
+		d_subdivcount[0] = d_subdivcount[1] = d_subdivcount[2] = 0;
+		start = Sys_FloatTime ();
+		frames = R_RenderPath ();
+		time = Sys_FloatTime () - start;
+		total = d_subdivcount[0] + d_subdivcount[1] + d_subdivcount[2];
+		if (!total)
+			total = 1;
+
+		error = R_PathError (ref);
+
+		if (modes[i])
+			Con_Printf ("subdiv %2i: %.2f ms/frame, %.2f%% pixels off\n",
+				modes[i], time*1000/frames, error);
+		else
+			Con_Printf ("adaptive : %.2f ms/frame, %.2f%% pixels off, "
+				"8/16/32 %i/%i/%i%%\n", time*1000/frames, error,
+				100*d_subdivcount[0]/total, 100*d_subdivcount[1]/total,
+				100*d_subdivcount[2]/total);
+	}
+
+	Tier_Free (ref);
+	Cvar_SetValue ("d_subdiv", subdiv);
+	VectorCopy (origin, r_refdef.vieworg);
+	VectorCopy (angles, r_refdef.viewangles);
+}
+
+
 /*
 ================
 R_LineGraph
@@ -200,8 +483,9 @@ void R_PrintTimes (void)
 
 	ms = 1000* (r_time2 - r_time1);
 	
-	Con_Printf ("%5.1f ms %3i/%3i/%3i poly %3i surf\n",
-				ms, c_faceclip, r_polycount, r_drawnpolycount, c_surf);
+	Con_Printf ("%5.1f ms %3i/%3i/%3i poly %3i surf %3i/%5i hidden\n",
+				ms, c_faceclip, r_polycount, r_drawnpolycount, c_surf,
+				d_hizmodels, d_hizpixels);
 	c_surf = 0;
 }
 
@@ -238,7 +522,8 @@ R_PrintAliasStats
 */
 void R_PrintAliasStats (void)
 {
-	Con_Printf ("%3i polygon model drawn\n", r_amodels_drawn);
+	Con_Printf ("%3i polygon model drawn, %3i from pose cache\n",
+			r_amodels_drawn, r_aposecached);
 }
 
 
@@ -509,8 +794,11 @@ r_refdef.viewangles[2]=    0;
 	r_drawnpolycount = 0;
 	r_wholepolycount = 0;
 	r_amodels_drawn = 0;
+	r_aposecached = 0;
 	r_outofsurfaces = 0;
 	r_outofedges = 0;
+	d_hizmodels = 0;
+	d_hizpixels = 0;
 
 	D_SetupFrame ();
 }
@@ -30,10 +30,28 @@ int		ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int		ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int		ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-particle_t	*active_particles, *free_particles;
+/*
+Particles live in one stream per type, each a structure of arrays, so the
+per frame update is a branch free loop per type and the driver gets the
+coordinates packed together.  A stream's arrays share one allocation that
+doubles whenever it fills, up to r_numparticles live particles in all.
+*/
+#define PARTICLE_STREAM_MIN		64
 
-particle_t	*particles;
-int			r_numparticles;
+typedef struct
+{
+	int		count, maxcount;
+	float	*org[3];
+	float	*vel[3];
+	float	*ramp;
+	float	*die;
+	byte	*color;
+	void	*block;
+} pstream_t;
+
+static pstream_t	r_pstreams[NUM_PARTICLETYPES];
+int					r_liveparticles;
+int					r_numparticles;
 
 vec3_t			r_pright, r_pup, r_ppn;
 
@@ -59,9 +77,95 @@ void R_InitParticles (void)
 	{
 		r_numparticles = MAX_PARTICLES;
 	}
+}
+
+/*
+===============
+R_GrowStream
+===============
+*/
+static qboolean R_GrowStream (pstream_t *ps)
+{
+	int		i, maxcount;
+	float	*f;
+	pstream_t	old;
+
+	maxcount = ps->maxcount ? ps->maxcount*2 : PARTICLE_STREAM_MIN;
+	if (maxcount > r_numparticles)
+		maxcount = r_numparticles;
+	if (maxcount <= ps->maxcount)
+		return false;
+
+	old = *ps;
+	ps->block = Tier_TryAlloc (maxcount * (8*sizeof(float) + 1), mem_bulk,
+		"particles");
+	if (!ps->block)
+	{	// out of memory: keep the stream as it is and drop the new particle
+		*ps = old;
+		return false;
+	}
+	ps->maxcount = maxcount;
+
+	f = ps->block;
+	for (i=0 ; i<3 ; i++)
+	{
+		ps->org[i] = f + i*maxcount;
+		ps->vel[i] = f + (3+i)*maxcount;
+	}
+	ps->ramp = f + 6*maxcount;
+	ps->die = f + 7*maxcount;
+	ps->color = (byte *)(f + 8*maxcount);
+
+	if (old.block)
+	{
+		for (i=0 ; i<3 ; i++)
+		{
+			memcpy (ps->org[i], old.org[i], ps->count*sizeof(float));
+			memcpy (ps->vel[i], old.vel[i], ps->count*sizeof(float));
+		}
+		memcpy (ps->ramp, old.ramp, ps->count*sizeof(float));
+		memcpy (ps->die, old.die, ps->count*sizeof(float));
+		memcpy (ps->color, old.color, ps->count);
+		Tier_Free (old.block);
+	}
+
+	return true;
+}
 
-	particles = (particle_t *)
-			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+/*
+===============
+R_SpawnParticle
+
+Returns false when the particle limit is reached
+===============
+*/
+static qboolean R_SpawnParticle (ptype_t type, vec3_t org, vec3_t vel,
+	int color, float ramp, float die)
+{
+	pstream_t	*ps;
+	int			n;
+
+	if (r_liveparticles >= r_numparticles)
+		return false;
+
+	ps = &r_pstreams[type];
+	if (ps->count == ps->maxcount && !R_GrowStream (ps))
+		return false;
+
+	n = ps->count++;
+	r_liveparticles++;
+
+	ps->org[0][n] = org[0];
+	ps->org[1][n] = org[1];
+	ps->org[2][n] = org[2];
+	ps->vel[0][n] = vel[0];
+	ps->vel[1][n] = vel[1];
+	ps->vel[2][n] = vel[2];
+	ps->ramp[n] = ramp;
+	ps->die[n] = die;
+	ps->color[n] = color;
+
+	return true;
 }
 
 /*
@@ -82,10 +186,9 @@ void R_EntityParticles (entity_t *ent)
 {
 	int			count;
 	int			i;
-	particle_t	*p;
 	float		angle;
 	float		sr, sp, sy, cr, cp, cy;
-	vec3_t		forward;
+	vec3_t		forward, org;
 	float		dist;
 	
 	dist = 64;
@@ -114,20 +217,12 @@ avelocities[0][i] = (rand()&255) * 0.01;
 		forward[1] = cp*sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;			
+		org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;			
+		org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;			
+
+		if (!R_SpawnParticle (pt_explode, org, vec3_origin, 0x6f, 0, cl.time + 0.01))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
-		
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;			
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;			
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;			
 	}
 }
 
@@ -140,13 +235,15 @@ R_ClearParticles
 void R_ClearParticles (void)
 {
 	int		i;
-	
-	free_particles = &particles[0];
-	active_particles = NULL;
 
-	for (i=0 ;i<r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+// streams start small again on each level
+	for (i=0 ; i<NUM_PARTICLETYPES ; i++)
+	{
+		if (r_pstreams[i].block)
+			Tier_Free (r_pstreams[i].block);
+		memset (&r_pstreams[i], 0, sizeof(r_pstreams[i]));
+	}
+	r_liveparticles = 0;
 }
 
 
@@ -156,7 +253,6 @@ void R_ReadPointFile_f (void)
 	vec3_t	org;
 	int		r;
 	int		c;
-	particle_t	*p;
 	char	name[MAX_OSPATH];
 	
 	sprintf (name,"maps/%s.pts", sv.name);
@@ -177,21 +273,11 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 		
-		if (!free_particles)
+		if (!R_SpawnParticle (pt_static, org, vec3_origin, (-c)&15, 0, 99999))
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-		
-		p->die = 99999;
-		p->color = (-c)&15;
-		p->type = pt_static;
-		VectorCopy (vec3_origin, p->vel);
-		VectorCopy (org, p->org);
 	}
 
 	fclose (f);
@@ -234,38 +320,21 @@ R_ParticleExplosion
 void R_ParticleExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	vec3_t		porg, vel;
+	float		ramp;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = rand()&3;
-		if (i & 1)
-		{
-			p->type = pt_explode;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
-		}
-		else
+		ramp = rand()&3;
+		for (j=0 ; j<3 ; j++)
 		{
-			p->type = pt_explode2;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			porg[j] = org[j] + ((rand()%32)-16);
+			vel[j] = (rand()%512)-256;
 		}
+
+		if (!R_SpawnParticle ((i & 1) ? pt_explode : pt_explode2, porg, vel,
+			ramp1[0], ramp, cl.time + 5))
+			return;
 	}
 }
 
@@ -278,28 +347,21 @@ R_ParticleExplosion2
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
 	int			i, j;
-	particle_t	*p;
+	vec3_t		porg, vel;
 	int			colorMod = 0;
 
 	for (i=0; i<512; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
-		colorMod++;
-
-		p->type = pt_blob;
 		for (j=0 ; j<3 ; j++)
 		{
-			p->org[j] = org[j] + ((rand()%32)-16);
-			p->vel[j] = (rand()%512)-256;
+			porg[j] = org[j] + ((rand()%32)-16);
+			vel[j] = (rand()%512)-256;
 		}
+
+		if (!R_SpawnParticle (pt_blob, porg, vel,
+			colorStart + (colorMod % colorLength), 0, cl.time + 0.3))
+			return;
+		colorMod++;
 	}
 }
 
@@ -312,39 +374,28 @@ R_BlobExplosion
 void R_BlobExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	vec3_t		porg, vel;
+	float		die;
+	int			color;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 1 + (rand()&8)*0.05;
+		die = cl.time + 1 + (rand()&8)*0.05;
 
 		if (i & 1)
-		{
-			p->type = pt_blob;
-			p->color = 66 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
-		}
+			color = 66 + rand()%6;
 		else
+			color = 150 + rand()%6;
+
+		for (j=0 ; j<3 ; j++)
 		{
-			p->type = pt_blob2;
-			p->color = 150 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			porg[j] = org[j] + ((rand()%32)-16);
+			vel[j] = (rand()%512)-256;
 		}
+
+		if (!R_SpawnParticle ((i & 1) ? pt_blob : pt_blob2, porg, vel, color,
+			0, die))
+			return;
 	}
 }
 
@@ -357,52 +408,28 @@ R_RunParticleEffect
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
 	int			i, j;
-	particle_t	*p;
+	vec3_t		porg, vel;
+	float		die;
+	int			pcolor;
+
+	if (count == 1024)
+	{	// rocket explosion
+		R_ParticleExplosion (org);
+		return;
+	}
 	
 	for (i=0 ; i<count ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		if (count == 1024)
-		{	// rocket explosion
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = rand()&3;
-			if (i & 1)
-			{
-				p->type = pt_explode;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-			else
-			{
-				p->type = pt_explode2;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-		}
-		else
+		die = cl.time + 0.1*(rand()%5);
+		pcolor = (color&~7) + (rand()&7);
+		for (j=0 ; j<3 ; j++)
 		{
-			p->die = cl.time + 0.1*(rand()%5);
-			p->color = (color&~7) + (rand()&7);
-			p->type = pt_slowgrav;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()&15)-8);
-				p->vel[j] = dir[j]*15;// + (rand()%300)-150;
-			}
+			porg[j] = org[j] + ((rand()&15)-8);
+			vel[j] = dir[j]*15;// + (rand()%300)-150;
 		}
+
+		if (!R_SpawnParticle (pt_slowgrav, porg, vel, pcolor, 0, die))
+			return;
 	}
 }
 
@@ -416,36 +443,31 @@ R_LavaSplash
 void R_LavaSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
-	float		vel;
-	vec3_t		dir;
+	float		vel, die;
+	int			color;
+	vec3_t		dir, porg, pvel;
 
 	for (i=-16 ; i<16 ; i++)
 		for (j=-16 ; j<16 ; j++)
 			for (k=0 ; k<1 ; k++)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-		
-				p->die = cl.time + 2 + (rand()&31) * 0.02;
-				p->color = 224 + (rand()&7);
-				p->type = pt_slowgrav;
+				die = cl.time + 2 + (rand()&31) * 0.02;
+				color = 224 + (rand()&7);
 				
 				dir[0] = j*8 + (rand()&7);
 				dir[1] = i*8 + (rand()&7);
 				dir[2] = 256;
 	
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (rand()&63);
+				porg[0] = org[0] + dir[0];
+				porg[1] = org[1] + dir[1];
+				porg[2] = org[2] + (rand()&63);
 	
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, pvel);
+
+				if (!R_SpawnParticle (pt_slowgrav, porg, pvel, color, 0, die))
+					return;
 			}
 }
 
@@ -458,45 +480,40 @@ R_TeleportSplash
 void R_TeleportSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
-	float		vel;
-	vec3_t		dir;
+	float		vel, die;
+	int			color;
+	vec3_t		dir, porg, pvel;
 
 	for (i=-16 ; i<16 ; i+=4)
 		for (j=-16 ; j<16 ; j+=4)
 			for (k=-24 ; k<32 ; k+=4)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-		
-				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
-				p->color = 7 + (rand()&7);
-				p->type = pt_slowgrav;
+				die = cl.time + 0.2 + (rand()&7) * 0.02;
+				color = 7 + (rand()&7);
 				
 				dir[0] = j*8;
 				dir[1] = i*8;
 				dir[2] = k*8;
 	
-				p->org[0] = org[0] + i + (rand()&3);
-				p->org[1] = org[1] + j + (rand()&3);
-				p->org[2] = org[2] + k + (rand()&3);
+				porg[0] = org[0] + i + (rand()&3);
+				porg[1] = org[1] + j + (rand()&3);
+				porg[2] = org[2] + k + (rand()&3);
 	
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, pvel);
+
+				if (!R_SpawnParticle (pt_slowgrav, porg, pvel, color, 0, die))
+					return;
 			}
 }
 
 void R_RocketTrail (vec3_t start, vec3_t end, int type)
 {
-	vec3_t		vec;
-	float		len;
-	int			j;
-	particle_t	*p;
+	vec3_t		vec, org, vel;
+	float		len, ramp, die;
+	int			j, color;
+	ptype_t		ptype;
 	int			dec;
 	static int	tracercount;
 
@@ -514,104 +531,186 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-		
-		VectorCopy (vec3_origin, p->vel);
-		p->die = cl.time + 2;
+		VectorCopy (vec3_origin, vel);
+		ramp = 0;
+		die = cl.time + 2;
 
 		switch (type)
 		{
 			case 0:	// rocket trail
-				p->ramp = (rand()&3);
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				ramp = (rand()&3);
+				color = ramp3[(int)ramp];
+				ptype = pt_fire;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					org[j] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 1:	// smoke smoke
-				p->ramp = (rand()&3) + 2;
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				ramp = (rand()&3) + 2;
+				color = ramp3[(int)ramp];
+				ptype = pt_fire;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					org[j] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 2:	// blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
+				ptype = pt_grav;
+				color = 67 + (rand()&3);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					org[j] = start[j] + ((rand()%6)-3);
 				break;
 
 			case 3:
 			case 5:	// tracer
-				p->die = cl.time + 0.5;
-				p->type = pt_static;
+				die = cl.time + 0.5;
+				ptype = pt_static;
 				if (type == 3)
-					p->color = 52 + ((tracercount&4)<<1);
+					color = 52 + ((tracercount&4)<<1);
 				else
-					p->color = 230 + ((tracercount&4)<<1);
+					color = 230 + ((tracercount&4)<<1);
 			
 				tracercount++;
 
-				VectorCopy (start, p->org);
+				VectorCopy (start, org);
 				if (tracercount & 1)
 				{
-					p->vel[0] = 30*vec[1];
-					p->vel[1] = 30*-vec[0];
+					vel[0] = 30*vec[1];
+					vel[1] = 30*-vec[0];
 				}
 				else
 				{
-					p->vel[0] = 30*-vec[1];
-					p->vel[1] = 30*vec[0];
+					vel[0] = 30*-vec[1];
+					vel[1] = 30*vec[0];
 				}
 				break;
 
 			case 4:	// slight blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
+				ptype = pt_grav;
+				color = 67 + (rand()&3);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					org[j] = start[j] + ((rand()%6)-3);
 				len -= 3;
 				break;
 
 			case 6:	// voor trail
-				p->color = 9*16 + 8 + (rand()&3);
-				p->type = pt_static;
-				p->die = cl.time + 0.3;
+				color = 9*16 + 8 + (rand()&3);
+				ptype = pt_static;
+				die = cl.time + 0.3;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()&15)-8);
+					org[j] = start[j] + ((rand()&15)-8);
 				break;
+
+			default:
+				return;
 		}
-		
+
+		if (!R_SpawnParticle (ptype, org, vel, color, ramp, die))
+			return;
 
 		VectorAdd (start, vec, start);
 	}
 }
 
 
+extern	cvar_t	sv_gravity;
+
 /*
 ===============
-R_DrawParticles
+R_KillParticles
+
+Drops the stream's dead particles, keeping the rest in order
 ===============
 */
-extern	cvar_t	sv_gravity;
+static void R_KillParticles (pstream_t *ps)
+{
+	int		i, j, k;
+	double	time;
+
+	time = cl.time;
+	for (i=0 ; i<ps->count ; i++)
+		if (ps->die[i] < time)
+			break;
+
+	for (j=i ; i<ps->count ; i++)
+	{
+		if (ps->die[i] < time)
+			continue;
+		for (k=0 ; k<3 ; k++)
+		{
+			ps->org[k][j] = ps->org[k][i];
+			ps->vel[k][j] = ps->vel[k][i];
+		}
+		ps->ramp[j] = ps->ramp[i];
+		ps->die[j] = ps->die[i];
+		ps->color[j] = ps->color[i];
+		j++;
+	}
+
+	r_liveparticles -= ps->count - j;
+	ps->count = j;
+}
+
+/*
+===============
+R_RampParticles
+
+Ages a stream through its color ramp, killing what runs off the end
+===============
+*/
+static void R_RampParticles (pstream_t *ps, float step, float end, int *ramp)
+{
+	int		i;
 
+	for (i=0 ; i<ps->count ; i++)
+	{
+		ps->ramp[i] += step;
+		if (ps->ramp[i] >= end)
+			ps->die[i] = -1;
+		else
+			ps->color[i] = ramp[(int)ps->ramp[i]];
+	}
+}
+
+/*
+===============
+R_ScaleParticles
+
+Scales the first axes components of every velocity in the stream, then
+adds grav to the vertical one
+===============
+*/
+static void R_ScaleParticles (pstream_t *ps, int axes, float scale, float grav)
+{
+	int		i, k;
+	float	*vel;
+
+	for (k=0 ; k<axes ; k++)
+	{
+		vel = ps->vel[k];
+		for (i=0 ; i<ps->count ; i++)
+			vel[i] *= scale;
+	}
+
+	vel = ps->vel[2];
+	for (i=0 ; i<ps->count ; i++)
+		vel[i] += grav;
+}
+
+/*
+===============
+R_DrawParticles
+===============
+*/
 void R_DrawParticles (void)
 {
-	particle_t		*p, *kill;
+	pstream_t		*ps;
 	float			grav;
-	int				i;
+	int				i, k;
 	float			time2, time3;
 	float			time1;
 	float			dvel;
 	float			frametime;
+	float			*org, *vel;
 	
 	D_StartParticles ();
 
@@ -625,95 +724,37 @@ void R_DrawParticles (void)
 	time1 = frametime * 5;
 	grav = frametime * sv_gravity.value * 0.05;
 	dvel = 4*frametime;
-	
-	for ( ;; ) 
-	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
-		break;
-	}
 
-	for (p=active_particles ; p ; p=p->next)
+// draw where they are now, then move them
+	for (ps=r_pstreams ; ps<&r_pstreams[NUM_PARTICLETYPES] ; ps++)
 	{
-		for ( ;; )
-		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
-		}
+		R_KillParticles (ps);
+		if (!ps->count)
+			continue;
 
-		D_DrawParticle (p);
+		D_DrawParticles (ps->count, ps->org[0], ps->org[1], ps->org[2],
+			ps->color);
 
-		p->org[0] += p->vel[0]*frametime;
-		p->org[1] += p->vel[1]*frametime;
-		p->org[2] += p->vel[2]*frametime;
-		
-		switch (p->type)
+		for (k=0 ; k<3 ; k++)
 		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
-
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] -= p->vel[i]*frametime;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_blob:
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_blob2:
-			for (i=0 ; i<2 ; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
-
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
+			org = ps->org[k];
+			vel = ps->vel[k];
+			for (i=0 ; i<ps->count ; i++)
+				org[i] += vel[i]*frametime;
 		}
 	}
 
+	R_RampParticles (&r_pstreams[pt_fire], time1, 6, ramp3);
+	R_RampParticles (&r_pstreams[pt_explode], time2, 8, ramp1);
+	R_RampParticles (&r_pstreams[pt_explode2], time3, 8, ramp2);
+
+	R_ScaleParticles (&r_pstreams[pt_fire], 0, 1, grav);
+	R_ScaleParticles (&r_pstreams[pt_explode], 3, 1 + dvel, -grav);
+	R_ScaleParticles (&r_pstreams[pt_explode2], 3, 1 - frametime, -grav);
+	R_ScaleParticles (&r_pstreams[pt_blob], 3, 1 + dvel, -grav);
+	R_ScaleParticles (&r_pstreams[pt_blob2], 2, 1 - dvel, -grav);
+	R_ScaleParticles (&r_pstreams[pt_grav], 0, 1, -grav);
+	R_ScaleParticles (&r_pstreams[pt_slowgrav], 0, 1, -grav);
+
 	D_EndParticles ();
 }
-
@@ -44,6 +44,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 extern void	R_DrawLine (polyvert_t *polyvert0, polyvert_t *polyvert1);
 
 extern int		cachewidth;
+extern int		cacheheight;
+extern int		cachetileshift;
 extern pixel_t	*cacheblock;
 extern int		screenwidth;
 
@@ -40,10 +40,12 @@ int r_skydirect;		// not used?
 
 EXT_RAM_BSS_ATTR byte	bottomsky[128*131];
 EXT_RAM_BSS_ATTR byte	bottommask[128*131];
-EXT_RAM_BSS_ATTR byte	newsky[128*256];	// newsky and topsky both pack in here, 128 bytes
-							//  of newsky on the left of each scan, 128 bytes
-							//  of topsky on the right, because the low-level
-							//  drawers need 256-byte scan widths
+EXT_RAM_BSS_ATTR byte	topsky[128*128];		// the masked layer, which doesn't scroll
+EXT_RAM_BSS_ATTR byte	skybuffers[2][128*128];	// the composite being shown, and the
+											//  one for the next scroll step
+
+static byte	*r_skycur, *r_skynext;
+static int	r_skyshift, r_skynextshift, r_skynextrows;
 
 
 /*
@@ -64,7 +66,7 @@ void R_InitSky (texture_t *mt)
 	{
 		for (j=0 ; j<128 ; j++)
 		{
-			newsky[(i*256) + j + 128] = src[i*256 + j + 128];
+			topsky[(i*128) + j] = src[i*256 + j + 128];
 		}
 	}
 
@@ -84,92 +86,104 @@ void R_InitSky (texture_t *mt)
 			}
 		}
 	}
-	
-	r_skysource = newsky;
+
+	r_skycur = skybuffers[0];
+	r_skynext = skybuffers[1];
+	r_skyshift = r_skynextshift = -1;
+	r_skysource = r_skycur;
 }
 
 
 /*
 =================
-R_MakeSky
+R_SkyRows
+
+Composites rows first through last-1 of the sky for a scroll step: the
+top layer stays put and the bottom one slides under it
 =================
 */
-void R_MakeSky (void)
+static void R_SkyRows (byte *pdest, int shift, int first, int last)
 {
-	int			x, y;
-	int			ofs, baseofs;
-	int			xshift, yshift;
-	unsigned	*pnewsky;
-	static int	xlast = -1, ylast = -1;
-
-	xshift = skytime*skyspeed;
-	yshift = skytime*skyspeed;
-
-	if ((xshift == xlast) && (yshift == ylast))
-		return;
-
-	xlast = xshift;
-	ylast = yshift;
-	
-	pnewsky = (unsigned *)&newsky[0];
+	int		x, y;
+	int		ofs, baseofs;
+	byte	*ptop, *pd;
 
-	for (y=0 ; y<SKYSIZE ; y++)
+	for (y=first ; y<last ; y++)
 	{
-		baseofs = ((y+yshift) & SKYMASK) * 131;
+		baseofs = ((y+shift) & SKYMASK) * 131;
+		ptop = &topsky[y*SKYSIZE];
+		pd = pdest + y*SKYSIZE;
 
 		for (x=0 ; x<SKYSIZE ; x++)
 		{
-			ofs = baseofs + ((x+xshift) & SKYMASK);
-
-			*(byte *)pnewsky = (*((byte *)pnewsky + 128) &
-						*(byte *)&bottommask[ofs]) |
-						*(byte *)&bottomsky[ofs];
-			pnewsky = (unsigned *)((byte *)pnewsky + 1);
+			ofs = baseofs + ((x+shift) & SKYMASK);
+			pd[x] = (ptop[x] & bottommask[ofs]) | bottomsky[ofs];
 		}
-
-		pnewsky += 128 / sizeof (unsigned);
 	}
-
-	r_skymade = 1;
 }
 
 
 /*
 =================
-R_GenSkyTile
+R_MakeSky
+
+The composite changes completely at each scroll step, so rather than
+rebuilding all of it on the frame the step lands, the next step's
+composite is built a few rows per frame ahead of time and swapped in
 =================
 */
-void R_GenSkyTile (void *pdest)
+void R_MakeSky (void)
 {
-	int			x, y;
-	int			ofs, baseofs;
-	int			xshift, yshift;
-	unsigned	*pnewsky;
-	unsigned	*pd;
-
-	xshift = skytime*skyspeed;
-	yshift = skytime*skyspeed;
+	int		shift, want;
+	float	step;
+	byte	*temp;
 
-	pnewsky = (unsigned *)&newsky[0];
-	pd = (unsigned *)pdest;
+	step = skytime*skyspeed;
+	shift = (int)step & SKYMASK;
 
-	for (y=0 ; y<SKYSIZE ; y++)
+	if (shift != r_skyshift)
 	{
-		baseofs = ((y+yshift) & SKYMASK) * 131;
-
-		for (x=0 ; x<SKYSIZE ; x++)
+		if (shift == r_skynextshift)
 		{
-			ofs = baseofs + ((x+xshift) & SKYMASK);
-
-			*(byte *)pd = (*((byte *)pnewsky + 128) &
-						*(byte *)&bottommask[ofs]) |
-						*(byte *)&bottomsky[ofs];
-			pnewsky = (unsigned *)((byte *)pnewsky + 1);
-			pd = (unsigned *)((byte *)pd + 1);
+			R_SkyRows (r_skynext, shift, r_skynextrows, SKYSIZE);
+			temp = r_skycur;
+			r_skycur = r_skynext;
+			r_skynext = temp;
+		}
+		else
+		{
+		// first sight of this sky, or time jumped
+			R_SkyRows (r_skycur, shift, 0, SKYSIZE);
 		}
 
-		pnewsky += 128 / sizeof (unsigned);
+		r_skyshift = shift;
+		r_skynextshift = (shift + 1) & SKYMASK;
+		r_skynextrows = 0;
 	}
+
+// aim to have the next one finished half way through this step
+	want = (int)((step - (int)step) * 2 * SKYSIZE) + 1;
+	if (want > SKYSIZE)
+		want = SKYSIZE;
+	if (want > r_skynextrows)
+	{
+		R_SkyRows (r_skynext, r_skynextshift, r_skynextrows, want);
+		r_skynextrows = want;
+	}
+
+	r_skysource = r_skycur;
+	r_skymade = 1;
+}
+
+
+/*
+=================
+R_GenSkyTile
+=================
+*/
+void R_GenSkyTile (void *pdest)
+{
+	R_SkyRows (pdest, (int)(skytime*skyspeed), 0, SKYSIZE);
 }
 
 /*
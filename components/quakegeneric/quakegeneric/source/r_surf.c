@@ -266,7 +266,10 @@ void R_DrawSurface (void)
 
 	pblockdrawer = surfmiptable[r_drawsurf.surfmip];
 	// TODO: only needs to be set when there is a display settings change
-	horzblockstep = blocksize;
+	if (r_drawsurf.tiled)
+		horzblockstep = blocksize * r_drawsurf.surfheight;
+	else
+		horzblockstep = blocksize;
 
 	smax = mt->width >> r_drawsurf.surfmip;
 	twidth = texwidth;
@@ -515,20 +518,25 @@ R_GenTurbTile
 void R_GenTurbTile (pixel_t *pbasetex, void *pdest)
 {
 	int		*turb;
-	int		i, j, s, t;
+	int		i, j, soffset, trow;
+	int		toffset[TILE_SIZE];
 	byte	*pd;
 	
 	turb = sintable + ((int)(cl.time*SPEED)&(CYCLE-1));
 	pd = (byte *)pdest;
 
+// the sine table is never negative, so the warp comes apart into a whole
+// texel s offset per row and t offset per column
+	for (j=0 ; j<TILE_SIZE ; j++)
+		toffset[j] = (turb[j & (CYCLE-1)] >> 16) << 6;
+
 	for (i=0 ; i<TILE_SIZE ; i++)
 	{
+		soffset = turb[i & (CYCLE-1)] >> 16;
+		trow = i << 6;
+
 		for (j=0 ; j<TILE_SIZE ; j++)
-		{	
-			s = (((j << 16) + turb[i & (CYCLE-1)]) >> 16) & 63;
-			t = (((i << 16) + turb[j & (CYCLE-1)]) >> 16) & 63;
-			*pd++ = *(pbasetex + (t<<6) + s);
-		}
+			*pd++ = pbasetex[((trow + toffset[j]) & (63<<6)) + ((j + soffset) & 63)];
 	}
 }
 
@@ -67,6 +67,12 @@ typedef struct entity_s
 	struct mnode_s			*topnode;		// for bmodels, first world node
 											//  that splits bmodel, or NULL if
 											//  not split
+
+// static entities never move, so their lighting and pose are cached
+	qboolean				lightcached;	// lightsurf and lightsample valid
+	struct msurface_s		*lightsurf;		// surface below origin, or NULL
+	byte					*lightsample;	// lightmap texel on lightsurf
+	cache_user_t			posecache;		// aliaspose_t for alias models
 } entity_t;
 
 // !!! if this is changed, it must be changed in asm_draw.h too !!!
@@ -117,6 +123,8 @@ void R_Init (void);
 void R_InitTextures (void);
 void R_InitEfrags (void);
 void R_RenderView (void);		// must set r_refdef first
+qboolean R_ReuseView (void);	// puts back the last view if nothing changed
+void R_KeepView (void);			// call after R_RenderView if not reused
 void R_ViewChanged (vrect_t *pvrect, int lineadj, float aspect);
 								// called whenever r_refdef or vid change
 void R_InitSky (struct texture_s *mt);	// called at level load
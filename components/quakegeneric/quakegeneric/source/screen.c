@@ -36,6 +36,7 @@ cvar_t		scr_conspeed = {"scr_conspeed","300"};
 cvar_t		scr_centertime = {"scr_centertime","2"};
 cvar_t		scr_showram = {"showram","1"};
 cvar_t		scr_showturtle = {"showturtle","0"};
+cvar_t		scr_shownetstats = {"shownetstats","0"};
 cvar_t		scr_showpause = {"showpause","1"};
 cvar_t		scr_printspeed = {"scr_printspeed","8"};
 
@@ -318,6 +319,7 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_conspeed);
 	Cvar_RegisterVariable (&scr_showram);
 	Cvar_RegisterVariable (&scr_showturtle);
+	Cvar_RegisterVariable (&scr_shownetstats);
 	Cvar_RegisterVariable (&scr_showpause);
 	Cvar_RegisterVariable (&scr_centertime);
 	Cvar_RegisterVariable (&scr_printspeed);
@@ -394,6 +396,42 @@ void SCR_DrawNet (void)
 	Draw_Pic (scr_vrect.x+64, scr_vrect.y, scr_net);
 }
 
+/*
+==============
+SCR_DrawNetStats
+
+One line per open connection: throughput in kilobytes per second,
+last round trip and jitter in milliseconds, dropped datagrams and
+reliable retransmits.
+==============
+*/
+void SCR_DrawNetStats (void)
+{
+	qsocket_t	*s;
+	netstats_t	*st;
+	char		str[64];
+	int			y;
+
+	if (!scr_shownetstats.value)
+		return;
+
+	y = scr_vrect.y + 32;
+	Draw_String (scr_vrect.x, y, "address     kBin kBout rtt jit drop rsnt");
+
+	for (s = net_activeSockets ; s ; s = s->next)
+	{
+		y += 8;
+		if (y > scr_vrect.y + scr_vrect.height - 8)
+			break;
+		st = &s->stats;
+		NET_UpdateRates (s);
+		sprintf (str, "%-10.10s%6.1f%6.1f%4i%4i%5i%5i", s->address,
+			st->receiveRate / 1024, st->sendRate / 1024, (int)(st->rtt * 1000),
+			(int)(st->jitter * 1000), st->droppedDatagrams, st->packetsReSent);
+		Draw_String (scr_vrect.x, y, str);
+	}
+}
+
 /*
 ==============
 DrawPause
@@ -926,6 +964,7 @@ void SCR_UpdateScreen (void)
 		SCR_DrawRam ();
 		SCR_DrawNet ();
 		SCR_DrawTurtle ();
+		SCR_DrawNetStats ();
 		SCR_DrawPause ();
 		SCR_CheckDrawCenterString ();
 		Sbar_Draw ();
@@ -215,6 +215,8 @@ void SV_Physics (void);
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
+int ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce);
+
 void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
 
 void SV_MoveToGoal (void);
@@ -223,3 +225,9 @@ void SV_CheckForNewClients (void);
 void SV_RunClients (void);
 void SV_SaveSpawnparms ();
 void SV_SpawnServer (char *server);
+
+//
+// net_bot.c
+//
+void Bot_ServerFrame (double seconds);
+void Bot_RecordMove (vec3_t angles, usercmd_t *cmd, int buttons, int impulse);
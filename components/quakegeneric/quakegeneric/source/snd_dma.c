@@ -31,6 +31,9 @@ void S_SoundList(void);
 void S_Update_();
 void S_StopAllSounds(qboolean clear);
 void S_StopAllSoundsC(void);
+void S_Latency_f(void);
+void S_MarkLatency(void);
+void S_SoundStats_f(void);
 
 // =======================================================================
 // Internal sound data & structures
@@ -80,6 +83,9 @@ cvar_t ambient_fade = {"ambient_fade", "100"};
 cvar_t snd_noextraupdate = {"snd_noextraupdate", "0"};
 cvar_t snd_show = {"snd_show", "0"};
 cvar_t _snd_mixahead = {"_snd_mixahead", "0.1", true};
+cvar_t snd_adaptive = {"snd_adaptive", "1", true};
+cvar_t snd_maxvoices = {"snd_maxvoices", "16", true};
+cvar_t snd_respatialize = {"snd_respatialize", "4"};
 
 
 // ====================================================================
@@ -192,6 +198,12 @@ void S_Init (void)
 	Cvar_RegisterVariable(&snd_noextraupdate);
 	Cvar_RegisterVariable(&snd_show);
 	Cvar_RegisterVariable(&_snd_mixahead);
+	Cvar_RegisterVariable(&snd_adaptive);
+	Cvar_RegisterVariable(&snd_maxvoices);
+	Cvar_RegisterVariable(&snd_respatialize);
+	Cvar_RegisterVariable(&snd_diskcache);
+	Cmd_AddCommand("snd_latency", S_Latency_f);
+	Cmd_AddCommand("snd_stats", S_SoundStats_f);
 
 	if (host_parms.memsize < 0x800000)
 	{
@@ -205,7 +217,7 @@ void S_Init (void)
 
 	S_Startup ();
 
-	SND_InitScaletable ();
+	SND_InitMixer ();
 
 	known_sfx = Hunk_AllocName (MAX_SFX*sizeof(sfx_t), "sfx_t");
 	num_sfx = 0;
@@ -408,6 +420,8 @@ void SND_Spatialize(channel_t *ch)
 	{
 		ch->leftvol = ch->master_vol;
 		ch->rightvol = ch->master_vol;
+		ch->spatialleft = ch->leftvol;
+		ch->spatialright = ch->rightvol;
 		return;
 	}
 
@@ -415,6 +429,14 @@ void SND_Spatialize(channel_t *ch)
 
 	snd = ch->sfx;
 	VectorSubtract(ch->origin, listener_origin, source_vec);
+
+// out of earshot, no need to normalize
+	if (DotProduct(source_vec, source_vec) * ch->dist_mult * ch->dist_mult >= 1.0)
+	{
+		ch->leftvol = ch->rightvol = 0;
+		ch->spatialleft = ch->spatialright = 0;
+		return;
+	}
 	
 	dist = VectorNormalize(source_vec) * ch->dist_mult;
 	
@@ -441,6 +463,9 @@ void SND_Spatialize(channel_t *ch)
 	ch->leftvol = (int) (ch->master_vol * scale);
 	if (ch->leftvol < 0)
 		ch->leftvol = 0;
+
+	ch->spatialleft = ch->leftvol;
+	ch->spatialright = ch->rightvol;
 }           
 
 
@@ -514,6 +539,8 @@ void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float f
 		}
 		
 	}
+
+	S_MarkLatency ();
 }
 
 void S_StopSound(int entnum, int entchannel)
@@ -615,6 +642,10 @@ void S_ClearBuffer (void)
 /*
 =================
 S_StaticSound
+
+A sound still being converted gets its channel anyway, so the ambient
+starts as soon as the converter hands it over instead of staying silent
+for the level
 =================
 */
 void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
@@ -636,9 +667,11 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 
 	sc = S_LoadSound (sfx);
 	if (!sc)
-		return;
-
-	if (sc->loopstart == -1)
+	{
+		if (!sfx->converting)
+			return;
+	}
+	else if (sc->loopstart == -1)
 	{
 		Con_Printf ("Sound %s not looped\n", sfx->name);
 		return;
@@ -648,7 +681,10 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 	VectorCopy (origin, ss->origin);
 	ss->master_vol = vol;
 	ss->dist_mult = (attenuation/64) / sound_nominal_clip_dist;
-    ss->end = paintedtime + sc->length;	
+	if (sc)
+		ss->end = paintedtime + sc->length;
+	else
+		ss->end = paintedtime;	// mixer loops it in once it's converted
 	
 	SND_Spatialize (ss);
 }
@@ -711,6 +747,153 @@ void S_UpdateAmbientSounds (void)
 }
 
 
+/*
+===============================================================================
+
+VOICES
+
+Channels are only respatialized once the listener has moved
+snd_respatialize units or turned a couple of degrees since the last
+time; sound origins never move once started, and new sounds are
+spatialized when they start.  In between, the volumes saved by
+SND_Spatialize are reused.
+
+After static sounds are combined, anything below the audible floor is
+dropped and at most snd_maxvoices of the loudest remaining channels are
+mixed.  Culled channels are left with zero volume for this update, just
+like channels that are out of earshot.
+
+===============================================================================
+*/
+
+#define	SND_MINVOL			8		// quieter than this isn't worth mixing
+#define	RESPATIALIZE_DOT	0.9995	// about two degrees of turn
+
+static vec3_t	spatial_origin;
+static vec3_t	spatial_right;
+static int		spatial_viewentity = -1;
+
+static struct
+{
+	int		updates;
+	int		respatialized;	// updates that respatialized
+	int		spatialized;	// channels, over all updates
+	int		active;			// channels with a sound, last update
+	int		audible;
+	int		combined;
+	int		culled;
+	int		mixed;
+	int		peak_active;
+	int		peak_audible;
+	int		peak_culled;
+} snd_voices;
+
+/*
+=================
+S_ListenerMoved
+
+True if the channels need to be respatialized
+=================
+*/
+static qboolean S_ListenerMoved (void)
+{
+	vec3_t	delta;
+	float	dist;
+
+	dist = snd_respatialize.value;
+	VectorSubtract (listener_origin, spatial_origin, delta);
+	if (dist > 0 && cl.viewentity == spatial_viewentity
+	&& DotProduct (delta, delta) < dist*dist
+	&& DotProduct (listener_right, spatial_right) > RESPATIALIZE_DOT)
+		return false;
+
+	VectorCopy (listener_origin, spatial_origin);
+	VectorCopy (listener_right, spatial_right);
+	spatial_viewentity = cl.viewentity;
+	return true;
+}
+
+/*
+=================
+S_CullVoices
+
+Keeps the snd_maxvoices loudest audible channels
+=================
+*/
+static void S_CullVoices (void)
+{
+	int			i, j, n, max, vol, key;
+	channel_t	*ch;
+	int			audible[MAX_CHANNELS];
+	int			loudness[MAX_CHANNELS];
+
+	n = 0;
+	ch = channels+NUM_AMBIENTS;
+	for (i=NUM_AMBIENTS ; i<total_channels ; i++, ch++)
+	{
+		if (!ch->sfx || (!ch->leftvol && !ch->rightvol))
+			continue;
+		if (ch->leftvol < SND_MINVOL && ch->rightvol < SND_MINVOL)
+		{
+			ch->leftvol = ch->rightvol = 0;
+			continue;
+		}
+		audible[n] = i;
+		loudness[n] = ch->leftvol + ch->rightvol;
+		n++;
+	}
+
+	snd_voices.audible = n;
+	snd_voices.culled = 0;
+	max = snd_maxvoices.value;
+	if (max > 0 && n > max)
+	{
+	// insertion sort, loudest first; n is small
+		for (i=1 ; i<n ; i++)
+		{
+			key = audible[i];
+			vol = loudness[i];
+			for (j=i ; j>0 && loudness[j-1] < vol ; j--)
+			{
+				audible[j] = audible[j-1];
+				loudness[j] = loudness[j-1];
+			}
+			audible[j] = key;
+			loudness[j] = vol;
+		}
+		for (i=max ; i<n ; i++)
+			channels[audible[i]].leftvol = channels[audible[i]].rightvol = 0;
+		snd_voices.culled = n - max;
+		n = max;
+	}
+	snd_voices.mixed = n;
+
+	if (snd_voices.audible > snd_voices.peak_audible)
+		snd_voices.peak_audible = snd_voices.audible;
+	if (snd_voices.culled > snd_voices.peak_culled)
+		snd_voices.peak_culled = snd_voices.culled;
+}
+
+void S_SoundStats_f (void)
+{
+	Con_Printf ("voices: %i active, %i audible, %i combined, %i culled, %i mixed (cap %i)\n",
+		snd_voices.active, snd_voices.audible, snd_voices.combined,
+		snd_voices.culled, snd_voices.mixed, (int)snd_maxvoices.value);
+	Con_Printf ("peak:   %i active, %i audible, %i culled\n",
+		snd_voices.peak_active, snd_voices.peak_audible, snd_voices.peak_culled);
+	if (snd_voices.updates)
+		Con_Printf ("respatialized %i of %i updates, %.1f channels each\n",
+			snd_voices.respatialized, snd_voices.updates,
+			snd_voices.respatialized ? (float)snd_voices.spatialized / snd_voices.respatialized : 0);
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+	{
+		snd_voices.updates = snd_voices.respatialized = snd_voices.spatialized = 0;
+		snd_voices.peak_active = snd_voices.peak_audible = snd_voices.peak_culled = 0;
+	}
+}
+
+
 /*
 ============
 S_Update
@@ -724,6 +907,7 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 	int			total;
 	channel_t	*ch;
 	channel_t	*combine;
+	qboolean	respatialize;
 
 	if (!sound_started || (snd_blocked > 0))
 		return;
@@ -733,10 +917,18 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 	VectorCopy(right, listener_right);
 	VectorCopy(up, listener_up);
 	
+// pick up sounds converted in the background
+	S_FinishConversions ();
+
 // update general area ambient sound sources
 	S_UpdateAmbientSounds ();
 
 	combine = NULL;
+	respatialize = S_ListenerMoved ();
+	snd_voices.updates++;
+	if (respatialize)
+		snd_voices.respatialized++;
+	snd_voices.active = snd_voices.combined = 0;
 
 // update spatialization for static and dynamic sounds	
 	ch = channels+NUM_AMBIENTS;
@@ -744,7 +936,17 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 	{
 		if (!ch->sfx)
 			continue;
-		SND_Spatialize(ch);         // respatialize channel
+		snd_voices.active++;
+		if (respatialize)
+		{
+			SND_Spatialize(ch);         // respatialize channel
+			snd_voices.spatialized++;
+		}
+		else
+		{
+			ch->leftvol = ch->spatialleft;
+			ch->rightvol = ch->spatialright;
+		}
 		if (!ch->leftvol && !ch->rightvol)
 			continue;
 
@@ -759,6 +961,7 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 				combine->leftvol += ch->leftvol;
 				combine->rightvol += ch->rightvol;
 				ch->leftvol = ch->rightvol = 0;
+				snd_voices.combined++;
 				continue;
 			}
 		// search for one
@@ -778,6 +981,7 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 					combine->leftvol += ch->leftvol;
 					combine->rightvol += ch->rightvol;
 					ch->leftvol = ch->rightvol = 0;
+					snd_voices.combined++;
 				}
 				continue;
 			}
@@ -786,6 +990,12 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 		
 	}
 
+	if (snd_voices.active > snd_voices.peak_active)
+		snd_voices.peak_active = snd_voices.active;
+
+// only mix the loudest
+	S_CullVoices ();
+
 //
 // debugging output
 //
@@ -807,6 +1017,139 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 	S_Update_();
 }
 
+/*
+===============================================================================
+
+LATENCY
+
+The mixer stays just far enough ahead of the playback position to ride
+out the gaps between updates: the device's own read-ahead
+(submission_chunk), plus half again the recent worst gap between
+S_Update_ calls, plus a little slack.  The worst gap decays slowly back
+towards the typical one and jumps up on every underrun.  _snd_mixahead
+caps it, or sets it outright with snd_adaptive 0.
+
+Each started sound also notes the wall time and the sample it was
+mixed at, so the delay until the device reports playing it can be
+measured.
+
+===============================================================================
+*/
+
+#define	MAX_LATENCYMARKS	16
+
+typedef struct
+{
+	int		sample;
+	double	time;
+} latencymark_t;
+
+static latencymark_t	snd_marks[MAX_LATENCYMARKS];
+static int		snd_nummarks;
+
+static double	snd_lastupdate;
+static float	snd_updatepeak;		// recent worst gap between updates, seconds
+static float	snd_mixahead;		// in use, seconds
+static int		snd_underruns;
+
+static int		snd_latencycount;
+static double	snd_latencytotal;
+static float	snd_latencylast, snd_latencymin, snd_latencymax;
+
+void S_MarkLatency (void)
+{
+	if (snd_nummarks == MAX_LATENCYMARKS)
+		return;
+	snd_marks[snd_nummarks].sample = paintedtime;
+	snd_marks[snd_nummarks].time = Sys_FloatTime ();
+	snd_nummarks++;
+}
+
+static void S_CheckLatencyMarks (void)
+{
+	int		i, j;
+	double	now;
+	float	latency;
+
+	if (!snd_nummarks)
+		return;
+
+	now = Sys_FloatTime ();
+	for (i=j=0 ; i<snd_nummarks ; i++)
+	{
+		if (snd_marks[i].sample > soundtime)
+		{
+			snd_marks[j++] = snd_marks[i];
+			continue;
+		}
+
+		latency = now - snd_marks[i].time;
+		snd_latencylast = latency;
+		if (!snd_latencycount || latency < snd_latencymin)
+			snd_latencymin = latency;
+		if (latency > snd_latencymax)
+			snd_latencymax = latency;
+		snd_latencytotal += latency;
+		snd_latencycount++;
+	}
+	snd_nummarks = j;
+}
+
+static void S_AdaptMixahead (void)
+{
+	double	now, gap;
+	float	readahead;
+
+	now = Sys_FloatTime ();
+	gap = now - snd_lastupdate;
+	snd_lastupdate = now;
+	if (gap > 0.5)
+		gap = 0;		// first update, or a level load; don't size for that
+
+	if (gap > snd_updatepeak)
+		snd_updatepeak = gap;
+	else
+		snd_updatepeak += (gap - snd_updatepeak) * 0.01;
+
+	if (!snd_adaptive.value)
+	{
+		snd_mixahead = _snd_mixahead.value;
+		return;
+	}
+
+	readahead = (float)shm->submission_chunk / shm->channels / shm->speed;
+	snd_mixahead = readahead + snd_updatepeak * 1.5 + 0.005;
+	if (snd_mixahead > _snd_mixahead.value)
+		snd_mixahead = _snd_mixahead.value;
+}
+
+void S_Latency_f (void)
+{
+	if (!sound_started || !shm)
+	{
+		Con_Printf ("sound system not started\n");
+		return;
+	}
+
+	Con_Printf ("mixahead      %5.1f ms (%s, cap %.1f ms)\n", snd_mixahead * 1000,
+		snd_adaptive.value ? "adaptive" : "fixed", _snd_mixahead.value * 1000);
+	Con_Printf ("device ahead  %5.1f ms\n", (float)shm->submission_chunk / shm->channels / shm->speed * 1000);
+	Con_Printf ("update peak   %5.1f ms\n", snd_updatepeak * 1000);
+	Con_Printf ("underruns     %5i\n", snd_underruns);
+	if (snd_latencycount)
+		Con_Printf ("start latency %5.1f ms last, %.1f avg, %.1f min, %.1f max (%i sounds)\n",
+			snd_latencylast * 1000, snd_latencytotal / snd_latencycount * 1000,
+			snd_latencymin * 1000, snd_latencymax * 1000, snd_latencycount);
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+	{
+		snd_underruns = 0;
+		snd_latencycount = 0;
+		snd_latencytotal = 0;
+		snd_latencymin = snd_latencymax = 0;
+	}
+}
+
 void GetSoundtime(void)
 {
 	int		samplepos;
@@ -832,6 +1175,7 @@ void GetSoundtime(void)
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			paintedtime = fullsamples;
+			snd_nummarks = 0;
 			S_StopAllSounds (true);
 		}
 	}
@@ -857,6 +1201,7 @@ void S_Update_(void)
 {
 	unsigned        endtime;
 	int				samps;
+	int				writetime;
 	
 	if (!sound_started || (snd_blocked > 0))
 		return;
@@ -864,15 +1209,27 @@ void S_Update_(void)
 // Updates DMA time
 	GetSoundtime();
 
-// check to make sure that we haven't overshot
-	if (paintedtime < soundtime)
+	S_CheckLatencyMarks ();
+
+// check to make sure that we haven't overshot.  The device has already
+// taken everything up to its write cursor, submission_chunk past the play
+// position, so anything below that went out unpainted and painting picks
+// up after it
+	writetime = soundtime + shm->submission_chunk / shm->channels;
+	if (paintedtime < writetime)
 	{
 		//Con_Printf ("S_Update_ : overflow\n");
-		paintedtime = soundtime;
+		if (paintedtime)
+		{	// not just the first update
+			snd_underruns++;
+			snd_updatepeak = snd_updatepeak * 1.5 + 0.002;
+		}
+		paintedtime = writetime;
 	}
 
 // mix ahead of current position
-	endtime = soundtime + _snd_mixahead.value * shm->speed;
+	S_AdaptMixahead ();
+	endtime = soundtime + snd_mixahead * shm->speed;
 	samps = shm->samples >> (shm->channels-1);
 	if (endtime - soundtime > samps)
 		endtime = soundtime + samps;
@@ -987,12 +1344,23 @@ void S_ClearPrecache (void)
 }
 
 
+static double	precache_start;
+static int		precache_diskhits, precache_conversions;
+
 void S_BeginPrecaching (void)
 {
+	precache_start = Sys_FloatTime ();
+	precache_diskhits = snd_diskhits;
+	precache_conversions = snd_conversions;
 }
 
 
 void S_EndPrecaching (void)
 {
+	Con_DPrintf ("sound precache: %.0f ms, %i from sndcache, %i converted, %i still converting\n",
+		(Sys_FloatTime () - precache_start) * 1000,
+		snd_diskhits - precache_diskhits,
+		snd_conversions - precache_conversions,
+		snd_pending);
 }
 
@@ -25,12 +25,21 @@ int			cache_full_cycle;
 
 byte *S_Alloc (int size);
 
+cvar_t		snd_diskcache = {"snd_diskcache", "1"};
+
+int			snd_diskhits;
+int			snd_conversions;
+int			snd_pending;
+
 /*
 ================
 ResampleSfx
+
+Converts a mono .wav to speed, into a malloced sfxcache_t.  Only touches
+its own memory and arguments, so it can run on the converter thread.
 ================
 */
-void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+sfxcache_t *ResampleSfx (wavinfo_t *info, byte *data, int speed, qboolean as8bit, int *size)
 {
 	int		outcount;
 	int		srcsample;
@@ -38,28 +47,33 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	int		i;
 	int		sample, samplefrac, fracstep;
 	sfxcache_t	*sc;
+	int		width;
 	
-	sc = Cache_Check (&sfx->cache);
-	if (!sc)
-		return;
+	stepscale = (float)info->rate / speed;	// this is usually 0.5, 1, or 2
 
-	stepscale = (float)inrate / shm->speed;	// this is usually 0.5, 1, or 2
+	outcount = info->samples / stepscale;
+	if (as8bit)
+		width = 1;
+	else
+		width = info->width;
+
+	*size = sizeof(sfxcache_t) + outcount * width;
+	sc = malloc (*size);
+	if (!sc)
+		return NULL;
 
-	outcount = sc->length / stepscale;
 	sc->length = outcount;
+	sc->loopstart = info->loopstart;
 	if (sc->loopstart != -1)
 		sc->loopstart = sc->loopstart / stepscale;
 
-	sc->speed = shm->speed;
-	if (loadas8bit.value)
-		sc->width = 1;
-	else
-		sc->width = inwidth;
+	sc->speed = speed;
+	sc->width = width;
 	sc->stereo = 0;
 
 // resample / decimate to the current source rate
 
-	if (stepscale == 1 && inwidth == 1 && sc->width == 1)
+	if (stepscale == 1 && info->width == 1 && sc->width == 1)
 	{
 // fast special case
 		for (i=0 ; i<outcount ; i++)
@@ -75,7 +89,7 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 		{
 			srcsample = samplefrac >> 8;
 			samplefrac += fracstep;
-			if (inwidth == 2)
+			if (info->width == 2)
 				sample = LittleShort ( ((short *)data)[srcsample] );
 			else
 				sample = (int)( (unsigned char)(data[srcsample]) - 128) << 8;
@@ -85,6 +99,335 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 				((signed char *)sc->data)[i] = sample >> 8;
 		}
 	}
+
+	return sc;
+}
+
+/*
+===============================================================================
+
+DISK CACHE
+
+Converted sounds are kept under <gamedir>/sndcache/, exactly as they sit in
+the cache, so a later load (after a restart, or after the cache threw the
+sound out) is a single read.  A file is only used if it was converted from
+a .wav of the same length, for the same device rate and 8 bit setting.
+
+===============================================================================
+*/
+
+#define	SNDCACHE_IDENT		(('1'<<24)+('C'<<16)+('N'<<8)+'S')
+#define	SNDCACHE_MAXSIZE	(4*1024*1024)	// larger files are taken as corrupt
+
+typedef struct
+{
+	int		ident;
+	int		srclen;		// length of the .wav it came from
+	int		speed;		// shm->speed it was converted for
+	int		as8bit;		// loadas8bit when converted
+	int		size;		// sfxcache_t and data that follow
+} sndcachehdr_t;
+
+/*
+================
+S_SndCachePath
+
+Returns false if the path doesn't fit in MAX_OSPATH, in which case the
+sound is simply not cached
+================
+*/
+static qboolean S_SndCachePath (sfx_t *s, char *path)
+{
+	int		len;
+
+	len = snprintf (path, MAX_OSPATH, "%s/sndcache/%s", com_gamedir, s->name);
+	return len >= 0 && len < MAX_OSPATH;
+}
+
+/*
+================
+S_SndCacheValid
+
+The file is only trusted as far as it agrees with itself: the sound it
+describes has to fit in the size its header gives
+================
+*/
+static qboolean S_SndCacheValid (sfxcache_t *sc, int size)
+{
+	if (sc->width != 1 && sc->width != 2)
+		return false;
+	if (sc->stereo != 0 && sc->stereo != 1)
+		return false;
+	if (sc->length < 0 || sc->length > size)
+		return false;
+	if (sc->loopstart < -1 || sc->loopstart >= sc->length)
+		return false;
+	return sizeof(sfxcache_t) + sc->length*sc->width*(sc->stereo+1) <= size;
+}
+
+/*
+================
+S_ReadSndCache
+
+Loads a converted sound straight into the cache, or returns NULL
+================
+*/
+static sfxcache_t *S_ReadSndCache (sfx_t *s, int srclen)
+{
+	char			path[MAX_OSPATH];
+	FILE			*f;
+	sndcachehdr_t	hdr;
+	sfxcache_t		*sc;
+
+	if (!snd_diskcache.value)
+		return NULL;
+
+	if (!S_SndCachePath (s, path))
+		return NULL;
+	f = fopen (path, "rb");
+	if (!f)
+		return NULL;
+
+	sc = NULL;
+	if (fread (&hdr, sizeof(hdr), 1, f) == 1
+	&& hdr.ident == SNDCACHE_IDENT
+	&& hdr.srclen == srclen
+	&& hdr.speed == shm->speed
+	&& hdr.as8bit == (loadas8bit.value != 0)
+	&& hdr.size > sizeof(sfxcache_t)
+	&& hdr.size <= SNDCACHE_MAXSIZE)
+	{
+		sc = Cache_Alloc (&s->cache, hdr.size, s->name);
+		if (sc && (fread (sc, 1, hdr.size, f) != hdr.size
+		|| !S_SndCacheValid (sc, hdr.size)))
+		{
+			Cache_Free (&s->cache);
+			sc = NULL;
+		}
+	}
+	fclose (f);
+
+	if (sc)
+		snd_diskhits++;
+	return sc;
+}
+
+/*
+================
+S_WriteSndCache
+
+Runs on the converter thread, so it keeps to plain stdio and the settings
+the sound was converted with
+================
+*/
+static void S_WriteSndCache (sfx_t *s, int srclen, int speed, qboolean as8bit, sfxcache_t *sc, int size)
+{
+	char			path[MAX_OSPATH];
+	FILE			*f;
+	sndcachehdr_t	hdr;
+
+	if (!S_SndCachePath (s, path))
+		return;
+	COM_CreatePath (path);
+	f = fopen (path, "wb");
+	if (!f)
+		return;
+
+	hdr.ident = SNDCACHE_IDENT;
+	hdr.srclen = srclen;
+	hdr.speed = speed;
+	hdr.as8bit = as8bit;
+	hdr.size = size;
+	if (fwrite (&hdr, sizeof(hdr), 1, f) != 1 || fwrite (sc, 1, size, f) != size)
+	{
+		fclose (f);
+		remove (path);		// don't leave a short file behind
+		return;
+	}
+	fclose (f);
+}
+
+/*
+===============================================================================
+
+BACKGROUND CONVERSION
+
+The game thread reads the .wav and parses its header, then queues it.  A
+converter thread resamples it into malloced memory and writes it to the
+disk cache; S_FinishConversions, called every S_Update, copies finished
+sounds into the cache.  Jobs go through a ring: the game thread fills at
+snd_jobhead, the converter finishes them in order and advances
+snd_jobtail, and the game thread hands them over and frees the slot at
+snd_jobdone.  The converter thread only lives while there is work, and
+never looks at cvars or shm: the settings a job needs are copied into it
+when it is queued.
+
+===============================================================================
+*/
+
+#define	MAX_SNDJOBS		256		// power of 2
+
+typedef struct
+{
+	sfx_t		*sfx;
+	byte		*wav;		// whole .wav file, malloced
+	int			wavlen;
+	wavinfo_t	info;
+	int			speed;		// shm->speed when queued
+	qboolean	as8bit;		// loadas8bit when queued
+	qboolean	diskcache;	// snd_diskcache when queued
+	sfxcache_t	*sc;		// malloced by the converter
+	int			size;
+} sndjob_t;
+
+static sndjob_t		snd_jobs[MAX_SNDJOBS];
+static volatile int	snd_jobhead;
+static volatile int	snd_jobtail;
+static int			snd_jobdone;
+static volatile int	snd_converting;		// converter thread is running
+static qboolean		snd_threaded;		// conversions did run in the background
+static double		snd_convertstart;
+static int			snd_convertbatch;
+
+static void S_ConvertJob (sndjob_t *job)
+{
+	job->sc = ResampleSfx (&job->info, job->wav + job->info.dataofs,
+		job->speed, job->as8bit, &job->size);
+	if (job->sc && job->diskcache)
+		S_WriteSndCache (job->sfx, job->wavlen, job->speed, job->as8bit,
+			job->sc, job->size);
+}
+
+static void S_Converter (void *param)
+{
+	while (1)
+	{
+		while (snd_jobtail != snd_jobhead)
+		{
+			S_ConvertJob (&snd_jobs[snd_jobtail & (MAX_SNDJOBS-1)]);
+			__sync_synchronize ();
+			snd_jobtail++;
+		}
+
+	// only quit if nothing was queued after the check above
+		__sync_lock_release (&snd_converting);
+		__sync_synchronize ();
+		if (snd_jobtail == snd_jobhead
+		|| __sync_lock_test_and_set (&snd_converting, 1))
+			return;
+	}
+}
+
+/*
+================
+S_QueueConversion
+
+Takes ownership of wav.  If the converter can't be started the sound is
+converted on the spot.
+================
+*/
+static void S_QueueConversion (sfx_t *s, byte *wav, int wavlen, wavinfo_t *info)
+{
+	sndjob_t	*job;
+
+	if (snd_jobhead - snd_jobdone == MAX_SNDJOBS)
+		S_FinishConversions ();
+	if (snd_jobhead - snd_jobdone == MAX_SNDJOBS)
+	{	// the converter is far behind; do this one here
+		sndjob_t	local;
+
+		local.sfx = s;
+		local.wav = wav;
+		local.wavlen = wavlen;
+		local.info = *info;
+		local.speed = shm->speed;
+		local.as8bit = (loadas8bit.value != 0);
+		local.diskcache = (snd_diskcache.value != 0);
+		S_ConvertJob (&local);
+		if (local.sc)
+		{
+			Cache_Alloc (&s->cache, local.size, s->name);
+			if (s->cache.data)
+				memcpy (s->cache.data, local.sc, local.size);
+			free (local.sc);
+		}
+		free (wav);
+		snd_conversions++;
+		return;
+	}
+
+	job = &snd_jobs[snd_jobhead & (MAX_SNDJOBS-1)];
+	job->sfx = s;
+	job->wav = wav;
+	job->wavlen = wavlen;
+	job->info = *info;
+	job->speed = shm->speed;
+	job->as8bit = (loadas8bit.value != 0);
+	job->diskcache = (snd_diskcache.value != 0);
+	job->sc = NULL;
+	s->converting = true;
+	if (!snd_pending)
+	{
+		snd_convertstart = Sys_FloatTime ();
+		snd_convertbatch = 0;
+	}
+	snd_pending++;
+	snd_convertbatch++;
+	__sync_synchronize ();
+	snd_jobhead++;
+
+	if (!__sync_lock_test_and_set (&snd_converting, 1))
+	{
+		if (Sys_StartThread ("sndconv", S_Converter, NULL))
+			snd_threaded = true;
+		else
+			S_Converter (NULL);
+	}
+}
+
+/*
+================
+S_FinishConversions
+
+Moves converted sounds into the cache
+================
+*/
+void S_FinishConversions (void)
+{
+	sndjob_t	*job;
+	sfx_t		*s;
+	int			tail;
+
+	tail = snd_jobtail;
+	__sync_synchronize ();
+	if (snd_jobdone == tail)
+		return;
+
+	for ( ; snd_jobdone != tail ; snd_jobdone++)
+	{
+		job = &snd_jobs[snd_jobdone & (MAX_SNDJOBS-1)];
+		s = job->sfx;
+		if (job->sc)
+		{
+			if (!Cache_Check (&s->cache))
+			{
+				Cache_Alloc (&s->cache, job->size, s->name);
+				if (s->cache.data)
+					memcpy (s->cache.data, job->sc, job->size);
+			}
+			free (job->sc);
+		}
+		else
+			Con_Printf ("Couldn't convert %s\n", s->name);
+		free (job->wav);
+		s->converting = false;
+		snd_conversions++;
+		snd_pending--;
+	}
+
+	if (!snd_pending && snd_threaded)
+		Con_DPrintf ("converted %i sounds in the background in %.0f ms\n",
+			snd_convertbatch, (Sys_FloatTime () - snd_convertstart) * 1000);
 }
 
 //=============================================================================
@@ -100,55 +443,64 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	byte	*data;
 	wavinfo_t	info;
 	int		len;
-	float	stepscale;
 	sfxcache_t	*sc;
-	byte	stackbuf[1*1024];		// avoid dirtying the cache heap
+	FILE	*f;
+
+	S_FinishConversions ();
 
 // see if still in memory
 	sc = Cache_Check (&s->cache);
 	if (sc)
 		return sc;
 
-//Con_Printf ("S_LoadSound: %x\n", (int)stackbuf);
+// will be handed over once converted
+	if (s->converting)
+		return NULL;
+
 // load it in
     Q_strcpy(namebuffer, "sound/");
     Q_strcat(namebuffer, s->name);
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
-	data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
+	len = COM_FOpenFile (namebuffer, &f);
+	if (!f)
+	{
+		Con_Printf ("Couldn't load %s\n", namebuffer);
+		return NULL;
+	}
 
-	if (!data)
+// converted before?
+	sc = S_ReadSndCache (s, len);
+	if (sc)
 	{
+		fclose (f);
+		return sc;
+	}
+
+	data = malloc (len);
+	if (!data || fread (data, 1, len, f) != len)
+	{
+		fclose (f);
+		free (data);
 		Con_Printf ("Couldn't load %s\n", namebuffer);
 		return NULL;
 	}
+	fclose (f);
 
-	info = GetWavinfo (s->name, data, com_filesize);
+	info = GetWavinfo (s->name, data, len);
 	if (info.channels != 1)
 	{
 		Con_Printf ("%s is a stereo sample\n",s->name);
+		free (data);
 		return NULL;
 	}
 
-	stepscale = (float)info.rate / shm->speed;	
-	len = info.samples / stepscale;
-
-	len = len * info.width * info.channels;
+	S_QueueConversion (s, data, len, &info);
 
-	sc = Cache_Alloc ( &s->cache, len + sizeof(sfxcache_t), s->name);
-	if (!sc)
-		return NULL;
-	
-	sc->length = info.samples;
-	sc->loopstart = info.loopstart;
-	sc->speed = info.rate;
-	sc->width = info.width;
-	sc->stereo = info.channels;
-
-	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
-
-	return sc;
+// without a converter thread it is done already
+	S_FinishConversions ();
+	return Cache_Check (&s->cache);
 }
 
 
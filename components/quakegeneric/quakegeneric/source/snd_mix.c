@@ -22,6 +22,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "esp_attr.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define	SND_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define	SND_NEON
+#endif
+
 
 #define	PAINTBUFFER_SIZE	512
 EXT_RAM_BSS_ATTR portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
@@ -29,31 +37,376 @@ EXT_RAM_BSS_ATTR int		snd_scaletable[32][256];
 int 	*snd_p, snd_linear_count, snd_vol;
 short	*snd_out;
 
-void Snd_WriteLinearBlastStereo16 (void)
+cvar_t	snd_mixer = {"snd_mixer", "auto"};
+
+/*
+===============================================================================
+
+MIXING KERNELS
+
+Each set paints a channel into the paintbuffer and transfers the
+paintbuffer to 16 bit stereo output, and all of them produce exactly the
+same samples: 8 bit data is scaled by the volume rounded down to a
+multiple of 8, as snd_scaletable does, 16 bit data by (data * vol) >> 8,
+and the transfer saturates to 16 bits.
+
+"c" is the original table driven code.  "block" works on four samples
+at a time with plain multiplies, which keeps the scale table out of
+the inner loop; on targets where the table sits in external RAM that
+is the bulk of the win.  "sse2" and "neon" handle eight samples per
+step with saturating packs.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	char	*name;
+	void	(*paint8) (portable_samplepair_t *out, signed char *sfx, int count, int leftvol, int rightvol);
+	void	(*paint16) (portable_samplepair_t *out, short *sfx, int count, int leftvol, int rightvol);
+	void	(*transfer16) (short *out, int *in, int count, int vol);	// count is in shorts
+} sndkernels_t;
+
+static void SND_Paint8_C (portable_samplepair_t *out, signed char *sfx, int count, int leftvol, int rightvol)
+{
+	int		*lscale, *rscale;
+	int		i;
+
+	lscale = snd_scaletable[leftvol >> 3];
+	rscale = snd_scaletable[rightvol >> 3];
+
+	for (i=0 ; i<count ; i++)
+	{
+		out[i].left += lscale[(byte)sfx[i]];
+		out[i].right += rscale[(byte)sfx[i]];
+	}
+}
+
+static void SND_Paint16_C (portable_samplepair_t *out, short *sfx, int count, int leftvol, int rightvol)
+{
+	int		data;
+	int		i;
+
+	for (i=0 ; i<count ; i++)
+	{
+		data = sfx[i];
+		out[i].left += (data * leftvol) >> 8;
+		out[i].right += (data * rightvol) >> 8;
+	}
+}
+
+static void SND_Transfer16_C (short *out, int *in, int count, int vol)
 {
 	int		i;
 	int		val;
 
-	for (i=0 ; i<snd_linear_count ; i+=2)
+	for (i=0 ; i<count ; i++)
 	{
-		val = (snd_p[i]*snd_vol)>>8;
+		val = (in[i]*vol)>>8;
 		if (val > 0x7fff)
-			snd_out[i] = 0x7fff;
+			out[i] = 0x7fff;
 		else if (val < (short)0x8000)
-			snd_out[i] = (short)0x8000;
+			out[i] = (short)0x8000;
 		else
-			snd_out[i] = val;
+			out[i] = val;
+	}
+}
 
-		val = (snd_p[i+1]*snd_vol)>>8;
-		if (val > 0x7fff)
-			snd_out[i+1] = 0x7fff;
-		else if (val < (short)0x8000)
-			snd_out[i+1] = (short)0x8000;
-		else
-			snd_out[i+1] = val;
+static void SND_Paint8_Block (portable_samplepair_t *out, signed char *sfx, int count, int leftvol, int rightvol)
+{
+	int		i;
+	int		d0, d1, d2, d3;
+
+	leftvol &= ~7;
+	rightvol &= ~7;
+
+	for (i=0 ; i+4<=count ; i+=4)
+	{
+		d0 = sfx[i];
+		d1 = sfx[i+1];
+		d2 = sfx[i+2];
+		d3 = sfx[i+3];
+		out[i].left += d0 * leftvol;
+		out[i].right += d0 * rightvol;
+		out[i+1].left += d1 * leftvol;
+		out[i+1].right += d1 * rightvol;
+		out[i+2].left += d2 * leftvol;
+		out[i+2].right += d2 * rightvol;
+		out[i+3].left += d3 * leftvol;
+		out[i+3].right += d3 * rightvol;
+	}
+	for ( ; i<count ; i++)
+	{
+		out[i].left += sfx[i] * leftvol;
+		out[i].right += sfx[i] * rightvol;
+	}
+}
+
+static void SND_Paint16_Block (portable_samplepair_t *out, short *sfx, int count, int leftvol, int rightvol)
+{
+	int		i;
+	int		d0, d1, d2, d3;
+
+	for (i=0 ; i+4<=count ; i+=4)
+	{
+		d0 = sfx[i];
+		d1 = sfx[i+1];
+		d2 = sfx[i+2];
+		d3 = sfx[i+3];
+		out[i].left += (d0 * leftvol) >> 8;
+		out[i].right += (d0 * rightvol) >> 8;
+		out[i+1].left += (d1 * leftvol) >> 8;
+		out[i+1].right += (d1 * rightvol) >> 8;
+		out[i+2].left += (d2 * leftvol) >> 8;
+		out[i+2].right += (d2 * rightvol) >> 8;
+		out[i+3].left += (d3 * leftvol) >> 8;
+		out[i+3].right += (d3 * rightvol) >> 8;
+	}
+	for ( ; i<count ; i++)
+	{
+		out[i].left += (sfx[i] * leftvol) >> 8;
+		out[i].right += (sfx[i] * rightvol) >> 8;
+	}
+}
+
+static int SND_Clamp16 (int val)
+{
+	val = val > 0x7fff ? 0x7fff : val;
+	return val < -0x8000 ? -0x8000 : val;
+}
+
+static void SND_Transfer16_Block (short *out, int *in, int count, int vol)
+{
+	int		i;
+
+	for (i=0 ; i+4<=count ; i+=4)
+	{
+		out[i] = SND_Clamp16 ((in[i] * vol) >> 8);
+		out[i+1] = SND_Clamp16 ((in[i+1] * vol) >> 8);
+		out[i+2] = SND_Clamp16 ((in[i+2] * vol) >> 8);
+		out[i+3] = SND_Clamp16 ((in[i+3] * vol) >> 8);
+	}
+	for ( ; i<count ; i++)
+		out[i] = SND_Clamp16 ((in[i] * vol) >> 8);
+}
+
+#ifdef SND_SSE2
+/*
+	Adds eight 16 bit samples times the 16 bit volumes into eight
+	portable_samplepair_t, shifting the products down by shift.
+*/
+static void SND_MulAdd8_SSE2 (portable_samplepair_t *out, __m128i s, __m128i lv, __m128i rv, int shift)
+{
+	__m128i	lo, hi, l0, l1, r0, r1;
+	__m128i	*p;
+
+	lo = _mm_mullo_epi16 (s, lv);
+	hi = _mm_mulhi_epi16 (s, lv);
+	l0 = _mm_unpacklo_epi16 (lo, hi);
+	l1 = _mm_unpackhi_epi16 (lo, hi);
+	lo = _mm_mullo_epi16 (s, rv);
+	hi = _mm_mulhi_epi16 (s, rv);
+	r0 = _mm_unpacklo_epi16 (lo, hi);
+	r1 = _mm_unpackhi_epi16 (lo, hi);
+
+	if (shift)
+	{
+		l0 = _mm_srai_epi32 (l0, 8);
+		l1 = _mm_srai_epi32 (l1, 8);
+		r0 = _mm_srai_epi32 (r0, 8);
+		r1 = _mm_srai_epi32 (r1, 8);
+	}
+
+	p = (__m128i *)out;
+	_mm_storeu_si128 (p, _mm_add_epi32 (_mm_loadu_si128 (p), _mm_unpacklo_epi32 (l0, r0)));
+	_mm_storeu_si128 (p+1, _mm_add_epi32 (_mm_loadu_si128 (p+1), _mm_unpackhi_epi32 (l0, r0)));
+	_mm_storeu_si128 (p+2, _mm_add_epi32 (_mm_loadu_si128 (p+2), _mm_unpacklo_epi32 (l1, r1)));
+	_mm_storeu_si128 (p+3, _mm_add_epi32 (_mm_loadu_si128 (p+3), _mm_unpackhi_epi32 (l1, r1)));
+}
+
+static void SND_Paint8_SSE2 (portable_samplepair_t *out, signed char *sfx, int count, int leftvol, int rightvol)
+{
+	__m128i	lv, rv, s;
+	int		i;
+
+	leftvol &= ~7;
+	rightvol &= ~7;
+	lv = _mm_set1_epi16 (leftvol);
+	rv = _mm_set1_epi16 (rightvol);
+
+	for (i=0 ; i+8<=count ; i+=8)
+	{
+		s = _mm_loadl_epi64 ((__m128i *)(sfx + i));
+		s = _mm_srai_epi16 (_mm_unpacklo_epi8 (s, s), 8);	// sign extend
+		SND_MulAdd8_SSE2 (out + i, s, lv, rv, 0);
+	}
+	for ( ; i<count ; i++)
+	{
+		out[i].left += sfx[i] * leftvol;
+		out[i].right += sfx[i] * rightvol;
+	}
+}
+
+static void SND_Paint16_SSE2 (portable_samplepair_t *out, short *sfx, int count, int leftvol, int rightvol)
+{
+	__m128i	lv, rv;
+	int		i;
+
+	lv = _mm_set1_epi16 (leftvol);
+	rv = _mm_set1_epi16 (rightvol);
+
+	for (i=0 ; i+8<=count ; i+=8)
+		SND_MulAdd8_SSE2 (out + i, _mm_loadu_si128 ((__m128i *)(sfx + i)), lv, rv, 1);
+	for ( ; i<count ; i++)
+	{
+		out[i].left += (sfx[i] * leftvol) >> 8;
+		out[i].right += (sfx[i] * rightvol) >> 8;
+	}
+}
+
+/*
+	SSE2 has no 32 bit multiply, but the low halves of the unsigned
+	products are the signed ones.
+*/
+static __m128i SND_MulLo32_SSE2 (__m128i a, __m128i v)
+{
+	__m128i	even, odd;
+
+	even = _mm_mul_epu32 (a, v);
+	odd = _mm_mul_epu32 (_mm_srli_epi64 (a, 32), v);
+	return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0,0,2,0)),
+		_mm_shuffle_epi32 (odd, _MM_SHUFFLE (0,0,2,0)));
+}
+
+static void SND_Transfer16_SSE2 (short *out, int *in, int count, int vol)
+{
+	__m128i	v, a, b;
+	int		i;
+
+	v = _mm_set1_epi32 (vol);
+
+	for (i=0 ; i+8<=count ; i+=8)
+	{
+		a = _mm_srai_epi32 (SND_MulLo32_SSE2 (_mm_loadu_si128 ((__m128i *)(in + i)), v), 8);
+		b = _mm_srai_epi32 (SND_MulLo32_SSE2 (_mm_loadu_si128 ((__m128i *)(in + i + 4)), v), 8);
+		_mm_storeu_si128 ((__m128i *)(out + i), _mm_packs_epi32 (a, b));
+	}
+	for ( ; i<count ; i++)
+		out[i] = SND_Clamp16 ((in[i] * vol) >> 8);
+}
+#endif
+
+#ifdef SND_NEON
+static void SND_Paint8_NEON (portable_samplepair_t *out, signed char *sfx, int count, int leftvol, int rightvol)
+{
+	int16x8_t	s;
+	int32x4x2_t	p;
+	int			i;
+
+	leftvol &= ~7;
+	rightvol &= ~7;
+
+	for (i=0 ; i+8<=count ; i+=8)
+	{
+		s = vmovl_s8 (vld1_s8 ((int8_t *)sfx + i));
+
+		p = vld2q_s32 ((int32_t *)(out + i));
+		p.val[0] = vmlal_n_s16 (p.val[0], vget_low_s16 (s), leftvol);
+		p.val[1] = vmlal_n_s16 (p.val[1], vget_low_s16 (s), rightvol);
+		vst2q_s32 ((int32_t *)(out + i), p);
+
+		p = vld2q_s32 ((int32_t *)(out + i + 4));
+		p.val[0] = vmlal_n_s16 (p.val[0], vget_high_s16 (s), leftvol);
+		p.val[1] = vmlal_n_s16 (p.val[1], vget_high_s16 (s), rightvol);
+		vst2q_s32 ((int32_t *)(out + i + 4), p);
+	}
+	for ( ; i<count ; i++)
+	{
+		out[i].left += sfx[i] * leftvol;
+		out[i].right += sfx[i] * rightvol;
 	}
 }
 
+static void SND_Paint16_NEON (portable_samplepair_t *out, short *sfx, int count, int leftvol, int rightvol)
+{
+	int16x4_t	s;
+	int32x4x2_t	p;
+	int			i;
+
+	for (i=0 ; i+4<=count ; i+=4)
+	{
+		s = vld1_s16 (sfx + i);
+		p = vld2q_s32 ((int32_t *)(out + i));
+		p.val[0] = vaddq_s32 (p.val[0], vshrq_n_s32 (vmull_n_s16 (s, leftvol), 8));
+		p.val[1] = vaddq_s32 (p.val[1], vshrq_n_s32 (vmull_n_s16 (s, rightvol), 8));
+		vst2q_s32 ((int32_t *)(out + i), p);
+	}
+	for ( ; i<count ; i++)
+	{
+		out[i].left += (sfx[i] * leftvol) >> 8;
+		out[i].right += (sfx[i] * rightvol) >> 8;
+	}
+}
+
+static void SND_Transfer16_NEON (short *out, int *in, int count, int vol)
+{
+	int32x4_t	a, b;
+	int			i;
+
+	for (i=0 ; i+8<=count ; i+=8)
+	{
+		a = vshrq_n_s32 (vmulq_n_s32 (vld1q_s32 (in + i), vol), 8);
+		b = vshrq_n_s32 (vmulq_n_s32 (vld1q_s32 (in + i + 4), vol), 8);
+		vst1q_s16 (out + i, vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b)));
+	}
+	for ( ; i<count ; i++)
+		out[i] = SND_Clamp16 ((in[i] * vol) >> 8);
+}
+#endif
+
+static sndkernels_t	snd_kernels[] =
+{
+	{"c", SND_Paint8_C, SND_Paint16_C, SND_Transfer16_C},
+	{"block", SND_Paint8_Block, SND_Paint16_Block, SND_Transfer16_Block},
+#ifdef SND_SSE2
+	{"sse2", SND_Paint8_SSE2, SND_Paint16_SSE2, SND_Transfer16_SSE2},
+#endif
+#ifdef SND_NEON
+	{"neon", SND_Paint8_NEON, SND_Paint16_NEON, SND_Transfer16_NEON},
+#endif
+};
+
+#define	NUM_SNDKERNELS	(sizeof(snd_kernels) / sizeof(snd_kernels[0]))
+
+static sndkernels_t	*snd_kernel = &snd_kernels[NUM_SNDKERNELS - 1];
+static char			snd_kernelname[32] = "auto";
+
+/*
+================
+SND_SelectKernels
+
+Follows snd_mixer; "auto" or an unknown name picks the last, fastest set.
+================
+*/
+static void SND_SelectKernels (void)
+{
+	int		i;
+
+	if (!Q_strcmp (snd_mixer.string, snd_kernelname))
+		return;
+	Q_strncpy (snd_kernelname, snd_mixer.string, sizeof(snd_kernelname) - 1);
+
+	snd_kernel = &snd_kernels[NUM_SNDKERNELS - 1];
+	for (i=0 ; i<NUM_SNDKERNELS ; i++)
+		if (!Q_strcmp (snd_mixer.string, snd_kernels[i].name))
+			snd_kernel = &snd_kernels[i];
+}
+
+void Snd_WriteLinearBlastStereo16 (void)
+{
+	snd_kernel->transfer16 (snd_out, snd_p, snd_linear_count, snd_vol);
+}
+
 
 void S_TransferStereo16 (int endtime)
 {
@@ -150,6 +503,97 @@ void S_TransferPaintBuffer(int endtime)
 }
 
 
+/*
+===============================================================================
+
+MUSIC STREAM
+
+===============================================================================
+*/
+
+#define	MUSICBUF_FRAMES		(PAINTBUFFER_SIZE*2)
+
+static sndstream_t	snd_music;
+static int			snd_musicrate;
+static int			snd_musicfrac;		// 16.16 position within the next input frame
+EXT_RAM_BSS_ATTR static short	snd_musicbuf[MUSICBUF_FRAMES*2];
+
+void S_SetMusicStream (sndstream_t stream, int rate)
+{
+	snd_music = stream;
+	snd_musicrate = rate;
+	snd_musicfrac = 0;
+}
+
+/*
+================
+S_PaintMusic
+
+Adds count frames of the music stream to the paintbuffer, stepping
+through it the way ResampleSfx does when the rates differ.  A stream
+that runs dry is padded with silence rather than waited for.
+================
+*/
+static void S_PaintMusic (int count)
+{
+	portable_samplepair_t	*out;
+	int		step, chunk, frames, got;
+	int		i, pos, last, gain;
+
+	if (!snd_music || !shm)
+		return;
+
+	gain = bgmvolume.value * 256;
+	step = (double)snd_musicrate * 0x10000 / shm->speed;
+	if (step < 1 || step > 0x40000)
+		return;		// rates more than 4 to 1 apart are not supported
+	out = paintbuffer;
+
+	while (count > 0)
+	{
+		chunk = count;
+		if ((chunk * step + snd_musicfrac) >> 16 > MUSICBUF_FRAMES)
+			chunk = ((MUSICBUF_FRAMES << 16) - snd_musicfrac) / step;
+
+		frames = (snd_musicfrac + chunk * step) >> 16;
+		got = snd_music (snd_musicbuf, frames);
+		if (got < frames)
+			Q_memset (snd_musicbuf + got*2, 0, (frames - got) * 2 * sizeof(short));
+
+	// a chunk too short to finish an input frame reads nothing, and has
+	// nothing to step through
+		if (gain && frames)
+		{
+			if (step == 0x10000)
+			{
+				for (i=0 ; i<chunk ; i++)
+				{
+					out[i].left += (snd_musicbuf[i*2] * gain) >> 8;
+					out[i].right += (snd_musicbuf[i*2+1] * gain) >> 8;
+				}
+			}
+			else
+			{
+			// when upsampling the last output samples can land on the frame
+			// after the ones read, which is only fetched with the next chunk
+				last = frames - 1;
+				for (i=0 ; i<chunk ; i++)
+				{
+					pos = (snd_musicfrac + i * step) >> 16;
+					if (pos > last)
+						pos = last;
+					out[i].left += (snd_musicbuf[pos*2] * gain) >> 8;
+					out[i].right += (snd_musicbuf[pos*2+1] * gain) >> 8;
+				}
+			}
+		}
+
+		snd_musicfrac = (snd_musicfrac + chunk * step) & 0xffff;
+		out += chunk;
+		count -= chunk;
+	}
+}
+
 /*
 ===============================================================================
 
@@ -158,8 +602,8 @@ CHANNEL MIXING
 ===============================================================================
 */
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime);
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime);
+void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int offset);
+void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int offset);
 
 void S_PaintChannels(int endtime)
 {
@@ -169,6 +613,8 @@ void S_PaintChannels(int endtime)
 	sfxcache_t	*sc;
 	int		ltime, count;
 
+	SND_SelectKernels ();
+
 	while (paintedtime < endtime)
 	{
 	// if paintbuffer is smaller than DMA buffer
@@ -203,9 +649,9 @@ void S_PaintChannels(int endtime)
 				if (count > 0)
 				{	
 					if (sc->width == 1)
-						SND_PaintChannelFrom8(ch, sc, count);
+						SND_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
 					else
-						SND_PaintChannelFrom16(ch, sc, count);
+						SND_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
 	
 					ltime += count;
 				}
@@ -228,6 +674,9 @@ void S_PaintChannels(int endtime)
 															  
 		}
 
+	// the music stream goes in last, once per sample
+		S_PaintMusic (end - paintedtime);
+
 	// transfer out according to DMA format
 		S_TransferPaintBuffer(end);
 		paintedtime = end;
@@ -243,55 +692,122 @@ void SND_InitScaletable (void)
 			snd_scaletable[i][j] = ((signed char)j) * i * 8;
 }
 
+/*
+===============================================================================
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count)
-{
-	int 	data;
-	int		*lscale, *rscale;
-	unsigned char *sfx;
-	int		i;
+MIXER BENCHMARK
 
-	if (ch->leftvol > 255)
-		ch->leftvol = 255;
-	if (ch->rightvol > 255)
-		ch->rightvol = 255;
-		
-	lscale = snd_scaletable[ch->leftvol >> 3];
-	rscale = snd_scaletable[ch->rightvol >> 3];
-	sfx = (signed char *)sc->data + ch->pos;
+===============================================================================
+*/
 
-	for (i=0 ; i<count ; i++)
+#define	BENCH_SAMPLES	PAINTBUFFER_SIZE
+
+EXT_RAM_BSS_ATTR static signed char	bench_sfx8[BENCH_SAMPLES];
+EXT_RAM_BSS_ATTR static short		bench_sfx16[BENCH_SAMPLES];
+EXT_RAM_BSS_ATTR static short		bench_out[BENCH_SAMPLES*2];
+
+/*
+================
+SND_MixBenchPass
+
+Returns a hash of the paintbuffer and the transferred output.
+================
+*/
+static unsigned SND_MixBenchPass (sndkernels_t *k, int channels, int passes, double *seconds)
+{
+	int			i, c, lv, rv;
+	double		start;
+	unsigned	hash;
+
+	start = Sys_FloatTime ();
+	for (i=0 ; i<passes ; i++)
 	{
-		data = sfx[i];
-		paintbuffer[i].left += lscale[data];
-		paintbuffer[i].right += rscale[data];
+		Q_memset (paintbuffer, 0, sizeof(paintbuffer));
+		for (c=0 ; c<channels ; c++)
+		{
+			lv = (c * 37) & 255;
+			rv = 255 - lv;
+			if (c & 1)
+				k->paint16 (paintbuffer, bench_sfx16, BENCH_SAMPLES, lv, rv);
+			else
+				k->paint8 (paintbuffer, bench_sfx8, BENCH_SAMPLES, lv, rv);
+		}
+		k->transfer16 (bench_out, (int *)paintbuffer, BENCH_SAMPLES*2, 179);
 	}
-	
-	ch->pos += count;
+	*seconds = (Sys_FloatTime () - start) / passes;
+
+	hash = 0;
+	for (i=0 ; i<BENCH_SAMPLES ; i++)
+		hash = hash * 31 + paintbuffer[i].left * 7 + paintbuffer[i].right;
+	for (i=0 ; i<BENCH_SAMPLES*2 ; i++)
+		hash = hash * 31 + bench_out[i];
+	return hash;
 }
 
+/*
+================
+SND_MixBench_f
 
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count)
+snd_mixbench [channels] [passes]
+Paints a paintbuffer's worth of 8 and 16 bit channels and transfers it
+with every kernel set, checking each against the table driven code.
+================
+*/
+static void SND_MixBench_f (void)
 {
-	int data;
-	int left, right;
-	int leftvol, rightvol;
-	signed short *sfx;
-	int	i;
+	int			i, channels, passes, speed;
+	unsigned	seed, reference, hash;
+	double		seconds;
+
+	channels = Cmd_Argc () > 1 ? Q_atoi (Cmd_Argv (1)) : MAX_CHANNELS;
+	passes = Cmd_Argc () > 2 ? Q_atoi (Cmd_Argv (2)) : 100;
+	if (passes < 1)
+		passes = 1;
+	speed = shm ? shm->speed : 11025;
+
+	seed = 1;
+	for (i=0 ; i<BENCH_SAMPLES ; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		bench_sfx16[i] = (seed >> 8) & 0xffff;
+		bench_sfx8[i] = bench_sfx16[i] >> 8;
+	}
 
-	leftvol = ch->leftvol;
-	rightvol = ch->rightvol;
-	sfx = (signed short *)sc->data + ch->pos;
+	Con_Printf ("%i channels, %i samples, %i passes\n", channels, BENCH_SAMPLES, passes);
 
-	for (i=0 ; i<count ; i++)
+	reference = SND_MixBenchPass (&snd_kernels[0], channels, 1, &seconds);
+	for (i=0 ; i<NUM_SNDKERNELS ; i++)
 	{
-		data = sfx[i];
-		left = (data * leftvol) >> 8;
-		right = (data * rightvol) >> 8;
-		paintbuffer[i].left += left;
-		paintbuffer[i].right += right;
+		hash = SND_MixBenchPass (&snd_kernels[i], channels, passes, &seconds);
+		Con_Printf ("%-6s %7.3f ms per pass, %5.1f%% of realtime%s\n", snd_kernels[i].name,
+			seconds * 1000, seconds * speed * 100 / BENCH_SAMPLES,
+			hash == reference ? "" : "  MISMATCH");
 	}
+	Con_Printf ("snd_mixer is using %s\n", snd_kernel->name);
+}
 
+void SND_InitMixer (void)
+{
+	Cvar_RegisterVariable (&snd_mixer);
+	Cmd_AddCommand ("snd_mixbench", SND_MixBench_f);
+	SND_InitScaletable ();
+}
+
+
+void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int offset)
+{
+	if (ch->leftvol > 255)
+		ch->leftvol = 255;
+	if (ch->rightvol > 255)
+		ch->rightvol = 255;
+
+	snd_kernel->paint8 (paintbuffer + offset, (signed char *)sc->data + ch->pos, count, ch->leftvol, ch->rightvol);
 	ch->pos += count;
 }
 
+
+void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int offset)
+{
+	snd_kernel->paint16 (paintbuffer + offset, (short *)sc->data + ch->pos, count, ch->leftvol, ch->rightvol);
+	ch->pos += count;
+}
@@ -0,0 +1,142 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_sim.c -- simulated sound device for hosts without one
+
+/*
+
+The simulated device plays from the DMA buffer in real time but, like a
+real one, only reports its position at chunk boundaries, and the news
+arrives late by a random amount up to snd_simjitter milliseconds.  It
+knows exactly what it has played, so it can count true underruns: every
+time it plays samples the mixer had not painted yet.  That makes it a
+bench for the mixahead logic in snd_dma.c.
+
+*/
+
+#include "quakedef.h"
+
+#define	SIM_SAMPLES		16384		// mono samples, power of 2
+
+cvar_t	snd_simchunk = {"snd_simchunk", "256"};		// frames per position report
+cvar_t	snd_simjitter = {"snd_simjitter", "0"};		// ms of reporting lateness
+
+static short	sim_buffer[SIM_SAMPLES];
+static double	sim_starttime;
+static int		sim_reported;		// frames
+static int		sim_underruns;
+static int		sim_starved;		// frames played unpainted
+static int		sim_lastgap;		// end of the last underrun counted
+static qboolean	sim_painting;		// the mixer has started
+static qboolean	sim_registered;		// S_Startup may init the device again
+
+static int SNDDMA_SimPlayed (double time)
+{
+	return (time - sim_starttime) * shm->speed;
+}
+
+static void SNDDMA_SimStats_f (void)
+{
+	Con_Printf ("%i underruns, %i frames played unpainted\n", sim_underruns, sim_starved);
+	Con_Printf ("chunk %i frames, jitter %.1f ms\n", (int)snd_simchunk.value, snd_simjitter.value);
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+		sim_underruns = sim_starved = 0;
+}
+
+qboolean SNDDMA_Init (void)
+{
+	if (!sim_registered)
+	{
+		Cvar_RegisterVariable (&snd_simchunk);
+		Cvar_RegisterVariable (&snd_simjitter);
+		Cmd_AddCommand ("snd_simstats", SNDDMA_SimStats_f);
+		sim_registered = true;
+	}
+
+	shm = &sn;
+	shm->splitbuffer = 0;
+	shm->speed = 22050;
+	shm->samplebits = 16;
+	shm->channels = 2;
+	shm->soundalive = true;
+	shm->gamealive = true;
+	shm->samples = SIM_SAMPLES;
+	shm->samplepos = 0;
+	shm->submission_chunk = snd_simchunk.value * shm->channels;
+	shm->buffer = (unsigned char *)sim_buffer;
+
+	sim_starttime = Sys_FloatTime ();
+	sim_reported = 0;
+	sim_painting = false;
+
+	Con_Printf ("simulated 16 bit stereo sound\n");
+	return true;
+}
+
+int SNDDMA_GetDMAPos (void)
+{
+	double	now;
+	int		played, reported, chunk, jitter;
+
+	now = Sys_FloatTime ();
+	played = SNDDMA_SimPlayed (now);
+
+	// the mixer has to have painted everything played so far
+	if (sim_painting && played > paintedtime && played > sim_lastgap)
+	{
+		if (paintedtime >= sim_lastgap)
+			sim_underruns++;
+		sim_starved += played - (paintedtime > sim_lastgap ? paintedtime : sim_lastgap);
+		sim_lastgap = played;
+	}
+
+	chunk = snd_simchunk.value;
+	if (chunk < 1)
+		chunk = 1;
+	jitter = snd_simjitter.value * 0.001 * shm->speed;
+	if (jitter < 0)
+		jitter = 0;
+
+	// the play position can be a chunk and the reporting lateness past
+	// what was reported, so that much is as good as taken
+	shm->submission_chunk = (chunk + jitter) * shm->channels;
+
+	reported = SNDDMA_SimPlayed (now - snd_simjitter.value * 0.001 * rand () / RAND_MAX);
+	reported -= reported % chunk;
+	if (reported < sim_reported)
+		reported = sim_reported;
+	sim_reported = reported;
+
+	shm->samplepos = (reported * shm->channels) & (shm->samples - 1);
+	return shm->samplepos;
+}
+
+void SNDDMA_Shutdown (void)
+{
+}
+
+void SNDDMA_Submit (void)
+{
+	if (!sim_painting)
+	{
+		sim_painting = true;
+		sim_lastgap = paintedtime;
+	}
+}
@@ -36,6 +36,7 @@ typedef struct sfx_s
 {
 	char 	name[MAX_QPATH];
 	cache_user_t	cache;
+	qboolean	converting;		// queued for the background converter
 } sfx_t;
 
 // !!! if this is changed, it much be changed in asm_i386.h too !!!
@@ -56,7 +57,7 @@ typedef struct
 	qboolean		splitbuffer;
 	int				channels;
 	int				samples;				// mono samples in buffer
-	int				submission_chunk;		// don't mix less than this #
+	int				submission_chunk;		// mono samples the device reads ahead of samplepos
 	int				samplepos;				// in mono samples
 	int				samplebits;
 	int				speed;
@@ -77,6 +78,8 @@ typedef struct
 	vec3_t	origin;			// origin of sound effect
 	vec_t	dist_mult;		// distance multiplier (attenuation/clipK)
 	int		master_vol;		// 0-255 master volume
+	int		spatialleft;	// leftvol/rightvol as last spatialized, before
+	int		spatialright;	// static sounds are combined and voices culled
 } channel_t;
 
 typedef struct
@@ -108,6 +111,12 @@ void S_EndPrecaching (void);
 void S_PaintChannels(int endtime);
 void S_InitPaintChannels (void);
 
+// music is pulled from a stream while the channels are painted, at
+// bgmvolume.  The callback fills up to count interleaved 16 bit stereo
+// frames and returns how many it had; it must not block.
+typedef int (*sndstream_t) (short *samples, int count);
+void S_SetMusicStream (sndstream_t stream, int rate);
+
 // picks a channel based on priorities, empty slots, number of channels
 channel_t *SND_PickChannel(int entnum, int entchannel);
 
@@ -166,9 +175,19 @@ extern int		snd_blocked;
 void S_LocalSound (char *s);
 sfxcache_t *S_LoadSound (sfx_t *s);
 
+// sounds missing from the cache are converted on a background thread and
+// handed over from S_Update; S_LoadSound returns NULL for them until then
+void S_FinishConversions (void);
+
+extern	cvar_t snd_diskcache;
+extern	int		snd_diskhits;		// sounds read back from sndcache/
+extern	int		snd_conversions;	// sounds converted from .wav
+extern	int		snd_pending;		// conversions not handed over yet
+
 wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength);
 
 void SND_InitScaletable (void);
+void SND_InitMixer (void);
 void SNDDMA_Submit(void);
 
 void S_AmbientOff (void);
@@ -27,6 +27,8 @@ server_static_t	svs;
 
 char	localmodels[MAX_MODELS][5];			// inline model names for precache
 
+cvar_t	sv_parallelsend = {"sv_parallelsend", "1"};
+
 //============================================================================
 
 /*
@@ -58,6 +60,7 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
+	Cvar_RegisterVariable (&sv_parallelsend);
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -362,10 +365,11 @@ crosses a waterline.
 =============================================================================
 */
 
-int		fatbytes;
 byte	fatpvs[MAX_MAP_LEAFS/8];
+byte	fatvis[MAX_MAP_LEAFS/8];
 
-void SV_AddToFatPVS (vec3_t org, mnode_t *node)
+void SV_AddToFatPVS (vec3_t org, mnode_t *node, byte *pvsbuf, byte *visbuf,
+	int fatbytes)
 {
 	int		i;
 	byte	*pvs;
@@ -379,9 +383,9 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
+				pvs = Mod_LeafPVSTo ( (mleaf_t *)node, sv.worldmodel, visbuf);
 				for (i=0 ; i<fatbytes ; i++)
-					fatpvs[i] |= pvs[i];
+					pvsbuf[i] |= pvs[i];
 			}
 			return;
 		}
@@ -394,7 +398,7 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0]);
+			SV_AddToFatPVS (org, node->children[0], pvsbuf, visbuf, fatbytes);
 			node = node->children[1];
 		}
 	}
@@ -405,15 +409,19 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  The result is built in pvsbuf and each leaf's vis is
+decompressed into visbuf; both must hold MAX_MAP_LEAFS/8 bytes, so parallel
+callers can each pass their own.
 =============
 */
-byte *SV_FatPVS (vec3_t org)
+byte *SV_FatPVS (vec3_t org, byte *pvsbuf, byte *visbuf)
 {
+	int		fatbytes;
+
 	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	Q_memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+	Q_memset (pvsbuf, 0, fatbytes);
+	SV_AddToFatPVS (org, sv.worldmodel->nodes, pvsbuf, visbuf, fatbytes);
+	return pvsbuf;
 }
 
 //=============================================================================
@@ -423,9 +431,13 @@ byte *SV_FatPVS (vec3_t org)
 =============
 SV_WriteEntitiesToClient
 
+Only reads the world, so it may run on a worker thread as long as each
+caller passes its own pvs and vis scratch buffers.  Running out of room sets
+msg->overflowed instead of printing.
 =============
 */
-void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
+void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg, byte *pvsbuf,
+	byte *visbuf)
 {
 	int		e, i;
 	int		bits;
@@ -436,7 +448,7 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 
 // find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org);
+	pvs = SV_FatPVS (org, pvsbuf, visbuf);
 
 // send over all entities (excpet the client) that touch the pvs
 	ent = NEXT_EDICT(sv.edicts);
@@ -460,7 +472,7 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 
 		if (msg->maxsize - msg->cursize < 16)
 		{
-			Con_Printf ("packet overflow\n");
+			msg->overflowed = true;
 			return;
 		}
 
@@ -702,6 +714,92 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 	}
 }
 
+/*
+=============================================================================
+
+PARALLEL DATAGRAM BUILDING
+
+The entity part of each client's datagram is by far the most expensive
+part of a server frame and only reads the world, so it is built for all
+clients at once on the worker threads.  Each worker packs the messages it
+builds one after another into its own buffer; the rest of the datagram
+and the actual sends stay serial in SV_SendClientDatagram.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	byte		*data;			// points into a worker buffer
+	int			cursize;
+	qboolean	built;			// false = build serially when sending
+} sv_entitymsg_t;
+
+static sv_entitymsg_t	sv_entitymsgs[MAX_SCOREBOARD];
+static int				sv_workerused[MAX_WORKERS];
+static byte				sv_workerpvs[MAX_WORKERS][MAX_MAP_LEAFS/8];
+static byte				sv_workervis[MAX_WORKERS][MAX_MAP_LEAFS/8];
+EXT_RAM_BSS_ATTR static byte	sv_workerbuf[MAX_WORKERS][MAX_DATAGRAM];
+
+/*
+=============
+SV_BuildEntitiesJob
+
+Worker job: write the entity updates for client number job.
+=============
+*/
+static void SV_BuildEntitiesJob (int job, int worker)
+{
+	client_t		*client;
+	sizebuf_t		msg;
+	sv_entitymsg_t	*em;
+
+	client = svs.clients + job;
+	if (!client->active || !client->spawned)
+		return;
+
+	em = &sv_entitymsgs[job];
+	msg.data = sv_workerbuf[worker] + sv_workerused[worker];
+	msg.maxsize = MAX_DATAGRAM - sv_workerused[worker];
+	msg.cursize = 0;
+	msg.allowoverflow = false;
+	msg.overflowed = false;
+
+	SV_WriteEntitiesToClient (client->edict, &msg, sv_workerpvs[worker],
+			sv_workervis[worker]);
+
+// if the worker buffer filled up, leave it to the serial path, which has
+// a full datagram to itself and reports the overflow if it still happens
+	if (msg.overflowed)
+		return;
+
+	em->data = msg.data;
+	em->cursize = msg.cursize;
+	em->built = true;
+	sv_workerused[worker] += msg.cursize;
+}
+
+/*
+=============
+SV_BuildEntityMessages
+=============
+*/
+static void SV_BuildEntityMessages (void)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_SCOREBOARD ; i++)
+		sv_entitymsgs[i].built = false;
+
+	if (!sv_parallelsend.value || svs.maxclients < 2 || Sys_NumWorkers () < 2)
+		return;
+
+	for (i=0 ; i<MAX_WORKERS ; i++)
+		sv_workerused[i] = 0;
+
+	Sys_RunJobs (SV_BuildEntitiesJob, svs.maxclients);
+}
+
 /*
 =======================
 SV_SendClientDatagram
@@ -711,10 +809,13 @@ qboolean SV_SendClientDatagram (client_t *client)
 {
 	byte		buf[MAX_DATAGRAM];
 	sizebuf_t	msg;
+	sv_entitymsg_t	*em;
 	
 	msg.data = buf;
 	msg.maxsize = sizeof(buf);
 	msg.cursize = 0;
+	msg.allowoverflow = false;
+	msg.overflowed = false;
 
 	MSG_WriteByte (&msg, svc_time);
 	MSG_WriteFloat (&msg, sv.time);
@@ -722,7 +823,19 @@ qboolean SV_SendClientDatagram (client_t *client)
 // add the client specific data to the datagram
 	SV_WriteClientdataToMessage (client->edict, &msg);
 
-	SV_WriteEntitiesToClient (client->edict, &msg);
+// use the entity updates built by the workers if they fit, otherwise
+// build them here
+	em = &sv_entitymsgs[client - svs.clients];
+	if (em->built && msg.cursize + em->cursize <= msg.maxsize - 16)
+		SZ_Write (&msg, em->data, em->cursize);
+	else
+		SV_WriteEntitiesToClient (client->edict, &msg, fatpvs, fatvis);
+
+	if (msg.overflowed)
+	{
+		Con_Printf ("packet overflow\n");
+		msg.overflowed = false;
+	}
 
 // copy the server datagram if there is space
 	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
@@ -813,6 +926,9 @@ void SV_SendClientMessages (void)
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
+// build the entity updates for all clients in parallel
+	SV_BuildEntityMessages ();
+
 // build individual updates
 	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
 	{
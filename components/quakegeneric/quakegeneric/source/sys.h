@@ -65,6 +65,38 @@ void Sys_Sleep (void);
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
+//
+// worker threads
+//
+#define	MAX_WORKERS		4
+
+typedef void (*sys_jobfunc_t) (int job, int worker);
+
+int Sys_NumWorkers (void);
+// number of threads Sys_RunJobs spreads work over, including the caller
+
+void Sys_RunJobs (sys_jobfunc_t func, int numjobs);
+// calls func once for every job number in [0, numjobs), spread over the
+// calling thread and the worker threads, and returns once all are done.
+// worker is in [0, Sys_NumWorkers()) and is 0 for the calling thread, so
+// it can be used to index per-worker scratch buffers
+
+typedef void (*sys_threadfunc_t) (void *param);
+
+qboolean Sys_StartThread (char *name, sys_threadfunc_t func, void *param);
+// runs func (param) on a new low priority thread that goes away when func
+// returns.  Returns false if there are no threads, in which case the caller
+// has to do the work itself
+
+//
+// memory tiers
+//
+void *Sys_TierAlloc (int size, int tier);
+// returns zero filled memory of the given memtier_t, or NULL if the
+// platform can't spare it.  Platforms without fast on-chip memory hand out
+// ordinary memory for both tiers
+void Sys_TierFree (void *ptr);
+
 void Sys_LowFPPrecision (void);
 void Sys_HighFPPrecision (void);
 void Sys_SetFPCW (void);
@@ -24,6 +24,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <sys/stat.h>
 #include <sys/time.h>
 
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#define SYS_THREADS
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#define SYS_THREADS
+#endif
+
 qboolean isDedicated;
 
 /*
@@ -221,6 +233,305 @@ void Sys_LowFPPrecision (void)
 {
 }
 
+/*
+===============================================================================
+
+WORKER THREADS
+
+On the target the spare core runs one extra FreeRTOS task, on the host a
+small pthread pool is used.  Jobs are handed out through a shared counter,
+so the caller always takes part and an idle pool costs nothing.
+
+===============================================================================
+*/
+
+static int				sys_numworkers;
+
+#ifdef SYS_THREADS
+static sys_jobfunc_t	sys_jobfunc;
+static int				sys_numjobs;
+static volatile int		sys_nextjob;
+
+static void Sys_DoJobs (int worker)
+{
+	int		job;
+
+	while ((job = __sync_fetch_and_add (&sys_nextjob, 1)) < sys_numjobs)
+		sys_jobfunc (job, worker);
+}
+#endif
+
+#if defined(ESP_PLATFORM)
+
+#define	WORKER_STACK	(16*1024)
+#define	WORKER_CORE		1
+#define	WORKER_PRIO		2
+
+static TaskHandle_t			sys_workertasks[MAX_WORKERS];
+static SemaphoreHandle_t	sys_jobsdone;
+
+static void Sys_WorkerTask (void *param)
+{
+	int		worker = (int)(intptr_t)param;
+
+	while (1)
+	{
+		ulTaskNotifyTake (pdTRUE, portMAX_DELAY);
+		Sys_DoJobs (worker);
+		xSemaphoreGive (sys_jobsdone);
+	}
+}
+
+static void Sys_InitWorkers (void)
+{
+	int		i;
+
+	sys_numworkers = 2;
+	sys_jobsdone = xSemaphoreCreateCounting (MAX_WORKERS, 0);
+	for (i=1 ; i<sys_numworkers ; i++)
+		xTaskCreatePinnedToCore (Sys_WorkerTask, "qworker", WORKER_STACK,
+			(void *)(intptr_t)i, WORKER_PRIO, &sys_workertasks[i], WORKER_CORE);
+}
+
+static void Sys_StartWorkers (void)
+{
+	int		i;
+
+	for (i=1 ; i<sys_numworkers ; i++)
+		xTaskNotifyGive (sys_workertasks[i]);
+}
+
+static void Sys_WaitWorkers (void)
+{
+	int		i;
+
+	for (i=1 ; i<sys_numworkers ; i++)
+		xSemaphoreTake (sys_jobsdone, portMAX_DELAY);
+}
+
+#elif defined(SYS_THREADS)
+
+static pthread_mutex_t	sys_jobmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	sys_jobstart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	sys_jobend = PTHREAD_COND_INITIALIZER;
+static int				sys_jobgeneration;
+static int				sys_busyworkers;
+
+static void *Sys_WorkerThread (void *param)
+{
+	int		worker = (int)(intptr_t)param;
+	int		generation = 0;
+
+	while (1)
+	{
+		pthread_mutex_lock (&sys_jobmutex);
+		while (sys_jobgeneration == generation)
+			pthread_cond_wait (&sys_jobstart, &sys_jobmutex);
+		generation = sys_jobgeneration;
+		pthread_mutex_unlock (&sys_jobmutex);
+
+		Sys_DoJobs (worker);
+
+		pthread_mutex_lock (&sys_jobmutex);
+		if (--sys_busyworkers == 0)
+			pthread_cond_signal (&sys_jobend);
+		pthread_mutex_unlock (&sys_jobmutex);
+	}
+	return NULL;
+}
+
+static void Sys_InitWorkers (void)
+{
+	int			i;
+	long		cpus;
+	pthread_t	thread;
+
+	cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+	if (cpus > MAX_WORKERS)
+		cpus = MAX_WORKERS;
+
+	sys_numworkers = 1;
+	for (i=1 ; i<cpus ; i++)
+	{
+		if (pthread_create (&thread, NULL, Sys_WorkerThread, (void *)(intptr_t)i))
+			break;
+		pthread_detach (thread);
+		sys_numworkers++;
+	}
+}
+
+static void Sys_StartWorkers (void)
+{
+	pthread_mutex_lock (&sys_jobmutex);
+	sys_busyworkers = sys_numworkers - 1;
+	sys_jobgeneration++;
+	pthread_cond_broadcast (&sys_jobstart);
+	pthread_mutex_unlock (&sys_jobmutex);
+}
+
+static void Sys_WaitWorkers (void)
+{
+	pthread_mutex_lock (&sys_jobmutex);
+	while (sys_busyworkers)
+		pthread_cond_wait (&sys_jobend, &sys_jobmutex);
+	pthread_mutex_unlock (&sys_jobmutex);
+}
+
+#else
+
+static void Sys_InitWorkers (void)
+{
+	sys_numworkers = 1;
+}
+
+#endif
+
+typedef struct
+{
+	sys_threadfunc_t	func;
+	void				*param;
+} sys_thread_t;
+
+#if defined(ESP_PLATFORM)
+
+#define	THREAD_STACK	(8*1024)
+#define	THREAD_PRIO		1		// below the quake task
+
+static void Sys_ThreadTask (void *param)
+{
+	sys_thread_t	t = *(sys_thread_t *)param;
+
+	free (param);
+	t.func (t.param);
+	vTaskDelete (NULL);
+}
+
+qboolean Sys_StartThread (char *name, sys_threadfunc_t func, void *param)
+{
+	sys_thread_t	*t;
+
+	t = malloc (sizeof(*t));
+	if (!t)
+		return false;
+	t->func = func;
+	t->param = param;
+	if (xTaskCreatePinnedToCore (Sys_ThreadTask, name, THREAD_STACK, t,
+		THREAD_PRIO, NULL, WORKER_CORE) != pdPASS)
+	{
+		free (t);
+		return false;
+	}
+	return true;
+}
+
+#elif defined(SYS_THREADS)
+
+static void *Sys_ThreadMain (void *param)
+{
+	sys_thread_t	t = *(sys_thread_t *)param;
+
+	free (param);
+	t.func (t.param);
+	return NULL;
+}
+
+qboolean Sys_StartThread (char *name, sys_threadfunc_t func, void *param)
+{
+	sys_thread_t	*t;
+	pthread_t		thread;
+
+	t = malloc (sizeof(*t));
+	if (!t)
+		return false;
+	t->func = func;
+	t->param = param;
+	if (pthread_create (&thread, NULL, Sys_ThreadMain, t))
+	{
+		free (t);
+		return false;
+	}
+	pthread_detach (thread);
+	return true;
+}
+
+#else
+
+qboolean Sys_StartThread (char *name, sys_threadfunc_t func, void *param)
+{
+	return false;
+}
+
+#endif
+
+/*
+===============================================================================
+
+MEMORY TIERS
+
+===============================================================================
+*/
+
+#if defined(ESP_PLATFORM)
+
+#define	FAST_RESERVE	(64*1024)	// internal RAM left for drivers and stacks
+
+void *Sys_TierAlloc (int size, int tier)
+{
+	if (tier == mem_fast)
+	{
+		if (heap_caps_get_free_size (MALLOC_CAP_INTERNAL) < size + FAST_RESERVE)
+			return NULL;
+		return heap_caps_calloc (1, size, MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+	}
+	return heap_caps_calloc_prefer (1, size, 2, MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT,
+		MALLOC_CAP_DEFAULT);
+}
+
+#else
+
+void *Sys_TierAlloc (int size, int tier)
+{
+	return calloc (1, size);
+}
+
+#endif
+
+void Sys_TierFree (void *ptr)
+{
+	free (ptr);
+}
+
+int Sys_NumWorkers (void)
+{
+	if (!sys_numworkers)
+		Sys_InitWorkers ();
+	return sys_numworkers;
+}
+
+void Sys_RunJobs (sys_jobfunc_t func, int numjobs)
+{
+	int		job;
+
+	if (numjobs < 2 || Sys_NumWorkers () < 2)
+	{
+		for (job=0 ; job<numjobs ; job++)
+			func (job, 0);
+		return;
+	}
+
+#ifdef SYS_THREADS
+	sys_jobfunc = func;
+	sys_numjobs = numjobs;
+	sys_nextjob = 0;
+
+	Sys_StartWorkers ();
+	Sys_DoJobs (0);
+	Sys_WaitWorkers ();
+#endif
+}
+
 //=============================================================================
 
 /*
@@ -33,6 +33,9 @@ static byte	*vid_buffer[2];
 static short	*zbuffer;
 static byte	*surfcache;
 static size_t	surfcache_size;
+static byte	*colormap;
+
+#define	COLORMAP_SIZE	(VID_GRADES*256)
 
 void	VID_SetPalette (unsigned char *palette)
 {
@@ -48,14 +51,18 @@ void	VID_ShiftPalette (unsigned char *palette)
 
 void	VID_Init (unsigned char *palette)
 {
-	zbuffer = calloc(BASEWIDTH*BASEHEIGHT, sizeof(short));
-	vid_buffer[0] = calloc(BASEWIDTH*BASEHEIGHT, sizeof(byte));
-	vid_buffer[1] = calloc(BASEWIDTH*BASEHEIGHT, sizeof(byte));
+	// the colormap is looked up for every lit texel and the z buffer read
+	// for every entity pixel; both are wanted in fast memory
+	colormap = Tier_Alloc(COLORMAP_SIZE, mem_fast, "colormap");
+	memcpy(colormap, host_colormap, COLORMAP_SIZE);
+	zbuffer = Tier_Alloc(BASEWIDTH*BASEHEIGHT*sizeof(short), mem_fast, "zbuffer");
+	vid_buffer[0] = Tier_Alloc(BASEWIDTH*BASEHEIGHT, mem_bulk, "framebuffer");
+	vid_buffer[1] = Tier_Alloc(BASEWIDTH*BASEHEIGHT, mem_bulk, "framebuffer");
 	vid.maxwarpwidth = vid.width = vid.conwidth = BASEWIDTH;
 	vid.maxwarpheight = vid.height = vid.conheight = BASEHEIGHT;
 	vid.aspect = 1.0;
 	vid.numpages = 2;
-	vid.colormap = host_colormap;
+	vid.colormap = colormap;
 	vid.fullbright = 256 - LittleLong (*((int *)vid.colormap + 2048));
 	vid.buffer = vid.conbuffer = vid_buffer[0];
 	vid.rowbytes = vid.conrowbytes = BASEWIDTH;
@@ -63,7 +70,7 @@ void	VID_Init (unsigned char *palette)
 	d_pzbuffer = zbuffer;
 
 	surfcache_size = D_SurfaceCacheForRes(BASEWIDTH, BASEHEIGHT);
-	surfcache = malloc(surfcache_size);
+	surfcache = Tier_Alloc(surfcache_size, mem_bulk, "surfcache");
 	D_InitCaches (surfcache, surfcache_size);
 
 	// quake generic
@@ -72,10 +79,11 @@ void	VID_Init (unsigned char *palette)
 
 void	VID_Shutdown (void)
 {
-	free(zbuffer);
-	free(vid_buffer[0]);
-	free(vid_buffer[1]);
-	free(surfcache);
+	Tier_Free(zbuffer);
+	Tier_Free(vid_buffer[0]);
+	Tier_Free(vid_buffer[1]);
+	Tier_Free(surfcache);
+	Tier_Free(colormap);
 }
 
 void	VID_Update (vrect_t *rects)
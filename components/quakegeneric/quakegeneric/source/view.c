@@ -908,9 +908,10 @@ void V_RenderView (void)
 		vid.rowbytes >>= 1;
 		vid.aspect *= 2;
 	}
-	else
+	else if (!R_ReuseView ())
 	{
 		R_RenderView ();
+		R_KeepView ();
 	}
 
 	if (crosshair.value)
@@ -832,6 +832,8 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 #endif
 }
 
+int		sv_movecount;	// SV_Move calls, for load statistics
+
 /*
 ==================
 SV_Move
@@ -842,6 +844,7 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 	moveclip_t	clip;
 	int			i;
 
+	sv_movecount++;
 	memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 // clip to world
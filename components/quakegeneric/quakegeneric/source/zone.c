@@ -30,9 +30,9 @@ typedef struct memblock_s
 {
 	int		size;           // including the header and possibly tiny fragments
 	int     tag;            // a tag of 0 is a free block
-	int     id;        		// should be ZONEID
 	struct memblock_s       *next, *prev;
 	int		pad;			// pad to 64 bit boundary
+	int     id;        		// should be ZONEID; right before the data, see Z_Free
 } memblock_t;
 
 typedef struct
@@ -58,12 +58,52 @@ The rover can be left pointing at a non-empty block
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Most of those are tiny and short lived (command arguments, cvar strings), so
+Z_Malloc serves anything up to ZSMALL_MAX bytes from per size class free
+lists instead.  A class that runs dry takes another ZSLAB_SIZE block from the
+zone (tag ZTAG_SLAB) and cuts it up.  Slabs stay with their class, so churn
+in small strings can't fragment the rest of the zone; only when the zone
+runs out does Z_ReclaimSlabs hand the ones with nothing in use back to it.
+Small blocks carry an 8 byte header whose id is ZSMALLID, in the same place
+as a zone block's id, so Z_Free can tell them apart.
 ==============================================================================
 */
 
+#define	ZSMALLID		0x1d4a12
+#define	ZTAG_SLAB		-1
+#define	ZSLAB_SIZE		1024	// including the zone block header
+#define	ZSMALL_MAX		248		// largest request served from a class
+#define	ZSMALL_CLASSES	8
+
+typedef struct zsmall_s
+{
+	int		sizeclass;
+	int		id;				// should be ZSMALLID
+} zsmall_t;
+
+typedef struct
+{
+	int			size;		// including zsmall_t
+	zsmall_t	*free;		// free blocks, linked through their first word
+	int			slabs;
+	int			blocks;		// in all slabs
+	int			inuse;
+	int			peak;
+	int			allocs;
+} zclass_t;
+
+static zclass_t	zclasses[ZSMALL_CLASSES] =
+{
+	{16}, {24}, {32}, {48}, {64}, {96}, {160}, {ZSMALL_MAX + sizeof(zsmall_t)}
+};
+static byte		zclass_for[(ZSMALL_MAX + sizeof(zsmall_t)) / 8 + 1];	// by size / 8, rounded up
+static int		zbig_allocs;
+
 memzone_t	*mainzone;
 
 void Z_ClearZone (memzone_t *zone, int size);
+void Z_Print_f (void);
 
 
 /*
@@ -74,6 +114,7 @@ Z_ClearZone
 void Z_ClearZone (memzone_t *zone, int size)
 {
 	memblock_t	*block;
+	int			i, c;
 	
 // set the entire zone to one free block
 
@@ -88,6 +129,21 @@ void Z_ClearZone (memzone_t *zone, int size)
 	block->tag = 0;			// free block
 	block->id = ZONEID;
 	block->size = size - sizeof(memzone_t);
+
+// the size classes start out empty
+	for (i=0, c=0 ; i<sizeof(zclass_for) ; i++)
+	{
+		while (zclasses[c].size < i*8)
+			c++;
+		zclass_for[i] = c;
+	}
+	for (c=0 ; c<ZSMALL_CLASSES ; c++)
+	{
+		zclasses[c].free = NULL;
+		zclasses[c].slabs = zclasses[c].blocks = zclasses[c].inuse = 0;
+		zclasses[c].peak = zclasses[c].allocs = 0;
+	}
+	zbig_allocs = 0;
 }
 
 
@@ -99,10 +155,25 @@ Z_Free
 void Z_Free (void *ptr)
 {
 	memblock_t	*block, *other;
+	zsmall_t	*small;
+	zclass_t	*zc;
 	
 	if (!ptr)
 		Sys_Error ("Z_Free: NULL pointer");
 
+	small = (zsmall_t *)ptr - 1;
+	if (small->id == ZSMALLID)
+	{	// back on its class list
+		if (small->sizeclass < 0)
+			Sys_Error ("Z_Free: freed a freed pointer");
+		zc = &zclasses[small->sizeclass];
+		small->sizeclass = -1 - small->sizeclass;
+		*(zsmall_t **)ptr = zc->free;
+		zc->free = small;
+		zc->inuse--;
+		return;
+	}
+
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID)
 		Sys_Error ("Z_Free: freed a pointer without ZONEID");
@@ -134,6 +205,109 @@ void Z_Free (void *ptr)
 }
 
 
+/*
+========================
+Z_ReclaimSlabs
+
+Out of zone space: hands slabs with nothing in use back to the zone and
+rebuilds the class free lists from what is left.  Slow, but only done
+when an allocation would otherwise fail.
+========================
+*/
+static qboolean Z_ReclaimSlabs (void)
+{
+	memblock_t	*block;
+	zsmall_t	*small;
+	zclass_t	*zc;
+	int			i, count, inuse, reclaimed;
+
+	reclaimed = 0;
+restart:
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+	{
+		if (block->tag != ZTAG_SLAB)
+			continue;
+		small = (zsmall_t *)(block + 1);
+		zc = &zclasses[small->sizeclass < 0 ? -1 - small->sizeclass : small->sizeclass];
+		count = (ZSLAB_SIZE - sizeof(memblock_t) - 8) / zc->size;
+		for (i=inuse=0 ; i<count ; i++)
+			if (((zsmall_t *)((byte *)small + i*zc->size))->sizeclass >= 0)
+				inuse++;
+		if (inuse)
+			continue;
+		zc->slabs--;
+		zc->blocks -= count;
+		reclaimed++;
+		Z_Free (block + 1);		// may merge with its neighbours
+		goto restart;
+	}
+	if (!reclaimed)
+		return false;
+
+	for (i=0 ; i<ZSMALL_CLASSES ; i++)
+		zclasses[i].free = NULL;
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+	{
+		if (block->tag != ZTAG_SLAB)
+			continue;
+		small = (zsmall_t *)(block + 1);
+		zc = &zclasses[small->sizeclass < 0 ? -1 - small->sizeclass : small->sizeclass];
+		count = (ZSLAB_SIZE - sizeof(memblock_t) - 8) / zc->size;
+		for (i=0 ; i<count ; i++, small = (zsmall_t *)((byte *)small + zc->size))
+		{
+			if (small->sizeclass >= 0)
+				continue;
+			*(zsmall_t **)(small + 1) = zc->free;
+			zc->free = small;
+		}
+	}
+	return true;
+}
+
+/*
+========================
+Z_SmallMalloc
+
+Takes a block from a size class, cutting up a new slab if it ran out
+========================
+*/
+static void *Z_SmallMalloc (int size)
+{
+	zclass_t	*zc;
+	zsmall_t	*small;
+	byte		*slab;
+	int			i, count;
+
+	zc = &zclasses[zclass_for[(size + sizeof(zsmall_t) + 7) >> 3]];
+	if (!zc->free)
+	{
+		slab = Z_TagMalloc (ZSLAB_SIZE - sizeof(memblock_t) - 8, ZTAG_SLAB);
+		if (!slab && Z_ReclaimSlabs ())
+			slab = Z_TagMalloc (ZSLAB_SIZE - sizeof(memblock_t) - 8, ZTAG_SLAB);
+		if (!slab)
+			return NULL;
+		count = (ZSLAB_SIZE - sizeof(memblock_t) - 8) / zc->size;
+		for (i=0 ; i<count ; i++)
+		{
+			small = (zsmall_t *)(slab + i*zc->size);
+			small->id = ZSMALLID;
+			small->sizeclass = -1 - (zc - zclasses);
+			*(zsmall_t **)(small + 1) = zc->free;
+			zc->free = small;
+		}
+		zc->slabs++;
+		zc->blocks += count;
+	}
+
+	small = zc->free;
+	zc->free = *(zsmall_t **)(small + 1);
+	small->sizeclass = zc - zclasses;
+	zc->allocs++;
+	if (++zc->inuse > zc->peak)
+		zc->peak = zc->inuse;
+	return small + 1;
+}
+
 /*
 ========================
 Z_Malloc
@@ -143,8 +317,16 @@ void *Z_Malloc (int size)
 {
 	void	*buf;
 	
-Z_CheckHeap ();	// DEBUG
-	buf = Z_TagMalloc (size, 1);
+#ifdef PARANOID
+	Z_CheckHeap ();
+#endif
+	buf = NULL;
+	if (size <= ZSMALL_MAX)
+		buf = Z_SmallMalloc (size);
+	if (!buf)
+		buf = Z_TagMalloc (size, 1);
+	if (!buf && Z_ReclaimSlabs ())
+		buf = Z_TagMalloc (size, 1);
 	if (!buf)
 		Sys_Error ("Z_Malloc: failed on allocation of %i bytes",size);
 	Q_memset (buf, 0, size);
@@ -203,6 +385,7 @@ void *Z_TagMalloc (int size, int tag)
 	mainzone->rover = base->next;	// next allocation will start looking here
 	
 	base->id = ZONEID;
+	zbig_allocs++;
 
 // marker for memory trash testing
 	*(int *)((byte *)base + base->size - 4) = ZONEID;
@@ -214,18 +397,48 @@ void *Z_TagMalloc (int size, int tag)
 /*
 ========================
 Z_Print
+
+Sums up the zone: used and free space, how scattered the free space is,
+zone blocks by size, and the small block classes.  With all set every
+zone block is listed as well.
 ========================
 */
-void Z_Print (memzone_t *zone)
+void Z_Print (memzone_t *zone, qboolean all)
 {
 	memblock_t	*block;
+	zclass_t	*zc;
+	int			i, bucket;
+	int			used, usedbytes, freeblocks, freebytes, largest;
+	int			slabs;
+	int			sizecount[8];	// blocks up to 64, 128, ... bytes, and bigger
 	
 	Con_Printf ("zone size: %i  location: %p\n",mainzone->size,mainzone);
-	
+
+	used = usedbytes = freeblocks = freebytes = largest = slabs = 0;
+	memset (sizecount, 0, sizeof(sizecount));
 	for (block = zone->blocklist.next ; ; block = block->next)
 	{
-		Con_Printf ("block:%p    size:%7i    tag:%3i\n",
-			block, block->size, block->tag);
+		if (all)
+			Con_Printf ("block:%p    size:%7i    tag:%3i\n",
+				block, block->size, block->tag);
+
+		if (!block->tag)
+		{
+			freeblocks++;
+			freebytes += block->size;
+			if (block->size > largest)
+				largest = block->size;
+		}
+		else if (block->tag == ZTAG_SLAB)
+			slabs++;
+		else
+		{
+			used++;
+			usedbytes += block->size;
+			for (bucket=0 ; bucket<7 && block->size > (64<<bucket) ; bucket++)
+				;
+			sizecount[bucket]++;
+		}
 		
 		if (block->next == &zone->blocklist)
 			break;			// all blocks have been hit	
@@ -236,6 +449,32 @@ void Z_Print (memzone_t *zone)
 		if (!block->tag && !block->next->tag)
 			Con_Printf ("ERROR: two consecutive free blocks\n");
 	}
+
+	Con_Printf ("%i blocks in use (%i bytes), %i slabs (%i bytes)\n",
+		used, usedbytes, slabs, slabs*ZSLAB_SIZE);
+	Con_Printf ("%i bytes free in %i blocks, largest %i, %i%% fragmented\n",
+		freebytes, freeblocks, largest,
+		freebytes ? 100 - (int)(100.0 * largest / freebytes) : 0);
+	Con_Printf ("%i large allocations since clear\n", zbig_allocs);
+	Con_Printf ("block sizes:");
+	for (bucket=0 ; bucket<8 ; bucket++)
+	{
+		if (bucket < 7)
+			Con_Printf (" <=%i:%i", 64<<bucket, sizecount[bucket]);
+		else
+			Con_Printf (" more:%i", sizecount[bucket]);
+	}
+	Con_Printf ("\n");
+
+	Con_Printf ("class  slabs blocks  inuse   peak   allocs\n");
+	for (i=0, zc=zclasses ; i<ZSMALL_CLASSES ; i++, zc++)
+		Con_Printf ("%5i %6i %6i %6i %6i %8i\n", zc->size - (int)sizeof(zsmall_t),
+			zc->slabs, zc->blocks, zc->inuse, zc->peak, zc->allocs);
+}
+
+void Z_Print_f (void)
+{
+	Z_Print (mainzone, Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "all"));
 }
 
 
@@ -561,12 +800,123 @@ typedef struct cache_system_s
 	char					name[16];
 	struct cache_system_s	*prev, *next;
 	struct cache_system_s	*lru_prev, *lru_next;	// for LRU flushing	
+	int						gap;		// free bytes up to next, if indexed
+	struct cache_system_s	*gap_prev, *gap_next;	// in cache_gaps[Cache_GapBin(gap)]
 } cache_system_t;
 
 cache_system_t *Cache_TryAlloc (int size, qboolean nobottom);
 
 cache_system_t	cache_head;
 
+/*
+The free space between cache blocks is indexed by the block in front of
+it, in lists binned by the log2 of the gap size, so an allocation looks
+at one partial bin and a bitmask instead of walking every block.  The
+gaps below the first block and above the last one move with the hunk
+marks and are checked directly.
+*/
+#define	CACHE_GAPBINS	24
+
+static cache_system_t	*cache_gaps[CACHE_GAPBINS];
+static int				cache_gapmask;		// bit set for each non-empty bin
+
+static int		cache_workingset = 1;
+
+static struct
+{
+	int		hits;			// Cache_Check found the data
+	int		allocs;			// ... and the ones that had to be loaded
+	int		evictions;
+	int		evicted_bytes;
+	int		ws_evictions;	// had to throw out part of the working set
+	int		moves;			// moved out of the way of the hunk
+} cache_stats;
+
+static int Cache_GapBin (int gap)
+{
+	int		bin;
+
+	for (bin = 0, gap >>= 5 ; gap && bin < CACHE_GAPBINS-1 ; gap >>= 1)
+		bin++;
+	return bin;
+}
+
+static void Cache_UnlinkGap (cache_system_t *cs)
+{
+	int		bin;
+
+	if (!cs->gap)
+		return;
+	bin = Cache_GapBin (cs->gap);
+	if (cs->gap_prev)
+		cs->gap_prev->gap_next = cs->gap_next;
+	else
+		cache_gaps[bin] = cs->gap_next;
+	if (cs->gap_next)
+		cs->gap_next->gap_prev = cs->gap_prev;
+	if (!cache_gaps[bin])
+		cache_gapmask &= ~(1<<bin);
+	cs->gap = 0;
+	cs->gap_prev = cs->gap_next = NULL;
+}
+
+/*
+============
+Cache_UpdateGap
+
+Call after the block following cs has changed
+============
+*/
+static void Cache_UpdateGap (cache_system_t *cs)
+{
+	int		bin;
+
+	if (cs == &cache_head)
+		return;		// the gap at the bottom isn't indexed
+	Cache_UnlinkGap (cs);
+	if (cs->next == &cache_head)
+		return;		// neither is the one at the top
+	cs->gap = (byte *)cs->next - ((byte *)cs + cs->size);
+	if (!cs->gap)
+		return;
+	bin = Cache_GapBin (cs->gap);
+	cs->gap_prev = NULL;
+	cs->gap_next = cache_gaps[bin];
+	if (cs->gap_next)
+		cs->gap_next->gap_prev = cs;
+	cache_gaps[bin] = cs;
+	cache_gapmask |= 1<<bin;
+}
+
+/*
+============
+Cache_FindGap
+
+Returns the block with the smallest indexed gap of at least size after it
+============
+*/
+static cache_system_t *Cache_FindGap (int size)
+{
+	cache_system_t	*cs, *best;
+	int				bin, mask;
+
+	bin = Cache_GapBin (size);
+	best = NULL;
+	for (cs = cache_gaps[bin] ; cs ; cs = cs->gap_next)
+		if (cs->gap >= size && (!best || cs->gap < best->gap))
+			best = cs;
+	if (best)
+		return best;
+
+// anything in a higher bin fits
+	mask = cache_gapmask & ~((2<<bin) - 1);
+	if (!mask)
+		return NULL;
+	for (bin++ ; !(mask & (1<<bin)) ; bin++)
+		;
+	return cache_gaps[bin];
+}
+
 /*
 ===========
 Cache_Move
@@ -587,12 +937,15 @@ void Cache_Move ( cache_system_t *c)
 		Q_memcpy (new->name, c->name, sizeof(new->name));
 		Cache_Free (c->user);
 		new->user->data = (void *)(new+1);
+		cache_stats.moves++;
 	}
 	else
 	{
 //		Con_Printf ("cache_move failed\n");
 
 		Cache_Free (c->user);		// tough luck...
+		cache_stats.evictions++;
+		cache_stats.evicted_bytes += c->size;
 	}
 }
 
@@ -638,7 +991,11 @@ void Cache_FreeHigh (int new_high_hunk)
 		if ( (byte *)c + c->size <= hunk_base + hunk_size - new_high_hunk)
 			return;		// there is space to grow the hunk
 		if (c == prev)
+		{
 			Cache_Free (c->user);	// didn't move out of the way
+			cache_stats.evictions++;
+			cache_stats.evicted_bytes += c->size;
+		}
 		else
 		{
 			Cache_Move (c);	// try to move it
@@ -669,6 +1026,32 @@ void Cache_MakeLRU (cache_system_t *cs)
 	cache_head.lru_next = cs;
 }
 
+/*
+============
+Cache_LinkAfter
+
+Puts a new block of size bytes at the start of the gap after prev
+============
+*/
+static cache_system_t *Cache_LinkAfter (cache_system_t *prev, byte *at, int size)
+{
+	cache_system_t	*new;
+
+	new = (cache_system_t *)at;
+	memset (new, 0, sizeof(*new));
+	new->size = size;
+
+	new->prev = prev;
+	new->next = prev->next;
+	prev->next->prev = new;
+	prev->next = new;
+
+	Cache_UpdateGap (prev);
+	Cache_UpdateGap (new);
+	Cache_MakeLRU (new);
+	return new;
+}
+
 /*
 ============
 Cache_TryAlloc
@@ -679,7 +1062,8 @@ Size should already include the header and padding
 */
 cache_system_t *Cache_TryAlloc (int size, qboolean nobottom)
 {
-	cache_system_t	*cs, *new;
+	cache_system_t	*cs;
+	byte			*top;
 	
 // is the cache completely empty?
 
@@ -688,63 +1072,25 @@ cache_system_t *Cache_TryAlloc (int size, qboolean nobottom)
 		if (hunk_size - hunk_high_used - hunk_low_used < size)
 			Sys_Error ("Cache_TryAlloc: %i is greater then free hunk", size);
 
-		new = (cache_system_t *) (hunk_base + hunk_low_used);
-		memset (new, 0, sizeof(*new));
-		new->size = size;
-
-		cache_head.prev = cache_head.next = new;
-		new->prev = new->next = &cache_head;
-		
-		Cache_MakeLRU (new);
-		return new;
+		return Cache_LinkAfter (&cache_head, hunk_base + hunk_low_used, size);
 	}
 	
-// search from the bottom up for space
-
-	new = (cache_system_t *) (hunk_base + hunk_low_used);
-	cs = cache_head.next;
-	
-	do
-	{
-		if (!nobottom || cs != cache_head.next)
-		{
-			if ( (byte *)cs - (byte *)new >= size)
-			{	// found space
-				memset (new, 0, sizeof(*new));
-				new->size = size;
-				
-				new->next = cs;
-				new->prev = cs->prev;
-				cs->prev->next = new;
-				cs->prev = new;
-				
-				Cache_MakeLRU (new);
-	
-				return new;
-			}
-		}
+// the space right above the low hunk, unless it is being cleared
+	if (!nobottom && (byte *)cache_head.next - (hunk_base + hunk_low_used) >= size)
+		return Cache_LinkAfter (&cache_head, hunk_base + hunk_low_used, size);
 
-	// continue looking		
-		new = (cache_system_t *)((byte *)cs + cs->size);
-		cs = cs->next;
+// a gap between two blocks
+	cs = Cache_FindGap (size);
+	if (cs)
+		return Cache_LinkAfter (cs, (byte *)cs + cs->size, size);
 
-	} while (cs != &cache_head);
-	
 // try to allocate one at the very end
-	if ( hunk_base + hunk_size - hunk_high_used - (byte *)new >= size)
-	{
-		memset (new, 0, sizeof(*new));
-		new->size = size;
-		
-		new->next = &cache_head;
-		new->prev = cache_head.prev;
-		cache_head.prev->next = new;
-		cache_head.prev = new;
-		
-		Cache_MakeLRU (new);
-
-		return new;
-	}
+	if (cache_head.prev == &cache_head)
+		top = hunk_base + hunk_low_used;
+	else
+		top = (byte *)cache_head.prev + cache_head.prev->size;
+	if ( hunk_base + hunk_size - hunk_high_used - top >= size)
+		return Cache_LinkAfter (cache_head.prev, top, size);
 	
 	return NULL;		// couldn't allocate
 }
@@ -775,8 +1121,53 @@ void Cache_Print (void)
 
 	for (cd = cache_head.next ; cd != &cache_head ; cd = cd->next)
 	{
-		Con_Printf ("%8i : %s\n", cd->size, cd->name);
+		Con_Printf ("%8i : %s%s\n", cd->size, cd->name,
+			cd->user->workingset == cache_workingset ? " (working set)" : "");
+	}
+}
+
+/*
+============
+Cache_PrintReport
+
+============
+*/
+static void Cache_PrintReport (void (*print) (char *fmt, ...))
+{
+	cache_system_t	*cs;
+	int				used, entries, ws, largest, gap, lookups;
+
+	used = entries = ws = largest = 0;
+	for (cs = cache_head.next ; cs != &cache_head ; cs = cs->next)
+	{
+		used += cs->size;
+		entries++;
+		if (cs->user->workingset == cache_workingset)
+			ws += cs->size;
+		if (cs->gap > largest)
+			largest = cs->gap;
+	}
+	if (cache_head.next != &cache_head)
+	{
+		gap = (byte *)cache_head.next - (hunk_base + hunk_low_used);
+		if (gap > largest)
+			largest = gap;
+		cs = cache_head.prev;
+		gap = hunk_base + hunk_size - hunk_high_used - ((byte *)cs + cs->size);
 	}
+	else
+		gap = hunk_size - hunk_high_used - hunk_low_used;
+	if (gap > largest)
+		largest = gap;
+
+	print ("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024*1024) );
+	print ("%i entries in %ik, %ik in the working set, largest free %ik\n",
+		entries, used/1024, ws/1024, largest/1024);
+	lookups = cache_stats.hits + cache_stats.allocs;
+	print ("%i hits, %i loads (%.1f%% hit rate)\n", cache_stats.hits, cache_stats.allocs,
+		lookups ? 100.0 * cache_stats.hits / lookups : 0.0);
+	print ("%i evicted (%ik, %i from the working set), %i moved\n", cache_stats.evictions,
+		cache_stats.evicted_bytes/1024, cache_stats.ws_evictions, cache_stats.moves);
 }
 
 /*
@@ -787,7 +1178,26 @@ Cache_Report
 */
 void Cache_Report (void)
 {
-	Con_DPrintf ("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024*1024) );
+	Cache_PrintReport (Con_DPrintf);
+}
+
+/*
+============
+Cache_Report_f
+
+cache [all | reset]
+============
+*/
+static void Cache_Report_f (void)
+{
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "reset"))
+	{
+		memset (&cache_stats, 0, sizeof(cache_stats));
+		return;
+	}
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv (1), "all"))
+		Cache_Print ();
+	Cache_PrintReport (Con_Printf);
 }
 
 /*
@@ -812,6 +1222,31 @@ void Cache_Init (void)
 	cache_head.lru_next = cache_head.lru_prev = &cache_head;
 
 	Cmd_AddCommand ("flush", Cache_Flush);
+	Cmd_AddCommand ("cache", Cache_Report_f);
+}
+
+/*
+==============
+Cache_BeginWorkingSet
+
+Called before a level precaches; whatever the last one added stops being
+protected from eviction
+==============
+*/
+void Cache_BeginWorkingSet (void)
+{
+	cache_workingset++;
+}
+
+/*
+==============
+Cache_AddWorkingSet
+
+==============
+*/
+void Cache_AddWorkingSet (cache_user_t *c)
+{
+	c->workingset = cache_workingset;
 }
 
 /*
@@ -823,16 +1258,19 @@ Frees the memory and removes it from the LRU list
 */
 void Cache_Free (cache_user_t *c)
 {
-	cache_system_t	*cs;
+	cache_system_t	*cs, *prev;
 
 	if (!c->data)
 		Sys_Error ("Cache_Free: not allocated");
 
 	cs = ((cache_system_t *)c->data) - 1;
 
+	prev = cs->prev;
 	cs->prev->next = cs->next;
 	cs->next->prev = cs->prev;
 	cs->next = cs->prev = NULL;
+	Cache_UnlinkGap (cs);
+	Cache_UpdateGap (prev);
 
 	c->data = NULL;
 
@@ -858,11 +1296,37 @@ void *Cache_Check (cache_user_t *c)
 // move to head of LRU
 	Cache_UnlinkLRU (cs);
 	Cache_MakeLRU (cs);
+	cache_stats.hits++;
 	
 	return c->data;
 }
 
 
+/*
+==============
+Cache_Evict
+
+Throws out the least recently used data outside the working set, or the
+least recently used of all if everything left is in it
+==============
+*/
+static void Cache_Evict (void)
+{
+	cache_system_t	*cs;
+
+	for (cs = cache_head.lru_prev ; cs != &cache_head ; cs = cs->lru_prev)
+		if (cs->user->workingset != cache_workingset)
+			break;
+	if (cs == &cache_head)
+	{
+		cs = cache_head.lru_prev;
+		cache_stats.ws_evictions++;
+	}
+	cache_stats.evictions++;
+	cache_stats.evicted_bytes += cs->size;
+	Cache_Free (cs->user);
+}
+
 /*
 ==============
 Cache_Alloc
@@ -896,10 +1360,160 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name)
 		if (cache_head.lru_prev == &cache_head)
 			Sys_Error ("Cache_Alloc: out of memory");
 													// not enough memory at all
-		Cache_Free ( cache_head.lru_prev->user );
+		Cache_Evict ();
 	} 
+	cache_stats.allocs++;
 	
-	return Cache_Check (c);
+	return c->data;		// Cache_TryAlloc put it at the head of the LRU
+}
+
+//============================================================================
+
+/*
+===============================================================================
+
+MEMORY TIERS
+
+Fast memory is the on-chip RAM of platforms that have it, bulk memory is
+everything else (PSRAM on the ESP32).  The renderer asks for its hot
+working set from the fast tier at startup; whatever doesn't fit in the
+-fastmem budget, or that the platform can't spare, quietly comes from
+bulk memory instead.  On hosts both tiers are ordinary memory and only the
+bookkeeping is real, so the report shows what the device would place.
+
+===============================================================================
+*/
+
+#define	MAX_TIERALLOCS	32
+#define	DEFAULT_FASTMEM	(384*1024)	// the renderer's fast allocations come to
+									// about 320k; Sys_TierAlloc still keeps its
+									// own reserve for the platform
+
+typedef struct
+{
+	void		*ptr;
+	int			size;
+	memtier_t	wanted, tier;
+	char		name[16];
+} tieralloc_t;
+
+static tieralloc_t	tier_allocs[MAX_TIERALLOCS];
+static int			tier_used[2];
+static int			tier_budget = DEFAULT_FASTMEM;
+
+/*
+========================
+Tier_TryAlloc
+========================
+*/
+void *Tier_TryAlloc (int size, memtier_t tier, char *name)
+{
+	tieralloc_t	*ta;
+	int			i;
+
+	for (i=0, ta=tier_allocs ; i<MAX_TIERALLOCS ; i++, ta++)
+		if (!ta->ptr)
+			break;
+	if (i == MAX_TIERALLOCS)
+		return NULL;
+
+	ta->wanted = tier;
+	ta->ptr = NULL;
+	if (tier == mem_fast && tier_used[mem_fast] + size <= tier_budget)
+		ta->ptr = Sys_TierAlloc (size, mem_fast);
+	if (ta->ptr)
+		ta->tier = mem_fast;
+	else
+	{
+		ta->tier = mem_bulk;
+		ta->ptr = Sys_TierAlloc (size, mem_bulk);
+		if (!ta->ptr)
+			return NULL;
+	}
+	ta->size = size;
+	Q_strncpy (ta->name, name, sizeof(ta->name)-1);
+	tier_used[ta->tier] += size;
+
+	return ta->ptr;
+}
+
+/*
+========================
+Tier_Alloc
+========================
+*/
+void *Tier_Alloc (int size, memtier_t tier, char *name)
+{
+	void	*ptr;
+
+	ptr = Tier_TryAlloc (size, tier, name);
+	if (!ptr)
+		Sys_Error ("Tier_Alloc: failed on allocation of %i bytes for %s", size, name);
+
+	return ptr;
+}
+
+/*
+========================
+Tier_Free
+========================
+*/
+void Tier_Free (void *ptr)
+{
+	tieralloc_t	*ta;
+	int			i;
+
+	for (i=0, ta=tier_allocs ; i<MAX_TIERALLOCS ; i++, ta++)
+		if (ta->ptr == ptr)
+			break;
+	if (!ptr || i == MAX_TIERALLOCS)
+		Sys_Error ("Tier_Free: not allocated");
+
+	Sys_TierFree (ptr);
+	tier_used[ta->tier] -= ta->size;
+	memset (ta, 0, sizeof(*ta));
+}
+
+/*
+========================
+Tier_IsFast
+========================
+*/
+qboolean Tier_IsFast (void *ptr)
+{
+	tieralloc_t	*ta;
+	int			i;
+
+	for (i=0, ta=tier_allocs ; i<MAX_TIERALLOCS ; i++, ta++)
+		if (ta->ptr == ptr)
+			return ta->tier == mem_fast;
+	return false;
+}
+
+/*
+========================
+Tier_Print_f
+
+Lists what went where
+========================
+*/
+static void Tier_Print_f (void)
+{
+	tieralloc_t	*ta;
+	int			i, spilled;
+
+	spilled = 0;
+	for (i=0, ta=tier_allocs ; i<MAX_TIERALLOCS ; i++, ta++)
+	{
+		if (!ta->ptr)
+			continue;
+		Con_Printf ("%8i %s : %s%s\n", ta->size, ta->tier == mem_fast ? "fast" : "bulk",
+			ta->name, ta->wanted != ta->tier ? " (spilled)" : "");
+		if (ta->wanted != ta->tier)
+			spilled += ta->size;
+	}
+	Con_Printf ("fast: %ik of %ik budget\n", tier_used[mem_fast]/1024, tier_budget/1024);
+	Con_Printf ("bulk: %ik, %ik of it wanted fast\n", tier_used[mem_bulk]/1024, spilled/1024);
 }
 
 //============================================================================
@@ -931,5 +1545,11 @@ void Memory_Init (void *buf, int size)
 	}
 	mainzone = Hunk_AllocName (zonesize, "zone" );
 	Z_ClearZone (mainzone, zonesize);
+	Cmd_AddCommand ("zone", Z_Print_f);
+
+	p = COM_CheckParm ("-fastmem");
+	if (p && p < com_argc-1)
+		tier_budget = Q_atoi (com_argv[p+1]) * 1024;
+	Cmd_AddCommand ("tiers", Tier_Print_f);
 }
 
@@ -111,6 +111,7 @@ void Hunk_Check (void);
 typedef struct cache_user_s
 {
 	void	*data;
+	int		workingset;		// last working set it was added to
 } cache_user_t;
 
 void Cache_Flush (void);
@@ -127,5 +128,20 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name);
 
 void Cache_Report (void);
 
-
-
+void Cache_BeginWorkingSet (void);
+void Cache_AddWorkingSet (cache_user_t *c);
+// Objects in the current working set (whatever the level precached) are
+// only evicted once nothing else is left to throw out.  The hint sticks
+// to the user, so it can be given before the data is loaded.
+
+typedef enum {mem_fast, mem_bulk} memtier_t;
+
+void *Tier_Alloc (int size, memtier_t tier, char *name);
+// returns 0 filled memory that lives until Tier_Free, from the fast
+// (on-chip) tier if asked for and it fits in the -fastmem budget, else from
+// the bulk tier.  Asking early wins; nothing migrates later
+void *Tier_TryAlloc (int size, memtier_t tier, char *name);
+// like Tier_Alloc, but returns NULL instead of failing, for memory the
+// caller can do without
+void Tier_Free (void *ptr);
+qboolean Tier_IsFast (void *ptr);
@@ -20,6 +20,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
 
 
 #include "quakedef.h"
@@ -36,37 +37,35 @@ unsigned char dma_buffer[BUFFER_SIZE];
 
 int dma_rpos;
 
-void CDAudio_get_samps(char *samps, int len_bytes);
+//Small chunks keep the distance between what the codec has taken and what is
+//audible short. Must divide BUFFER_SIZE.
+#define CHUNKSZ 1024
+
+//Frames queued in the I2S DMA descriptors behind the codec (the BSP uses the
+//I2S driver defaults: 6 descriptors of 240 frames).
+#define I2S_QUEUE_FRAMES (6*240)
+
+//Frames handed to the codec so far, and when the last write returned.
+static portMUX_TYPE pos_mux=portMUX_INITIALIZER_UNLOCKED;
+static int64_t written_frames;
+static int64_t written_time;
 
-#define CHUNKSZ (BUFFER_SIZE/8)
 void audio_task(void *param) {
 	printf("audio task running\n");
 	//simulate DMA to audio; just write the DMA buffer in a circular fashion.
-	int16_t *mix_buf=calloc(CHUNKSZ/2, sizeof(int16_t));
-	int old_volume=-1;
+	//The engine mixes both sound effects and CD music into it and applies the
+	//master volume itself, so it goes out as-is; the codec stays at DEFAULT_VOLUME.
 	while(1) {
-		int mainvolume = (int)(volume.value * 100.0);
-		if (mainvolume!=old_volume) {
-			esp_codec_dev_set_out_vol(spk_codec_dev, mainvolume);
-			old_volume=mainvolume;
-			printf("Set volume %f\n", mainvolume);
-		}
-		int cdvol = (int)(bgmvolume.value * 255.0);
-
-		CDAudio_get_samps((char*)mix_buf, CHUNKSZ);
-		int16_t *digaudio=(int16_t*)&dma_buffer[dma_rpos];
-		//Mix CD audio and digi samples
-		for (int i=0; i<CHUNKSZ/2; i++) {
-			int a=(((int)mix_buf[i])*cdvol)/256;
-//			int a=mix_buf[i];
-			int b=digaudio[i];
-			int mixed=(a*24)+(b*8); //set mix ratio between cd music and game audio here
-			mix_buf[i]=mixed/32;
-		}
+		//Only advance once the codec has taken the chunk, so the engine doesn't
+		//paint over it while it's being copied out.
+		esp_codec_dev_write(spk_codec_dev, &dma_buffer[dma_rpos], CHUNKSZ);
+		int64_t now=esp_timer_get_time();
+		portENTER_CRITICAL(&pos_mux);
+		written_frames+=CHUNKSZ/4;
+		written_time=now;
+		portEXIT_CRITICAL(&pos_mux);
 		dma_rpos=(dma_rpos + CHUNKSZ) % BUFFER_SIZE;
-		esp_codec_dev_write(spk_codec_dev, mix_buf, CHUNKSZ);
 	}
-	free(mix_buf);
 }
 
 qboolean SNDDMA_Init(void)
@@ -91,7 +90,9 @@ qboolean SNDDMA_Init(void)
 	shm->soundalive = true;
 	shm->samples = sizeof(dma_buffer) / (shm->samplebits/8);
 	shm->samplepos = 0;
-	shm->submission_chunk = 1;
+	//the engine has to stay ahead of everything the codec has queued plus the chunk
+	//being written, counted from the audible position
+	shm->submission_chunk = (I2S_QUEUE_FRAMES + CHUNKSZ/4) * shm->channels;
 	shm->buffer = (unsigned char *)dma_buffer;
 	snd_inited = 1;
 	Con_Printf("16 bit stereo sound initialized\n");
@@ -101,8 +102,22 @@ qboolean SNDDMA_Init(void)
 
 int SNDDMA_GetDMAPos(void) //in (e.g. 16-bit) samples
 {
+	static int64_t last_played;
+	int64_t frames, t, played;
 	if (!snd_inited) return (0);
-	shm->samplepos=dma_rpos / (shm->samplebits / 8);
+	portENTER_CRITICAL(&pos_mux);
+	frames=written_frames;
+	t=written_time;
+	portEXIT_CRITICAL(&pos_mux);
+	//A write returns as soon as its data fits in the I2S DMA queue, so right then
+	//the queue is full; since then it has drained at the sample rate. That gives
+	//the audible position to the sample instead of in chunk steps.
+	played=frames - I2S_QUEUE_FRAMES + (esp_timer_get_time() - t) * shm->speed / 1000000;
+	if (played > frames) played=frames; //starved
+	if (played < last_played) played=last_played;
+	if (played < 0) played=0;
+	last_played=played;
+	shm->samplepos=(int)((played * shm->channels) % shm->samples);
 	return shm->samplepos;
 }
 
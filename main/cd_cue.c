@@ -14,8 +14,10 @@
 
 #include "quakedef.h"
 #include "esp_attr.h"
-#include "freertos/ringbuf.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include <fnmatch.h>
 #include <sys/types.h>
 #include <dirent.h>
@@ -24,6 +26,10 @@
 Note: The GOG release of the game includes the CDs as cue/gog (actually cue/bin) files
 which contains the raw audio as 16-bit signed LE 44100KHz audio. We can simply open those
 and use the track timecode to seek to the correct place, then play the track raw.
+
+Raw CD audio is 176 KB/s of card bandwidth, which competes with level loading. Tracks can
+also be supplied as IMA-ADPCM .wav files (see tools/cd2adpcm.c), at a quarter of that; these
+are decoded block by block in the cd task. Plain 16-bit 44.1KHz stereo .wav files work too.
 */
 
 #define CD_FRAME_SIZE 2352
@@ -36,11 +42,13 @@ typedef struct {
 	int offset_bytes;
 	int length_bytes;
 	int type;
+	char *file;		//compressed replacement, played instead of the bin
 } track_t;
 
 #define MAX_TRK 32
 track_t tracks[MAX_TRK]={0};
 FILE *cdfile;
+static int cd_available;
 
 SemaphoreHandle_t player_ctl_mux;
 
@@ -100,34 +108,58 @@ static FILE* open_cuefile(const char *basedir) {
 	return NULL; //nothing found
 }
 
-void cd_task(void *param);
-RingbufHandle_t ringbuf;
-#define RINGBUF_SZ (CD_FRAME_SIZE*32)
+//Music is streamed from the bin file through a pool of large buffers. The cd
+//task reads whole buffers at cluster-aligned file offsets straight into the
+//pool (the file is unbuffered), so each read is one long run on the card. The
+//mixer takes full buffers from cd_full and hands them back through cd_free.
+#define CD_READ_ALIGN 4096
+#define CD_BUFSZ (64*1024)		//multiple of CD_READ_ALIGN
+#define CD_NUMBUFS 12			//~4.5 seconds of audio
+#define CD_LOWWATER 4			//below this many full buffers, reads are urgent
 
-int CDAudio_Init(void)
-{
-	//Need to re-get the basedir from either the defaults or command
-	//line. Common.c does this as well but not in an accessible fashion.
-	char basedir[MAX_OSPATH];
-	int i = COM_CheckParm ("-basedir");
-	if (i && i < com_argc-1) {
-		strcpy (basedir, com_argv[i+1]);
-	} else {
-		strcpy (basedir, host_parms.basedir);
-	}
-	int j = strlen (basedir);
-	if (j > 0) {
-		if ((basedir[j-1] == '\\') || (basedir[j-1] == '/')) {
-			basedir[j-1] = 0;
-		}
-	}
+#define CD_PRIO_URGENT 4
+#define CD_PRIO_BACKGROUND 1	//below the quake task
 
+typedef struct {
+	char *data;
+	int start;		//first valid byte; only nonzero after a seek
+	int len;		//end of valid bytes
+	int generation;	//play command this audio belongs to
+} cdbuf_t;
+
+static cdbuf_t cd_bufs[CD_NUMBUFS];
+static QueueHandle_t cd_free, cd_full;
+
+//Mixer side: the buffer being played and how far into it we are
+static cdbuf_t *cd_cur;
+static int cd_curpos;
+
+//Counters for cd_stats
+static struct {
+	int underruns;			//times the mixer found the pool empty mid-track
+	int starved_frames;		//frames it had to pad with silence
+	int reads;
+	int urgent_reads;
+	int deferred;			//top-ups postponed while a level loads
+	int64_t read_bytes;
+	int64_t read_us;
+	int max_read_us;
+	int64_t decode_us;		//adpcm tracks
+	int64_t decoded_frames;
+	int min_queued;			//lowest pool level seen while playing
+} cd_stats;
+
+static void cd_task(void *param);
+static int CDAudio_ReadSamples(short *samples, int count);
+static void CDAudio_Stats_f(void);
+
+//Parse the cue sheet and open the bin image it points at.
+static int cd_load_cue(const char *basedir) {
 	FILE *f=open_cuefile(basedir);
 	if (!f) {
 		printf("CDAudio_Init: couldn't find cue file\n");
 		return 0;
 	}
-	if (!f) return 0;
 	char buf[1024];
 	char binfile[MAX_OSPATH]={0};
 	int cur_trk=0;
@@ -171,6 +203,8 @@ int CDAudio_Init(void)
 		printf("CDAudio_Init: couldn't find bin file %s\n", binfile);
 		return 0;
 	}
+	//Reads go straight into the pool; stdio buffering would only split them up
+	setvbuf(cdfile, NULL, _IONBF, 0);
 	//Find size of bin file so we know the end of the last track
 	fseek(cdfile, 0, SEEK_END);
 	long cdsize=ftell(cdfile);
@@ -189,99 +223,479 @@ int CDAudio_Init(void)
 					tracks[i].offset_bytes,
 					tracks[i].length_bytes);
 	}
+	return 1;
+}
+
+//Look for compressed replacements for the image's tracks, named
+//music/trackNN.wav under the basedir. These take precedence over the bin.
+static int cd_find_compressed(const char *basedir) {
+	char fn[MAX_OSPATH];
+	int found=0;
+	for (int i=1; i<MAX_TRK; i++) {
+		snprintf(fn, sizeof(fn), "%s/music/track%02d.wav", basedir, i);
+		FILE *f=fopen(fn, "rb");
+		if (!f) continue;
+		fclose(f);
+		tracks[i].file=strdup(fn);
+		tracks[i].type=TYPE_AUDIO;
+		printf("Track %d: %s\n", i, fn);
+		found++;
+	}
+	return found;
+}
 
-	//Create the ringbuffer where the samples are dumped into and start the cd audio task.
-	ringbuf=xRingbufferCreateWithCaps(RINGBUF_SZ, RINGBUF_TYPE_BYTEBUF, MALLOC_CAP_SPIRAM);
-	assert(ringbuf);
+int CDAudio_Init(void)
+{
+	//Need to re-get the basedir from either the defaults or command
+	//line. Common.c does this as well but not in an accessible fashion.
+	char basedir[MAX_OSPATH];
+	int i = COM_CheckParm ("-basedir");
+	if (i && i < com_argc-1) {
+		strcpy (basedir, com_argv[i+1]);
+	} else {
+		strcpy (basedir, host_parms.basedir);
+	}
+	int j = strlen (basedir);
+	if (j > 0) {
+		if ((basedir[j-1] == '\\') || (basedir[j-1] == '/')) {
+			basedir[j-1] = 0;
+		}
+	}
+
+	int have_cue=cd_load_cue(basedir);
+	int have_compressed=cd_find_compressed(basedir);
+	if (!have_cue && !have_compressed) return 0;
+	cd_available=1;
+
+	//Create the buffer pool the samples are read into and start the cd audio task.
+	char *pool=heap_caps_aligned_alloc(64, CD_BUFSZ*CD_NUMBUFS, MALLOC_CAP_SPIRAM);
+	assert(pool);
+	cd_free=xQueueCreate(CD_NUMBUFS, sizeof(cdbuf_t*));
+	cd_full=xQueueCreate(CD_NUMBUFS, sizeof(cdbuf_t*));
+	assert(cd_free && cd_full);
+	for (int i=0; i<CD_NUMBUFS; i++) {
+		cdbuf_t *b=&cd_bufs[i];
+		b->data=pool+i*CD_BUFSZ;
+		xQueueSend(cd_free, &b, 0);
+	}
+	cd_stats.min_queued=CD_NUMBUFS;
 	player_ctl_mux=xSemaphoreCreateMutex();
-	xTaskCreatePinnedToCore(cd_task, "cdaudio", 4096, NULL, 4, NULL, 1);
+	Cmd_AddCommand("cd_stats", CDAudio_Stats_f);
+	xTaskCreatePinnedToCore(cd_task, "cdaudio", 4096, NULL, CD_PRIO_URGENT, NULL, 1);
+	S_SetMusicStream(CDAudio_ReadSamples, 44100);
 	return 1;
 }
 
 
 #define STATE_STOPPED 0
 #define STATE_PLAYING 1
-#define STATE_PLAYNEW 2
 #define STATE_SHUTDOWN 3
 
-static int state;
+//Player control; protected by player_ctl_mux. Every play command bumps
+//cd_generation, which tells the cd task to seek and the mixer to drop
+//whatever was read for the previous one.
+static volatile int state;
 static int cd_track;
 static int cd_looping;
+static volatile int cd_generation;
+
+//Music stream for the engine mixer: hand over up to count stereo frames of the
+//current track. This runs in the mixer, so it never waits; if the cd task is
+//behind, the mixer pads with silence.
+static int CDAudio_ReadSamples(short *samples, int count) {
+	char *dst=(char*)samples;
+	int len_bytes=count*4;
+	if (state!=STATE_PLAYING) return 0;
+	while (len_bytes) {
+		if (cd_cur && (cd_curpos>=cd_cur->len || cd_cur->generation!=cd_generation)) {
+			xQueueSend(cd_free, &cd_cur, 0);
+			cd_cur=NULL;
+		}
+		if (!cd_cur) {
+			int queued=uxQueueMessagesWaiting(cd_full);
+			if (queued<cd_stats.min_queued) cd_stats.min_queued=queued;
+			if (xQueueReceive(cd_full, &cd_cur, 0)!=pdTRUE) {
+				cd_stats.underruns++;
+				cd_stats.starved_frames+=len_bytes/4;
+				break;
+			}
+			cd_curpos=cd_cur->start;
+			continue;
+		}
+		int n=cd_cur->len-cd_curpos;
+		if (n>len_bytes) n=len_bytes;
+		memcpy(dst, cd_cur->data+cd_curpos, n);
+		cd_curpos+=n;
+		dst+=n;
+		len_bytes-=n;
+	}
+	return count-len_bytes/4;
+}
+
+//Where the cd task reads the current track from: a span of the bin image, or
+//the data chunk of a .wav file.
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IMA_ADPCM 0x11
 
-//Read samples from the current CD track into a buffer.
-void CDAudio_get_samps(char *samps, int len_bytes) {
-	size_t recv_size=0;
-	if (!ringbuf) {
-		//not initialized (yet?) so output silence
-		memset(samps, 0, len_bytes);
-		return; 
+typedef struct {
+	FILE *f;
+	int format;
+	int channels;
+	int blockalign;	//adpcm only
+	int spb;		//frames per adpcm block
+	long start, end;
+	long pos;
+	long filepos;	//where the file pointer is, -1 if unknown
+	long frames;	//from the fact chunk; the last adpcm block is padded
+	long frames_left;
+} cdsrc_t;
+
+static unsigned char *cd_scratch;	//compressed data on its way to the decoder
+#define CD_SCRATCHSZ (CD_BUFSZ/2)
+
+static int get_le16(const unsigned char *p) {
+	return p[0]|(p[1]<<8);
+}
+
+static int get_le32(const unsigned char *p) {
+	return p[0]|(p[1]<<8)|(p[2]<<16)|(p[3]<<24);
+}
+
+//Find the fmt and data chunks of a RIFF WAVE file
+static int cd_parse_wav(FILE *f, cdsrc_t *src, const char *name) {
+	unsigned char hdr[20];
+	int rate=0, bits=0;
+	long ofs=12;
+	if (fread(hdr, 1, 12, f)!=12 || memcmp(hdr, "RIFF", 4) || memcmp(hdr+8, "WAVE", 4)) {
+		printf("CD: %s is not a wav file\n", name);
+		return 0;
 	}
-	while (len_bytes) {
-		char *item=xRingbufferReceiveUpTo(ringbuf, &recv_size, portMAX_DELAY, len_bytes);
-		assert(recv_size<=len_bytes);
-		memcpy(samps, item, recv_size);
-		vRingbufferReturnItem(ringbuf, item);
-		samps+=recv_size;
-		len_bytes-=recv_size;
+	while (1) {
+		if (fseek(f, ofs, SEEK_SET) || fread(hdr, 1, 8, f)!=8) {
+			printf("CD: %s has no data chunk\n", name);
+			return 0;
+		}
+		int len=get_le32(hdr+4);
+		if (!memcmp(hdr, "fmt ", 4)) {
+			if (len<16 || fread(hdr, 1, 20, f)<16) return 0;
+			src->format=get_le16(hdr);
+			src->channels=get_le16(hdr+2);
+			rate=get_le32(hdr+4);
+			src->blockalign=get_le16(hdr+12);
+			bits=get_le16(hdr+14);
+		} else if (!memcmp(hdr, "fact", 4)) {
+			if (len<4 || fread(hdr, 1, 4, f)!=4) return 0;
+			src->frames=get_le32(hdr);
+		} else if (!memcmp(hdr, "data", 4)) {
+			src->start=ofs+8;
+			src->end=src->start+len;
+			break;
+		}
+		ofs+=8+((len+1)&~1);
+	}
+	if (rate!=44100) {
+		printf("CD: %s is %d Hz, need 44100\n", name, rate);
+		return 0;
 	}
+	if (src->format==WAVE_FORMAT_PCM && bits==16 && src->channels==2) {
+		return 1;
+	}
+	if (src->format==WAVE_FORMAT_IMA_ADPCM && bits==4 && (src->channels==1 || src->channels==2)) {
+		src->spb=(src->blockalign/src->channels-4)*2+1;
+		if (src->blockalign<=4*src->channels || src->blockalign>CD_SCRATCHSZ || src->spb>CD_BUFSZ/4) {
+			printf("CD: %s has unusable block size %d\n", name, src->blockalign);
+			return 0;
+		}
+		return 1;
+	}
+	printf("CD: %s: format %d, %d bit, %d channels not supported\n", name, src->format, bits, src->channels);
+	return 0;
+}
+
+//Point src at a track; the previous track's file is closed
+static int cd_open(cdsrc_t *src, int trk) {
+	if (src->f && src->f!=cdfile) fclose(src->f);
+	memset(src, 0, sizeof(*src));
+	src->filepos=-1;
+	if (tracks[trk].file) {
+		src->f=fopen(tracks[trk].file, "rb");
+		if (!src->f) {
+			printf("CD: can't open %s\n", tracks[trk].file);
+			return 0;
+		}
+		setvbuf(src->f, NULL, _IONBF, 0);
+		if (!cd_parse_wav(src->f, src, tracks[trk].file)) {
+			fclose(src->f);
+			src->f=NULL;
+			return 0;
+		}
+	} else if (cdfile) {
+		src->f=cdfile;
+		src->format=WAVE_FORMAT_PCM;
+		src->channels=2;
+		src->start=tracks[trk].offset_bytes;
+		src->end=src->start+tracks[trk].length_bytes;
+	} else {
+		return 0;
+	}
+	src->pos=src->start;
+	src->frames_left=src->frames?src->frames:-1;
+	return 1;
 }
 
-void cd_task(void *param) {
-	int size=RINGBUF_SZ/4; //we read in chunks this big
-	char *item=malloc(size);
+static int64_t cd_timed_read(cdsrc_t *src, long ofs, void *dst, int len) {
+	if (ofs!=src->filepos && fseek(src->f, ofs, SEEK_SET)!=0) return -1;
+	int64_t t=esp_timer_get_time();
+	int n=fread(dst, 1, len, src->f);
+	t=esp_timer_get_time()-t;
+	if (n<=0) return -1;
+	src->filepos=ofs+n;
+	cd_stats.reads++;
+	cd_stats.read_bytes+=n;
+	cd_stats.read_us+=t;
+	if (t>cd_stats.max_read_us) cd_stats.max_read_us=t;
+	return n;
+}
+
+//Read the next piece of raw audio into buf. Reads start on a CD_READ_ALIGN
+//boundary; after a seek the bytes before pos are skipped.
+static int cd_read_pcm(cdsrc_t *src, cdbuf_t *buf) {
+	long apos=src->pos&~(long)(CD_READ_ALIGN-1);
+	int want=CD_BUFSZ;
+	if (apos+want>src->end) want=src->end-apos;
+	int n=cd_timed_read(src, apos, buf->data, want);
+	if (n<=src->pos-apos) return 0;
+	buf->start=src->pos-apos;
+	buf->len=n&~3;
+	src->pos=apos+n;
+	return 1;
+}
+
+static const int ima_index_table[16]={
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const short ima_step_table[89]={
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+//Decode one IMA-ADPCM block of len bytes (the last one in a file may be
+//short) into interleaved stereo frames; mono is duplicated to both sides.
+//Returns the number of frames.
+static int cd_decode_adpcm(const unsigned char *in, int len, int channels, short *out) {
+	int pred[2], index[2];
+	int frames=0;
+	if (len<4*channels) return 0;
+	for (int c=0; c<channels; c++) {
+		pred[c]=(short)get_le16(in);
+		index[c]=in[2];
+		if (index[c]>88) index[c]=88;
+		in+=4;
+		len-=4;
+	}
+	out[0]=pred[0];
+	out[1]=pred[channels-1];
+	out+=2;
+	frames++;
+	//then groups of 4 bytes (8 samples) per channel, low nibble first
+	while (len>=4*channels) {
+		for (int c=0; c<channels; c++) {
+			short *o=out+c;
+			for (int i=0; i<8; i++) {
+				int nib=(in[i>>1]>>((i&1)*4))&15;
+				int step=ima_step_table[index[c]];
+				int diff=step>>3;
+				if (nib&1) diff+=step>>2;
+				if (nib&2) diff+=step>>1;
+				if (nib&4) diff+=step;
+				if (nib&8) diff=-diff;
+				pred[c]+=diff;
+				if (pred[c]>32767) pred[c]=32767;
+				if (pred[c]<-32768) pred[c]=-32768;
+				index[c]+=ima_index_table[nib];
+				if (index[c]<0) index[c]=0;
+				if (index[c]>88) index[c]=88;
+				o[0]=pred[c];
+				if (channels==1) o[1]=pred[c];
+				o+=2;
+			}
+			in+=4;
+		}
+		out+=16;
+		frames+=8;
+		len-=4*channels;
+	}
+	return frames;
+}
+
+//Read as many whole adpcm blocks as fit in buf and decode them
+static int cd_read_adpcm(cdsrc_t *src, cdbuf_t *buf) {
+	int blocks=(CD_BUFSZ/4)/src->spb;
+	if (blocks*src->blockalign>CD_SCRATCHSZ) blocks=CD_SCRATCHSZ/src->blockalign;
+	int want=blocks*src->blockalign;
+	if (src->pos+want>src->end) want=src->end-src->pos;
+	int n=cd_timed_read(src, src->pos, cd_scratch, want);
+	if (n<=0) return 0;
+	int64_t t=esp_timer_get_time();
+	int frames=0;
+	for (int ofs=0; ofs<n; ofs+=src->blockalign) {
+		int len=n-ofs;
+		if (len>src->blockalign) len=src->blockalign;
+		frames+=cd_decode_adpcm(cd_scratch+ofs, len, src->channels, (short*)buf->data+frames*2);
+	}
+	cd_stats.decode_us+=esp_timer_get_time()-t;
+	cd_stats.decoded_frames+=frames;
+	if (src->frames_left>=0) {
+		if (frames>src->frames_left) frames=src->frames_left;
+		src->frames_left-=frames;
+	}
+	buf->start=0;
+	buf->len=frames*4;
+	src->pos+=n;
+	return 1;
+}
+
+static void cd_task(void *param) {
+	int gen=0;
+	int trk=0, looping=0, playing;
+	int prio=CD_PRIO_URGENT;
+	cdsrc_t src={0};
+	cdbuf_t *buf;
+	cd_scratch=malloc(CD_SCRATCHSZ);
+	assert(cd_scratch);
 	while(state!=STATE_SHUTDOWN) {
+		//Only look at the controls under the lock; the I/O happens outside it
 		xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-		if (state==STATE_STOPPED) { //or paused
-			//output silence
-			memset(item, 0, size);
-		} else {
-			if (state==STATE_PLAYNEW) {
-				state=STATE_PLAYING;
-				printf("CD: Changing to track %d (looping %d)\n", cd_track, cd_looping);
-				fseek(cdfile, tracks[cd_track].offset_bytes, SEEK_SET);
+		int newgen=(gen!=cd_generation);
+		if (newgen) {
+			gen=cd_generation;
+			trk=cd_track;
+			looping=cd_looping;
+		}
+		playing=(state==STATE_PLAYING);
+		xSemaphoreGive(player_ctl_mux);
+
+		if (newgen) {
+			printf("CD: Changing to track %d (looping %d)\n", trk, looping);
+			if (!cd_open(&src, trk)) src.pos=src.end=0;
+		}
+		if (!playing) {
+			vTaskDelay(pdMS_TO_TICKS(20));
+			continue;
+		}
+		if (src.pos>=src.end) {
+			int ok;
+			if (looping) {
+				printf("End of track. Looping.\n");
+				ok=(src.f!=NULL);
+				src.pos=src.start;
+				src.frames_left=src.frames?src.frames:-1;
+			} else if (trk+1>=MAX_TRK || tracks[trk+1].type==TYPE_NONE) {
+				ok=0;
+			} else {
+				trk++;
+				printf("End of track. Next track %d.\n", trk);
+				ok=cd_open(&src, trk);
 			}
-			fread(item, size, 1, cdfile);
-			long pos=ftell(cdfile);
-			//printf("CD: %d\n", pos);
-			assert((pos%CD_FRAME_SIZE)==0);
-			if (pos > tracks[cd_track].offset_bytes+tracks[cd_track].length_bytes) {
-				if (cd_looping) {
-					printf("End of track. Looping.\n");
-					fseek(cdfile, tracks[cd_track].offset_bytes, SEEK_SET);
-				} else {
-					cd_track++;
-					printf("End of track. Next track %d.\n", cd_track);
-					if (tracks[cd_track].type==TYPE_NONE) state=STATE_STOPPED;
-				}
+			if (!ok || src.pos>=src.end) {
+				printf("CD: Stopping.\n");
+				xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
+				if (gen==cd_generation) state=STATE_STOPPED;
+				xSemaphoreGive(player_ctl_mux);
+				continue;
 			}
 		}
-		xSemaphoreGive(player_ctl_mux);
-		xRingbufferSend(ringbuf, item, size, portMAX_DELAY);
+
+		//While a level loads the card belongs to the game; only read when the
+		//pool is running low, and then at full priority.
+		int queued=uxQueueMessagesWaiting(cd_full);
+		int urgent=(queued<CD_LOWWATER);
+		if (!urgent && scr_disabled_for_loading) {
+			cd_stats.deferred++;
+			vTaskDelay(pdMS_TO_TICKS(10));
+			continue;
+		}
+		if (xQueueReceive(cd_free, &buf, pdMS_TO_TICKS(20))!=pdTRUE) continue;
+		int want_prio=urgent?CD_PRIO_URGENT:CD_PRIO_BACKGROUND;
+		if (want_prio!=prio) {
+			vTaskPrioritySet(NULL, want_prio);
+			prio=want_prio;
+		}
+		if (urgent) cd_stats.urgent_reads++;
+
+		int ok;
+		if (src.format==WAVE_FORMAT_IMA_ADPCM) {
+			ok=cd_read_adpcm(&src, buf);
+		} else {
+			ok=cd_read_pcm(&src, buf);
+		}
+		if (!ok) {
+			printf("CD: read error at %ld\n", src.pos);
+			xQueueSend(cd_free, &buf, 0);
+			src.filepos=-1;
+			src.pos=src.end; //move on as if the track ended
+			continue;
+		}
+		buf->generation=gen;
+		xQueueSend(cd_full, &buf, 0);
 	}
-	fclose(cdfile);
-	free(item);
+	if (src.f && src.f!=cdfile) fclose(src.f);
+	if (cdfile) fclose(cdfile);
+	free(cd_scratch);
 	vTaskDelete(NULL);
 }
 
+static void CDAudio_Stats_f(void) {
+	Con_Printf("%d underruns, %d frames of silence\n", cd_stats.underruns, cd_stats.starved_frames);
+	Con_Printf("%d reads (%d urgent), %d KiB, %d deferred for loading\n", cd_stats.reads,
+				cd_stats.urgent_reads, (int)(cd_stats.read_bytes/1024), cd_stats.deferred);
+	if (cd_stats.reads) {
+		Con_Printf("read time avg %d us, max %d us, %d KiB/s\n", (int)(cd_stats.read_us/cd_stats.reads),
+				cd_stats.max_read_us, cd_stats.read_us?(int)(cd_stats.read_bytes*1000000/1024/cd_stats.read_us):0);
+	}
+	if (cd_stats.decoded_frames) {
+		Con_Printf("adpcm: %d frames decoded, %d us per second of audio\n", (int)cd_stats.decoded_frames,
+				(int)(cd_stats.decode_us*44100/cd_stats.decoded_frames));
+	}
+	Con_Printf("pool %d of %d buffers full, low %d\n", (int)uxQueueMessagesWaiting(cd_full), CD_NUMBUFS,
+				cd_stats.min_queued);
+	if (Cmd_Argc()>1 && !strcmp(Cmd_Argv(1), "reset")) {
+		memset(&cd_stats, 0, sizeof(cd_stats));
+		cd_stats.min_queued=CD_NUMBUFS;
+	}
+}
+
 void CDAudio_Shutdown(void)
 {
+	S_SetMusicStream(NULL, 0);
 	state=STATE_SHUTDOWN;
 }
 
 
 void CDAudio_Play(byte track, qboolean looping) {
-	if (!cdfile) return;
+	if (!cd_available) return;
+	if (track>=MAX_TRK || tracks[track].type==TYPE_NONE) return;
 	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_PLAYNEW;
+	state=STATE_PLAYING;
 	cd_track=track;
 	cd_looping=looping;
+	cd_generation++;
 	printf("CD: Playing\n");
 	xSemaphoreGive(player_ctl_mux);
 }
 
 
 void CDAudio_Stop(void) {
-	if (!cdfile) return;
+	if (!cd_available) return;
 	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
 	state=STATE_STOPPED;
 	printf("CD: Stopping\n");
@@ -290,7 +704,7 @@ void CDAudio_Stop(void) {
 
 
 void CDAudio_Pause(void) {
-	if (!cdfile) return;
+	if (!cd_available) return;
 	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
 	state=STATE_STOPPED;
 	printf("CD: Pausing\n");
@@ -299,9 +713,9 @@ void CDAudio_Pause(void) {
 
 
 void CDAudio_Resume(void) {
-	if (!cdfile) return;
+	if (!cd_available) return;
 	xSemaphoreTake(player_ctl_mux, portMAX_DELAY);
-	state=STATE_PLAYING;
+	if (cd_generation) state=STATE_PLAYING; //nothing to resume before the first play
 	printf("CD: Resuming\n");
 	xSemaphoreGive(player_ctl_mux);
 }
@@ -0,0 +1,285 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+Host tool: converts the audio tracks of a .cue/.bin CD image into IMA-ADPCM .wav files
+that the cd task in main/cd_cue.c plays instead of the raw image, at a quarter of the
+card bandwidth. Build and run with e.g.
+
+	cc -O2 -o cd2adpcm tools/cd2adpcm.c -lm
+	./cd2adpcm game.cue music
+
+and copy the resulting music/ directory next to id1/ on the SD card.
+
+The data chunk is padded to start on a 4K boundary and blocks are 2048 bytes, so the
+player's reads of whole blocks stay aligned on the card.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define CD_FRAME_SIZE 2352
+#define MAX_TRK 32
+
+#define BLOCKALIGN 2048
+#define CHANNELS 2
+#define SPB ((BLOCKALIGN/CHANNELS-4)*2+1)	//frames per block
+#define DATA_ALIGN 4096
+
+typedef struct {
+	long offset_bytes;
+	long length_bytes;
+	int audio;
+	int present;
+} track_t;
+
+static track_t tracks[MAX_TRK];
+
+static const int ima_index_table[16]={
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const short ima_step_table[89]={
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+//Encoder state per channel; updated exactly like the decoder does
+typedef struct {
+	int pred;
+	int index;
+} ima_t;
+
+static int ima_encode(ima_t *s, int sample) {
+	int step=ima_step_table[s->index];
+	int diff=sample-s->pred;
+	int nib=0;
+	if (diff<0) {
+		nib=8;
+		diff=-diff;
+	}
+	int vpdiff=step>>3;
+	if (diff>=step) {
+		nib|=4;
+		diff-=step;
+		vpdiff+=step;
+	}
+	step>>=1;
+	if (diff>=step) {
+		nib|=2;
+		diff-=step;
+		vpdiff+=step;
+	}
+	step>>=1;
+	if (diff>=step) {
+		nib|=1;
+		vpdiff+=step;
+	}
+	if (nib&8) s->pred-=vpdiff; else s->pred+=vpdiff;
+	if (s->pred>32767) s->pred=32767;
+	if (s->pred<-32768) s->pred=-32768;
+	s->index+=ima_index_table[nib];
+	if (s->index<0) s->index=0;
+	if (s->index>88) s->index=88;
+	return nib;
+}
+
+static void put_le16(unsigned char *p, int v) {
+	p[0]=v;
+	p[1]=v>>8;
+}
+
+static void put_le32(unsigned char *p, long v) {
+	p[0]=v;
+	p[1]=v>>8;
+	p[2]=v>>16;
+	p[3]=v>>24;
+}
+
+//Encode frames (interleaved stereo, possibly fewer than SPB at the end of
+//the track; the rest of the block is padded with the last sample) into out.
+static void encode_block(ima_t *st, const short *in, int frames, unsigned char *out, double *err) {
+	short pcm[SPB*CHANNELS];
+	for (int i=0; i<SPB; i++) {
+		int f=(i<frames)?i:frames-1;
+		for (int c=0; c<CHANNELS; c++) pcm[i*CHANNELS+c]=in[f*CHANNELS+c];
+	}
+	//header: the first sample is stored as-is
+	for (int c=0; c<CHANNELS; c++) {
+		st[c].pred=pcm[c];
+		put_le16(out, st[c].pred);
+		out[2]=st[c].index;
+		out[3]=0;
+		out+=4;
+	}
+	for (int i=1; i<SPB; i+=8) {
+		for (int c=0; c<CHANNELS; c++) {
+			for (int j=0; j<8; j+=2) {
+				int s0=pcm[(i+j)*CHANNELS+c];
+				int s1=pcm[(i+j+1)*CHANNELS+c];
+				int lo=ima_encode(&st[c], s0);
+				if (i+j<frames) *err+=(double)(s0-st[c].pred)*(s0-st[c].pred);
+				int hi=ima_encode(&st[c], s1);
+				if (i+j+1<frames) *err+=(double)(s1-st[c].pred)*(s1-st[c].pred);
+				*out++=lo|(hi<<4);
+			}
+		}
+	}
+}
+
+static int convert_track(FILE *bin, int trk, const char *outdir) {
+	char fn[1024];
+	snprintf(fn, sizeof(fn), "%s/track%02d.wav", outdir, trk);
+	FILE *out=fopen(fn, "wb");
+	if (!out) {
+		perror(fn);
+		return 0;
+	}
+	long frames=tracks[trk].length_bytes/4;
+	long blocks=(frames+SPB-1)/SPB;
+	long datalen=blocks*BLOCKALIGN;
+
+	//RIFF, fmt (20 bytes with the extra), fact, JUNK up to DATA_ALIGN-8, data
+	unsigned char hdr[DATA_ALIGN];
+	memset(hdr, 0, sizeof(hdr));
+	memcpy(hdr, "RIFF", 4);
+	put_le32(hdr+4, DATA_ALIGN-8+datalen);
+	memcpy(hdr+8, "WAVE", 4);
+	memcpy(hdr+12, "fmt ", 4);
+	put_le32(hdr+16, 20);
+	put_le16(hdr+20, 0x11);						//IMA ADPCM
+	put_le16(hdr+22, CHANNELS);
+	put_le32(hdr+24, 44100);
+	put_le32(hdr+28, 44100L*BLOCKALIGN/SPB);	//bytes per second
+	put_le16(hdr+32, BLOCKALIGN);
+	put_le16(hdr+34, 4);
+	put_le16(hdr+36, 2);						//extra bytes
+	put_le16(hdr+38, SPB);
+	memcpy(hdr+40, "fact", 4);					//exact length; the last block is padded
+	put_le32(hdr+44, 4);
+	put_le32(hdr+48, frames);
+	memcpy(hdr+52, "JUNK", 4);
+	put_le32(hdr+56, DATA_ALIGN-8-60);
+	memcpy(hdr+DATA_ALIGN-8, "data", 4);
+	put_le32(hdr+DATA_ALIGN-4, datalen);
+	fwrite(hdr, 1, DATA_ALIGN, out);
+
+	ima_t st[CHANNELS]={{0, 0}, {0, 0}};
+	short pcm[SPB*CHANNELS];
+	unsigned char block[BLOCKALIGN];
+	double err=0, sig=0;
+	fseek(bin, tracks[trk].offset_bytes, SEEK_SET);
+	for (long b=0; b<blocks; b++) {
+		int n=frames-b*SPB;
+		if (n>SPB) n=SPB;
+		n=fread(pcm, 4, n, bin);
+		if (n<=0) {
+			fprintf(stderr, "%s: short read\n", fn);
+			fclose(out);
+			return 0;
+		}
+		for (int i=0; i<n*CHANNELS; i++) sig+=(double)pcm[i]*pcm[i];
+		encode_block(st, pcm, n, block, &err);
+		fwrite(block, 1, BLOCKALIGN, out);
+	}
+	fclose(out);
+	printf("Track %d: %ld frames -> %s, %ld KiB, SNR %.1f dB\n", trk, frames, fn,
+			(DATA_ALIGN+datalen)/1024, err>0?10*log10(sig/err):99.0);
+	return 1;
+}
+
+//Same idea as the parser in cd_cue.c: remember the FILE, the track type and
+//the last INDEX of each track.
+static int parse_cue(const char *cuename, char *binfile, int binsize) {
+	FILE *f=fopen(cuename, "r");
+	if (!f) {
+		perror(cuename);
+		return 0;
+	}
+	char buf[1024];
+	int cur_trk=0, cur_audio=0;
+	binfile[0]=0;
+	while (fgets(buf, sizeof(buf), f)) {
+		char *p;
+		if ((p=strstr(buf, "FILE "))) {
+			char *q=strchr(p, '"');
+			char *e=q?strchr(q+1, '"'):NULL;
+			if (!e) continue;
+			//relative to the directory of the cue file
+			const char *slash=strrchr(cuename, '/');
+			int dirlen=slash?(int)(slash-cuename+1):0;
+			snprintf(binfile, binsize, "%.*s%.*s", dirlen, cuename, (int)(e-q-1), q+1);
+		} else if ((p=strstr(buf, "TRACK"))) {
+			cur_trk=strtol(p+6, NULL, 10);
+			cur_audio=(strstr(p, "AUDIO")!=NULL);
+		} else if ((p=strstr(buf, "INDEX"))) {
+			int mins, secs, frms;
+			strtol(p+6, &p, 10);
+			if (sscanf(p, " %d:%d:%d", &mins, &secs, &frms)!=3) continue;
+			if (cur_trk>0 && cur_trk<MAX_TRK) {
+				tracks[cur_trk].offset_bytes=(75L*(mins*60+secs)+frms)*CD_FRAME_SIZE;
+				tracks[cur_trk].audio=cur_audio;
+				tracks[cur_trk].present=1;
+			}
+		}
+	}
+	fclose(f);
+	if (!binfile[0]) {
+		fprintf(stderr, "%s: no FILE line\n", cuename);
+		return 0;
+	}
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	char binfile[1024];
+	if (argc!=3) {
+		fprintf(stderr, "usage: %s image.cue outdir\n", argv[0]);
+		return 1;
+	}
+	if (!parse_cue(argv[1], binfile, sizeof(binfile))) return 1;
+	FILE *bin=fopen(binfile, "rb");
+	if (!bin) {
+		perror(binfile);
+		return 1;
+	}
+	fseek(bin, 0, SEEK_END);
+	long binsize=ftell(bin);
+
+	int converted=0;
+	for (int i=1; i<MAX_TRK; i++) {
+		if (!tracks[i].present) continue;
+		if (i==MAX_TRK-1 || !tracks[i+1].present) {
+			tracks[i].length_bytes=binsize-tracks[i].offset_bytes;
+		} else {
+			tracks[i].length_bytes=tracks[i+1].offset_bytes-tracks[i].offset_bytes;
+		}
+		if (!tracks[i].audio || tracks[i].length_bytes<4) continue;
+		if (!convert_track(bin, i, argv[2])) return 1;
+		converted++;
+	}
+	fclose(bin);
+	printf("%d tracks converted\n", converted);
+	return 0;
+}